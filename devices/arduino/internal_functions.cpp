@@ -182,29 +182,29 @@ static sinanbox_t serial_flush(uint8_t argc, sinanbox_t *argv) {
   return NANBOX_OFUNDEF();
 }
 
-static const sivmfnptr_t internals[] = {
-  digital_read,
-  digital_write,
-  pin_mode,
-  analog_read,
-  analog_reference,
-  analog_write,
-  fn_delay,
-  delay_us,
-  fn_micros,
-  fn_millis,
-  attach_interrupt,
-  detach_interrupt,
-  enable_interrupts,
-  disable_interrupts,
-  serial_begin,
-  serial_end,
-  serial_settimeout,
-  serial_print,
-  serial_println,
-  serial_read,
-  serial_write,
-  serial_flush
+static const sivmfn_t internals[] = {
+  { digital_read, sivmfn_borrows_args },
+  { digital_write, sivmfn_borrows_args },
+  { pin_mode, sivmfn_borrows_args },
+  { analog_read, sivmfn_borrows_args },
+  { analog_reference, sivmfn_borrows_args },
+  { analog_write, sivmfn_borrows_args },
+  { fn_delay, sivmfn_borrows_args },
+  { delay_us, sivmfn_borrows_args },
+  { fn_micros, sivmfn_borrows_args },
+  { fn_millis, sivmfn_borrows_args },
+  { attach_interrupt, sivmfn_borrows_args },
+  { detach_interrupt, sivmfn_borrows_args },
+  { enable_interrupts, sivmfn_borrows_args },
+  { disable_interrupts, sivmfn_borrows_args },
+  { serial_begin, sivmfn_borrows_args },
+  { serial_end, sivmfn_borrows_args },
+  { serial_settimeout, sivmfn_borrows_args },
+  { serial_print, sivmfn_borrows_args },
+  { serial_println, sivmfn_borrows_args },
+  { serial_read, sivmfn_borrows_args },
+  { serial_write, sivmfn_borrows_args },
+  { serial_flush, sivmfn_borrows_args }
 };
 
 void setupInternals() {
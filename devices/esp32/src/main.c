@@ -51,7 +51,7 @@ void app_main(void) {
   }
 
   sinter_value_t result;
-  sinter_fault_t fault = sinter_run(binary, binary_size, &result);
+  sinter_fault_t fault = sinter_run_mutable(binary, binary_size, &result);
 
   printf("Program exited with fault %d and result type %d (%d, %d, %f)\n", fault, result.type, result.integer_value, result.boolean_value, result.float_value);
   app_exit();
@@ -23,6 +23,8 @@
 #include <sinter/program.h>
 #include <sinter/vm.h>
 
+#include "runner.h"
+
 // For more information on the sysfs interface,
 // - https://docs.ev3dev.org/projects/lego-linux-drivers/en/ev3dev-stretch/index.html
 // - https://docs.ev3dev.org/projects/lego-linux-drivers/en/ev3dev-stretch/ev3.html
@@ -233,6 +235,20 @@ static sinanbox_t find_touch_sensor(const char *address) {
 static sinanbox_t ev3_pause(uint8_t argc, sinanbox_t *argv) {
   CHECK_ARGC(1);
 
+#ifdef SINTER_TASKS
+  // in a task, let the other tasks run until the runner resumes this one
+  if (NANBOX_ISINT(argv[0]) || NANBOX_ISFLOAT(argv[0])) {
+    const float ms = NANBOX_ISINT(argv[0]) ? (float) NANBOX_INT(argv[0]) : NANBOX_FLOAT(argv[0]);
+    if (ms >= 0 && ms < (float) UINT32_MAX) {
+      const int task = sinter_task_suspend();
+      if (task >= 0) {
+        task_timer_start((unsigned int) task, (uint32_t) ms);
+        return NANBOX_OFUNDEF();
+      }
+    }
+  }
+#endif
+
   if (NANBOX_ISINT(argv[0])) {
     int32_t ms = NANBOX_INT(argv[0]);
     nanosleep(&(struct timespec){.tv_sec = ms / 1000, .tv_nsec = (ms % 1000) * 1000000}, NULL);
@@ -888,48 +904,48 @@ static sinanbox_t ev3_ledSetBrightness(uint8_t argc, sinanbox_t *argv) {
   return NANBOX_OFUNDEF();
 }
 
-static const sivmfnptr_t internals[] = {ev3_pause,
-                                        ev3_connected,
-                                        ev3_motorA,
-                                        ev3_motorB,
-                                        ev3_motorC,
-                                        ev3_motorD,
-                                        ev3_motorGetSpeed,
-                                        ev3_motorSetSpeed,
-                                        ev3_motorStart,
-                                        ev3_motorStop,
-                                        ev3_motorSetStopAction,
-                                        ev3_motorGetPosition,
-                                        ev3_runForTime,
-                                        ev3_runToAbsolutePosition,
-                                        ev3_runToRelativePosition,
-                                        ev3_colorSensor,
-                                        ev3_colorSensorRed,
-                                        ev3_colorSensorGreen,
-                                        ev3_colorSensorBlue,
-                                        ev3_reflectedLightIntensity,
-                                        ev3_ambientLightIntensity,
-                                        ev3_colorSensorGetColor,
-                                        ev3_ultrasonicSensor,
-                                        ev3_ultrasonicSensorDistance,
-                                        ev3_gyroSensor,
-                                        ev3_gyroSensorAngle,
-                                        ev3_gyroSensorRate,
-                                        ev3_touchSensor1,
-                                        ev3_touchSensor2,
-                                        ev3_touchSensor3,
-                                        ev3_touchSensor4,
-                                        ev3_touchSensorPressed,
-                                        ev3_hello,
-                                        ev3_waitForButtonPress,
-                                        ev3_speak,
-                                        ev3_playSequence,
-                                        ev3_ledLeftGreen,
-                                        ev3_ledLeftRed,
-                                        ev3_ledRightGreen,
-                                        ev3_ledRightRed,
-                                        ev3_ledGetBrightness,
-                                        ev3_ledSetBrightness};
+static const sivmfn_t internals[] = {{ev3_pause, sivmfn_borrows_args},
+                                        {ev3_connected, sivmfn_borrows_args},
+                                        {ev3_motorA, sivmfn_borrows_args},
+                                        {ev3_motorB, sivmfn_borrows_args},
+                                        {ev3_motorC, sivmfn_borrows_args},
+                                        {ev3_motorD, sivmfn_borrows_args},
+                                        {ev3_motorGetSpeed, sivmfn_borrows_args},
+                                        {ev3_motorSetSpeed, sivmfn_borrows_args},
+                                        {ev3_motorStart, sivmfn_borrows_args},
+                                        {ev3_motorStop, sivmfn_borrows_args},
+                                        {ev3_motorSetStopAction, sivmfn_borrows_args},
+                                        {ev3_motorGetPosition, sivmfn_borrows_args},
+                                        {ev3_runForTime, sivmfn_borrows_args},
+                                        {ev3_runToAbsolutePosition, sivmfn_borrows_args},
+                                        {ev3_runToRelativePosition, sivmfn_borrows_args},
+                                        {ev3_colorSensor, sivmfn_borrows_args},
+                                        {ev3_colorSensorRed, sivmfn_borrows_args},
+                                        {ev3_colorSensorGreen, sivmfn_borrows_args},
+                                        {ev3_colorSensorBlue, sivmfn_borrows_args},
+                                        {ev3_reflectedLightIntensity, sivmfn_borrows_args},
+                                        {ev3_ambientLightIntensity, sivmfn_borrows_args},
+                                        {ev3_colorSensorGetColor, sivmfn_borrows_args},
+                                        {ev3_ultrasonicSensor, sivmfn_borrows_args},
+                                        {ev3_ultrasonicSensorDistance, sivmfn_borrows_args},
+                                        {ev3_gyroSensor, sivmfn_borrows_args},
+                                        {ev3_gyroSensorAngle, sivmfn_borrows_args},
+                                        {ev3_gyroSensorRate, sivmfn_borrows_args},
+                                        {ev3_touchSensor1, sivmfn_borrows_args},
+                                        {ev3_touchSensor2, sivmfn_borrows_args},
+                                        {ev3_touchSensor3, sivmfn_borrows_args},
+                                        {ev3_touchSensor4, sivmfn_borrows_args},
+                                        {ev3_touchSensorPressed, sivmfn_borrows_args},
+                                        {ev3_hello, sivmfn_borrows_args},
+                                        {ev3_waitForButtonPress, sivmfn_borrows_args},
+                                        {ev3_speak, sivmfn_borrows_args},
+                                        {ev3_playSequence, sivmfn_borrows_args},
+                                        {ev3_ledLeftGreen, sivmfn_borrows_args},
+                                        {ev3_ledLeftRed, sivmfn_borrows_args},
+                                        {ev3_ledRightGreen, sivmfn_borrows_args},
+                                        {ev3_ledRightRed, sivmfn_borrows_args},
+                                        {ev3_ledGetBrightness, sivmfn_borrows_args},
+                                        {ev3_ledSetBrightness, sivmfn_borrows_args}};
 static const size_t internals_count = sizeof(internals) / sizeof(*internals);
 
 void setup_internals(void) {
@@ -41,7 +41,7 @@ static const char *type_names[] = {
 
 void display_object_result(sinter_value_t *res, _Bool is_error) {
   if (res->type == sinter_type_array || res->type == sinter_type_function) {
-    sinanbox_t arr = NANBOX_WITH_I32(res->object_value);
+    sinanbox_t arr = NANBOX_WITH_BITS(res->object_value);
     sidisplay_nanbox(arr, is_error);
   }
 }
@@ -54,7 +54,7 @@ static void print_integer(int32_t v, bool is_error) {
   fprintf(is_error ? stderr : stdout, "%d", v);
 }
 
-static void print_float(float v, bool is_error) {
+static void print_float(sinter_float_t v, bool is_error) {
   fprintf(is_error ? stderr : stdout, "%f", v);
 }
 
@@ -95,7 +95,7 @@ void siwasm_run(unsigned char *code, size_t code_size) {
   sinter_printer_flush = print_flush;
 
   sinter_value_t result;
-  sinter_fault_t fault = (uint8_t) sinter_run(code, code_size, &result);
+  sinter_fault_t fault = (uint8_t) sinter_run_mutable(code, code_size, &result);
 
   if (fault) {
     printf("Program exited unsuccessfully: %s\n",
@@ -0,0 +1,439 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include <sinter.h>
+
+#include "runner.h"
+
+/*
+ * Runs many programs on a pool of worker threads, each with its own VM
+ * instance (and heap), which is reused from program to program.
+ *
+ * The manifest lists one program per line; relative paths are relative to the
+ * directory of the manifest. For each program, one line of JSON is printed
+ * with the index of the program in the manifest, its path as listed, the fault, the type
+ * and value of the result, everything it displayed, and the time the VM took
+ * to run it. Lines are printed as programs finish, not in manifest order.
+ */
+
+#define eprintf(...) fprintf(stderr, __VA_ARGS__)
+
+typedef struct {
+  char *data;
+  size_t length;
+  size_t capacity;
+} buffer_t;
+
+typedef struct {
+  pthread_t thread;
+  sinter_vm_t *vm;
+  // what the program being run has displayed
+  buffer_t output;
+  // the line printed for the program
+  buffer_t line;
+
+  // guards the fields below, which the watchdog reads
+  pthread_mutex_t lock;
+  bool running;
+  struct timespec deadline;
+} worker_t;
+
+typedef struct {
+  // the path to the program, and the path as listed in the manifest (which is
+  // the end of the former)
+  char *path;
+  const char *name;
+} program_t;
+
+static program_t *programs;
+static size_t program_count;
+static atomic_size_t next_program;
+
+static worker_t *workers;
+static unsigned int worker_count;
+static long timeout_ms;
+static atomic_bool finished;
+
+static pthread_mutex_t output_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void buffer_append(buffer_t *buf, const char *data, size_t length) {
+  if (buf->length + length + 1 > buf->capacity) {
+    size_t capacity = buf->capacity ? buf->capacity : 256;
+    while (buf->length + length + 1 > capacity) {
+      capacity *= 2;
+    }
+    char *new_data = realloc(buf->data, capacity);
+    if (!new_data) {
+      // drop output that does not fit
+      return;
+    }
+    buf->data = new_data;
+    buf->capacity = capacity;
+  }
+  memcpy(buf->data + buf->length, data, length);
+  buf->length += length;
+  buf->data[buf->length] = '\0';
+}
+
+static void buffer_printf(buffer_t *buf, const char *format, ...) __attribute__((format(printf, 2, 3)));
+static void buffer_printf(buffer_t *buf, const char *format, ...) {
+  char tmp[64];
+  va_list args;
+  va_start(args, format);
+  const int length = vsnprintf(tmp, sizeof(tmp), format, args);
+  va_end(args);
+  if (length > 0) {
+    buffer_append(buf, tmp, (size_t) length < sizeof(tmp) ? (size_t) length : sizeof(tmp) - 1);
+  }
+}
+
+static void buffer_append_json_string(buffer_t *buf, const char *s) {
+  buffer_append(buf, "\"", 1);
+  for (; *s; ++s) {
+    const unsigned char c = (unsigned char) *s;
+    switch (c) {
+    case '"':
+      buffer_append(buf, "\\\"", 2);
+      break;
+    case '\\':
+      buffer_append(buf, "\\\\", 2);
+      break;
+    case '\n':
+      buffer_append(buf, "\\n", 2);
+      break;
+    case '\t':
+      buffer_append(buf, "\\t", 2);
+      break;
+    default:
+      if (c < 0x20) {
+        buffer_printf(buf, "\\u%04x", c);
+      } else {
+        buffer_append(buf, s, 1);
+      }
+      break;
+    }
+  }
+  buffer_append(buf, "\"", 1);
+}
+
+// the printers append to the output of the worker running the program
+
+static buffer_t *current_output(void) {
+  return &((worker_t *) sinter_vm_user_data(sinter_vm_current()))->output;
+}
+
+static void print_string(const char *s, bool is_error) {
+  (void) is_error;
+  buffer_append(current_output(), s, strlen(s));
+}
+
+static void print_integer(int32_t v, bool is_error) {
+  (void) is_error;
+  buffer_printf(current_output(), "%d", v);
+}
+
+static void print_float(sinter_float_t v, bool is_error) {
+  (void) is_error;
+  buffer_printf(current_output(), "%f", v);
+}
+
+static void print_flush(bool is_error) {
+  (void) is_error;
+  buffer_append(current_output(), "\n", 1);
+}
+
+static unsigned char *read_program(const char *path, size_t *size) {
+  FILE *f = fopen(path, "rb");
+  if (!f) {
+    return NULL;
+  }
+
+  unsigned char *data = NULL;
+  if (!fseek(f, 0, SEEK_END)) {
+    const long length = ftell(f);
+    if (length > 0 && !fseek(f, 0, SEEK_SET) && (data = malloc(length))) {
+      if (fread(data, 1, length, f) == (size_t) length) {
+        *size = (size_t) length;
+      } else {
+        free(data);
+        data = NULL;
+      }
+    }
+  }
+  fclose(f);
+  return data;
+}
+
+static int64_t elapsed_us(const struct timespec *start, const struct timespec *end) {
+  return (int64_t) (end->tv_sec - start->tv_sec) * 1000000 + (end->tv_nsec - start->tv_nsec) / 1000;
+}
+
+/**
+ * Appends the result of the program, as the value of "result".
+ */
+static void append_result(worker_t *worker, buffer_t *line, sinter_value_t *result) {
+  buffer_t value = { 0 };
+  switch (result->type) {
+  case sinter_type_undefined:
+    buffer_append(&value, "undefined", 9);
+    break;
+  case sinter_type_null:
+    buffer_append(&value, "null", 4);
+    break;
+  case sinter_type_boolean:
+    buffer_printf(&value, "%s", result->boolean_value ? "true" : "false");
+    break;
+  case sinter_type_integer:
+    buffer_printf(&value, "%d", result->integer_value);
+    break;
+  case sinter_type_float:
+    buffer_printf(&value, "%f", result->float_value);
+    break;
+  case sinter_type_string:
+    buffer_append(&value, result->string_value, strlen(result->string_value));
+    break;
+  case sinter_type_array:
+  case sinter_type_function: {
+    // displaying the object goes through the printers, so swap the buffers
+    const buffer_t output = worker->output;
+    worker->output = value;
+    display_object_result(result, false);
+    value = worker->output;
+    worker->output = output;
+    break;
+  }
+  default:
+    break;
+  }
+
+  buffer_append_json_string(line, value.data ? value.data : "");
+  free(value.data);
+}
+
+static void run_program(worker_t *worker, size_t index) {
+  const char *path = programs[index].path;
+  size_t size = 0;
+  unsigned char *program = read_program(path, &size);
+
+  sinter_value_t result = { 0 };
+  sinter_fault_t fault = sinter_fault_invalid_program;
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  if (program) {
+    pthread_mutex_lock(&worker->lock);
+    worker->running = true;
+    worker->deadline = start;
+    worker->deadline.tv_sec += timeout_ms / 1000;
+    worker->deadline.tv_nsec += (timeout_ms % 1000) * 1000000;
+    if (worker->deadline.tv_nsec >= 1000000000) {
+      ++worker->deadline.tv_sec;
+      worker->deadline.tv_nsec -= 1000000000;
+    }
+    pthread_mutex_unlock(&worker->lock);
+
+    fault = sinter_vm_run_mutable(worker->vm, program, size, &result);
+
+    pthread_mutex_lock(&worker->lock);
+    worker->running = false;
+    pthread_mutex_unlock(&worker->lock);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  buffer_t *const line = &worker->line;
+  buffer_printf(line, "{\"index\":%zu,\"program\":", index);
+  buffer_append_json_string(line, programs[index].name);
+  buffer_append(line, ",\"fault\":", 9);
+  buffer_append_json_string(line, program ? FAULT_NAME(fault) : "could not read program");
+  buffer_append(line, ",\"type\":", 8);
+  buffer_append_json_string(line, TYPE_NAME(result.type));
+  buffer_append(line, ",\"result\":", 10);
+  append_result(worker, line, &result);
+  buffer_append(line, ",\"output\":", 10);
+  buffer_append_json_string(line, worker->output.data ? worker->output.data : "");
+  buffer_printf(line, ",\"time_us\":%" PRId64 "}\n", elapsed_us(&start, &end));
+
+  pthread_mutex_lock(&output_lock);
+  fwrite(line->data, 1, line->length, stdout);
+  pthread_mutex_unlock(&output_lock);
+
+  line->length = 0;
+  worker->output.length = 0;
+  if (worker->output.data) {
+    worker->output.data[0] = '\0';
+  }
+  free(program);
+}
+
+static void *worker_main(void *arg) {
+  worker_t *const worker = arg;
+  size_t index;
+  while ((index = atomic_fetch_add(&next_program, 1)) < program_count) {
+    run_program(worker, index);
+  }
+  return NULL;
+}
+
+/**
+ * Stops programs that run for longer than the timeout.
+ */
+static void *watchdog_main(void *arg) {
+  (void) arg;
+  const struct timespec interval = { .tv_nsec = 10000000 };
+  while (!atomic_load(&finished)) {
+    nanosleep(&interval, NULL);
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    for (unsigned int i = 0; i < worker_count; ++i) {
+      worker_t *const worker = workers + i;
+      pthread_mutex_lock(&worker->lock);
+      if (worker->running && elapsed_us(&worker->deadline, &now) >= 0) {
+        sinter_vm_stop(worker->vm);
+      }
+      pthread_mutex_unlock(&worker->lock);
+    }
+  }
+  return NULL;
+}
+
+/**
+ * Reads the manifest, resolving relative paths against its directory.
+ */
+static bool read_manifest(const char *path) {
+  FILE *f = strcmp(path, "-") ? fopen(path, "r") : stdin;
+  if (!f) {
+    perror("Failed to open manifest");
+    return false;
+  }
+
+  const char *slash = strrchr(path, '/');
+  const size_t dir_length = f != stdin && slash ? (size_t) (slash - path) + 1 : 0;
+  size_t capacity = 0;
+  char *line = NULL;
+  size_t line_capacity = 0;
+  ssize_t length;
+  while ((length = getline(&line, &line_capacity, f)) >= 0) {
+    while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r')) {
+      line[--length] = '\0';
+    }
+    if (!length) {
+      continue;
+    }
+
+    if (program_count == capacity) {
+      capacity = capacity ? capacity * 2 : 64;
+      program_t *new_programs = realloc(programs, capacity * sizeof(program_t));
+      if (!new_programs) {
+        perror("Failed to read manifest");
+        return false;
+      }
+      programs = new_programs;
+    }
+
+    const size_t prefix = line[0] == '/' ? 0 : dir_length;
+    char *program = malloc(prefix + (size_t) length + 1);
+    if (!program) {
+      perror("Failed to read manifest");
+      return false;
+    }
+    memcpy(program, path, prefix);
+    memcpy(program + prefix, line, (size_t) length + 1);
+    programs[program_count++] = (program_t) { .path = program, .name = program + prefix };
+  }
+
+  free(line);
+  if (f != stdin) {
+    fclose(f);
+  }
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+  int opt;
+  while ((opt = getopt(argc, argv, "j:t:")) != -1) {
+    switch (opt) {
+    case 'j':
+      jobs = strtol(optarg, NULL, 10);
+      break;
+    case 't':
+      timeout_ms = strtol(optarg, NULL, 10);
+      break;
+    default:
+      optind = argc;
+      break;
+    }
+  }
+
+  if (optind != argc - 1 || jobs < 1 || timeout_ms < 0) {
+    eprintf("Usage: %s [-j jobs] [-t timeout_ms] <manifest, or - for stdin>\n", argv[0]);
+    return 1;
+  }
+
+  if (!read_manifest(argv[optind])) {
+    return 1;
+  }
+
+  sinter_printer_float = print_float;
+  sinter_printer_string = print_string;
+  sinter_printer_integer = print_integer;
+  sinter_printer_flush = print_flush;
+
+  setup_internals();
+
+  worker_count = (size_t) jobs < program_count ? (unsigned int) jobs : (unsigned int) program_count;
+  workers = calloc(worker_count ? worker_count : 1, sizeof(worker_t));
+  if (!workers) {
+    perror("Failed to create workers");
+    return 1;
+  }
+
+  for (unsigned int i = 0; i < worker_count; ++i) {
+    worker_t *const worker = workers + i;
+    pthread_mutex_init(&worker->lock, NULL);
+    // instances take the printers and VM-internal functions set up above
+    worker->vm = sinter_vm_create(RUNNER_HEAP_SIZE, worker);
+    if (!worker->vm || pthread_create(&worker->thread, NULL, worker_main, worker)) {
+      eprintf("Failed to start worker %u\n", i);
+      return 1;
+    }
+  }
+
+  pthread_t watchdog;
+  const bool has_watchdog = timeout_ms > 0 && worker_count;
+  if (has_watchdog && pthread_create(&watchdog, NULL, watchdog_main, NULL)) {
+    eprintf("Failed to start watchdog\n");
+    return 1;
+  }
+
+  for (unsigned int i = 0; i < worker_count; ++i) {
+    pthread_join(workers[i].thread, NULL);
+  }
+  atomic_store(&finished, true);
+  if (has_watchdog) {
+    pthread_join(watchdog, NULL);
+  }
+
+  for (unsigned int i = 0; i < worker_count; ++i) {
+    sinter_vm_destroy(workers[i].vm);
+    free(workers[i].output.data);
+    free(workers[i].line.data);
+    pthread_mutex_destroy(&workers[i].lock);
+  }
+  free(workers);
+  for (size_t i = 0; i < program_count; ++i) {
+    free(programs[i].path);
+  }
+  free(programs);
+  return 0;
+}
@@ -1,5 +1,8 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include <sinter/vm.h>
 #include <sinter/program.h>
@@ -7,6 +10,8 @@
 #include <sinter/display.h>
 #include <sinter.h>
 
+#include "runner.h"
+
 static svm_constant_t *hello_world_string = NULL;
 
 static sinanbox_t hello_world(uint8_t argc, sinanbox_t *argv) {
@@ -15,7 +20,33 @@ static sinanbox_t hello_world(uint8_t argc, sinanbox_t *argv) {
   return SIHEAP_PTRTONANBOX(str);
 }
 
-static const sivmfnptr_t internals[] = { hello_world };
+#ifdef SINTER_TASKS
+static sinanbox_t task_yield(uint8_t argc, sinanbox_t *argv) {
+  (void) argc; (void) argv;
+  sinter_task_yield();
+  return NANBOX_OFUNDEF();
+}
+
+// task_sleep(ms): suspends the running task for ms milliseconds
+static sinanbox_t task_sleep(uint8_t argc, sinanbox_t *argv) {
+  const uint32_t ms = argc && NANBOX_ISINT(argv[0]) && NANBOX_INT(argv[0]) > 0 ? (uint32_t) NANBOX_INT(argv[0]) : 0;
+  const int task = sinter_task_suspend();
+  if (task < 0) {
+    nanosleep(&(struct timespec){.tv_sec = ms / 1000, .tv_nsec = (long) (ms % 1000) * 1000000}, NULL);
+  } else {
+    task_timer_start((unsigned int) task, ms);
+  }
+  return NANBOX_OFUNDEF();
+}
+#endif
+
+static const sivmfn_t internals[] = {
+  { hello_world, sivmfn_borrows_args },
+#ifdef SINTER_TASKS
+  { task_yield, sivmfn_borrows_args },
+  { task_sleep, sivmfn_borrows_args },
+#endif
+};
 static const size_t internals_count = sizeof(internals)/sizeof(*internals);
 
 void setup_internals(void) {
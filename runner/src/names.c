@@ -0,0 +1,37 @@
+#include <stddef.h>
+
+#include "runner.h"
+
+const char *const fault_names[] = {
+  "no fault",
+  "out of memory",
+  "type error",
+  "divide by zero",
+  "stack overflow",
+  "stack underflow",
+  "uninitialised load",
+  "invalid load",
+  "invalid program",
+  "internal error",
+  "incorrect function arity",
+  "program called error()",
+  "uninitialised heap",
+  "stopped",
+  "program not loaded",
+  "invalid snapshot",
+  "busy"
+};
+const size_t fault_name_count = sizeof(fault_names)/sizeof(fault_names[0]);
+
+const char *const type_names[] = {
+  "unknown",
+  "undefined",
+  "null",
+  "boolean",
+  "integer",
+  "float",
+  "string",
+  "array",
+  "function"
+};
+const size_t type_name_count = sizeof(type_names)/sizeof(type_names[0]);
@@ -1,6 +1,8 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
 
 #include <fcntl.h>
 #include <sys/stat.h>
@@ -10,38 +12,9 @@
 
 #include <sinter.h>
 
-#define eprintf(...) fprintf(stderr, __VA_ARGS__)
+#include "runner.h"
 
-static const char *fault_names[] = {
-  "no fault",
-  "out of memory",
-  "type error",
-  "divide by zero",
-  "stack overflow",
-  "stack underflow",
-  "uninitialised load",
-  "invalid load",
-  "invalid program",
-  "internal error",
-  "incorrect function arity",
-  "program called error()",
-  "uninitialised heap"
-};
-
-static const char *type_names[] = {
-  "unknown",
-  "undefined",
-  "null",
-  "boolean",
-  "integer",
-  "float",
-  "string",
-  "array",
-  "function"
-};
-
-void setup_internals(void);
-void display_object_result(sinter_value_t *res, _Bool is_error);
+#define eprintf(...) fprintf(stderr, __VA_ARGS__)
 
 ssize_t check_posix(ssize_t result, const char *msg) {
   if (result == -1 && errno) {
@@ -62,7 +35,7 @@ static void print_integer(int32_t v, bool is_error) {
   printf("%d", v);
 }
 
-static void print_float(float v, bool is_error) {
+static void print_float(sinter_float_t v, bool is_error) {
   (void) is_error;
   printf("%f", v);
 }
@@ -72,20 +45,229 @@ static void print_flush(bool is_error) {
   printf("\n");
 }
 
+static void print_result(const char *what, sinter_fault_t fault, sinter_value_t *result) {
+  printf("%s exited with fault %s and result type %s: ", what, FAULT_NAME(fault), TYPE_NAME(result->type));
+
+  switch (result->type) {
+  case sinter_type_undefined:
+    printf("undefined");
+    break;
+  case sinter_type_null:
+    printf("null");
+    break;
+  case sinter_type_boolean:
+    printf("%s", result->boolean_value ? "true" : "false");
+    break;
+  case sinter_type_integer:
+    printf("%d", result->integer_value);
+    break;
+  case sinter_type_float:
+    printf("%f", result->float_value);
+    break;
+  case sinter_type_string:
+    printf("%s", result->string_value);
+    break;
+  case sinter_type_array:
+  case sinter_type_function:
+    display_object_result(result, false);
+    break;
+  default:
+    printf("(unable to print value)");
+    break;
+  }
+
+  printf("\n");
+}
+
+static sinter_value_t parse_value(char *str) {
+  sinter_value_t value = { .type = sinter_type_string, .string_value = str };
+  if (!strcmp(str, "undefined")) {
+    value.type = sinter_type_undefined;
+  } else if (!strcmp(str, "null")) {
+    value.type = sinter_type_null;
+  } else if (!strcmp(str, "true") || !strcmp(str, "false")) {
+    value.type = sinter_type_boolean;
+    value.boolean_value = str[0] == 't';
+  } else if (*str) {
+    char *end;
+    const long integer = strtol(str, &end, 10);
+    if (!*end && integer >= INT32_MIN && integer <= INT32_MAX) {
+      value.type = sinter_type_integer;
+      value.integer_value = (int32_t) integer;
+      return value;
+    }
+    const double number = strtod(str, &end);
+    if (!*end) {
+      value.type = sinter_type_float;
+      value.float_value = (sinter_float_t) number;
+    }
+  }
+  return value;
+}
+
+/**
+ * Parses a call to a global function of the loaded program, given as
+ * <index>[,<argument>...], into the arguments. Returns the index.
+ */
+static uint8_t parse_call(char *spec, sinter_value_t *args, uint8_t *argc) {
+  *argc = 0;
+  const char *index_str = strtok(spec, ",");
+  const uint8_t index = index_str ? (uint8_t) strtoul(index_str, NULL, 10) : 0;
+  for (char *arg = strtok(NULL, ","); arg && *argc < UINT8_MAX; arg = strtok(NULL, ",")) {
+    args[(*argc)++] = parse_value(arg);
+  }
+  return index;
+}
+
+/**
+ * Calls a global function of the loaded program (see parse_call); if arena is
+ * true, with sinter_call_arena.
+ */
+static void call_global(char *spec, bool arena) {
+  sinter_value_t args[UINT8_MAX];
+  uint8_t argc;
+  const uint8_t index = parse_call(spec, args, &argc);
+
+  sinter_value_t fn = { 0 };
+  sinter_value_t result = { 0 };
+  sinter_fault_t fault = sinter_get_global(index, &fn);
+  if (fault == sinter_fault_none) {
+#ifdef SINTER_ARENA
+    fault = arena ? sinter_call_arena(&fn, argc, args, &result) : sinter_call(&fn, argc, args, &result);
+#else
+    (void) arena;
+    fault = sinter_call(&fn, argc, args, &result);
+#endif
+  }
+  char what[32];
+  snprintf(what, sizeof(what), "Call to global %u", index);
+  print_result(what, fault, &result);
+}
+
+#ifdef SINTER_TASKS
+/**
+ * Spawns a task for each of the specs (see parse_call), then runs them all,
+ * each for budget instructions at a time.
+ */
+static void run_tasks(char **specs, size_t count, uint32_t budget) {
+  for (size_t i = 0; i < count; ++i) {
+    sinter_value_t args[UINT8_MAX];
+    uint8_t argc;
+    const uint8_t index = parse_call(specs[i], args, &argc);
+
+    sinter_value_t fn = { 0 };
+    unsigned int task;
+    sinter_fault_t fault = sinter_get_global(index, &fn);
+    if (fault == sinter_fault_none) {
+      fault = sinter_task_spawn(&fn, argc, args, &task);
+    }
+    if (fault != sinter_fault_none) {
+      printf("Spawning a task for global %u failed with fault %s\n", index, FAULT_NAME(fault));
+      return;
+    }
+  }
+
+  while (true) {
+    int task;
+    sinter_value_t result;
+    task_timers_run(false);
+    const sinter_fault_t fault = sinter_task_step(budget, &task, &result);
+    if (fault == sinter_fault_busy && task < 0) {
+      // every task is waiting
+      if (task_timers_run(true)) {
+        continue;
+      }
+      printf("Every task is waiting, with nothing to resume them\n");
+      break;
+    }
+    if (task < 0) {
+      break;
+    }
+    if (fault != sinter_fault_none || result.type) {
+      char what[32];
+      snprintf(what, sizeof(what), "Task %d", task);
+      print_result(what, fault, &result);
+    }
+  }
+}
+#endif
+
 int main(int argc, char *argv[]) {
-  if (argc < 2) {
-    eprintf("Usage: %s <program>\n", argv[0]);
+  bool print_stats = false;
+  // the --call options, which load the program, then call its global functions
+  char **calls = calloc(argc, sizeof(char *));
+  size_t call_count = 0;
+  // snapshot files to save the loaded program to after the calls, and to load
+  // it from instead of running it
+  const char *save_snapshot = NULL;
+  const char *load_snapshot = NULL;
+  // whether to restore the state after loading before every call
+  bool reset = false;
+  // whether to make the calls with sinter_call_arena
+  bool arena = false;
+  // the --chunk options, which are loaded into the program after it is loaded
+  char **chunks = calloc(argc, sizeof(char *));
+  size_t chunk_count = 0;
+#ifdef SINTER_TASKS
+  // the --task options, which are spawned after the chunks are loaded, and
+  // run (--budget instructions at a time) before the calls
+  char **tasks = calloc(argc, sizeof(char *));
+  size_t task_count = 0;
+  uint32_t budget = 1000;
+#endif
+  int arg = 1;
+  for (; arg < argc - 1; ++arg) {
+    if (!strcmp(argv[arg], "--stats")) {
+      print_stats = true;
+    } else if (!strcmp(argv[arg], "--call") && arg + 2 < argc) {
+      calls[call_count++] = argv[++arg];
+    } else if (!strcmp(argv[arg], "--chunk") && arg + 2 < argc) {
+      chunks[chunk_count++] = argv[++arg];
+#ifdef SINTER_TASKS
+    } else if (!strcmp(argv[arg], "--task") && arg + 2 < argc) {
+      tasks[task_count++] = argv[++arg];
+    } else if (!strcmp(argv[arg], "--budget") && arg + 2 < argc) {
+      budget = (uint32_t) strtoul(argv[++arg], NULL, 10);
+#endif
+    } else if (!strcmp(argv[arg], "--reset")) {
+      reset = true;
+#ifdef SINTER_ARENA
+    } else if (!strcmp(argv[arg], "--arena")) {
+      arena = true;
+#endif
+    } else if (!strcmp(argv[arg], "--save-snapshot") && arg + 2 < argc) {
+      save_snapshot = argv[++arg];
+    } else if (!strcmp(argv[arg], "--load-snapshot") && arg + 2 < argc) {
+      load_snapshot = argv[++arg];
+    } else {
+      break;
+    }
+  }
+
+  if (arg != argc - 1) {
+#ifdef SINTER_TASKS
+#define TASK_USAGE " [--budget <instructions>] [--task <global>[,<argument>...]]..."
+#else
+#define TASK_USAGE ""
+#endif
+#ifdef SINTER_ARENA
+#define ARENA_USAGE " [--arena]"
+#else
+#define ARENA_USAGE ""
+#endif
+    eprintf("Usage: %s [--stats] [--reset]" ARENA_USAGE " [--chunk <file>]..." TASK_USAGE " [--call <global>[,<argument>...]]... [--save-snapshot <file>] [--load-snapshot <file>] <program>\n", argv[0]);
     return 1;
   }
 
-  int program_fd = check_posix(open(argv[1], O_RDONLY), "Failed to open program");
+  int program_fd = check_posix(open(argv[arg], O_RDONLY), "Failed to open program");
   off_t size;
   {
     struct stat stat_buf;
     check_posix(fstat(program_fd, &stat_buf), "fstat failed");
     size = stat_buf.st_size;
   }
-  const unsigned char *program = mmap(NULL, size, PROT_READ, MAP_SHARED, program_fd, 0);
+  // a private mapping, so the VM can rewrite the program in memory (see SINTER_QUICKEN)
+  unsigned char *program = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, program_fd, 0);
   if (program == MAP_FAILED) {
     check_posix(-1, "mmap failed");
   }
@@ -97,42 +279,154 @@ int main(int argc, char *argv[]) {
 
   setup_internals();
 
+#ifndef SINTER_STATIC_HEAP
+  void *heap = malloc(RUNNER_HEAP_SIZE);
+  if (!heap) {
+    check_posix(-1, "Failed to allocate heap");
+  }
+  sinter_setup_heap(heap, RUNNER_HEAP_SIZE);
+#endif
+
+#ifdef SINTER_INLINE_CALLS
+  // inlining needs room for the program to grow
+  const size_t buffer_size = 2 * (size_t) size;
+  unsigned char *buffer = malloc(buffer_size);
+  if (!buffer) {
+    check_posix(-1, "Failed to allocate program buffer");
+  }
+  memcpy(buffer, program, size);
+  munmap(program, size);
+  program = buffer;
+  const size_t inlined_size = sinter_inline_calls(program, size, buffer_size);
+  if (print_stats) {
+    eprintf("Inlining changed the program size from %zu to %zu bytes\n", (size_t) size, inlined_size);
+  }
+  size = (off_t) inlined_size;
+#endif
+
+  // chunks must be after the program in memory, so they are read into one
+  // buffer with it
+  size_t *chunk_sizes = calloc(chunk_count + 1, sizeof(size_t));
+  if (chunk_count) {
+    size_t total_size = size;
+    for (size_t i = 0; i < chunk_count; ++i) {
+      struct stat stat_buf;
+      check_posix(stat(chunks[i], &stat_buf), "Failed to stat chunk");
+      chunk_sizes[i] = stat_buf.st_size;
+      total_size += chunk_sizes[i];
+    }
+    unsigned char *buffer = malloc(total_size);
+    if (!buffer) {
+      check_posix(-1, "Failed to allocate program buffer");
+    }
+    memcpy(buffer, program, size);
+    size_t offset = size;
+    for (size_t i = 0; i < chunk_count; ++i) {
+      int chunk_fd = check_posix(open(chunks[i], O_RDONLY), "Failed to open chunk");
+      if (read(chunk_fd, buffer + offset, chunk_sizes[i]) != (ssize_t) chunk_sizes[i]) {
+        check_posix(-1, "Failed to read chunk");
+      }
+      close(chunk_fd);
+      offset += chunk_sizes[i];
+    }
+    program = buffer;
+  }
+
+  bool load = call_count || chunk_count || save_snapshot;
+#ifdef SINTER_TASKS
+  load = load || task_count;
+#endif
   sinter_value_t result = { 0 };
-  sinter_fault_t fault = sinter_run(program, size, &result);
+  sinter_fault_t fault;
+  if (load_snapshot) {
+    int snapshot_fd = check_posix(open(load_snapshot, O_RDONLY), "Failed to open snapshot");
+    struct stat stat_buf;
+    check_posix(fstat(snapshot_fd, &stat_buf), "fstat failed");
+    // the VM copies the snapshot to the heap, so a read-only mapping will do
+    void *snapshot = mmap(NULL, stat_buf.st_size, PROT_READ, MAP_PRIVATE, snapshot_fd, 0);
+    if (snapshot == MAP_FAILED) {
+      check_posix(-1, "mmap failed");
+    }
+    fault = sinter_snapshot_load_mutable(program, size, snapshot, stat_buf.st_size, &result);
+    munmap(snapshot, stat_buf.st_size);
+    close(snapshot_fd);
+  } else {
+#ifdef SINTER_REENTRANT
+    // run the program on its own instance, to exercise the instance API
+    sinter_vm_t *vm = sinter_vm_create(RUNNER_HEAP_SIZE, NULL);
+    if (!vm) {
+      check_posix(-1, "Failed to create VM");
+    }
+    fault = load ? sinter_vm_load_mutable(vm, program, size, &result) : sinter_vm_run_mutable(vm, program, size, &result);
+#else
+    fault = load ? sinter_load_mutable(program, size, &result) : sinter_run_mutable(program, size, &result);
+#endif
+  }
 
-  printf("Program exited with fault %s and result type %s: ",
-    fault >= (sizeof(fault_names)/sizeof(fault_names[0])) ? "(unknown fault)" : fault_names[fault],
-    result.type >= (sizeof(type_names)/sizeof(type_names[0])) ? "(unknown type)" : type_names[result.type]);
+  if (print_stats) {
+#ifdef SINTER_QUICKEN
+    const sinter_quicken_stats_t *stats = &sinter_quicken_stats;
+    const uint64_t total = (uint64_t) stats->hits + stats->deopts + stats->generic;
+    eprintf("Quickened %" PRIu32 " instructions; %" PRIu32 " hits, %" PRIu32 " deopts, %" PRIu32 " generic (hit rate %.1f%%)\n",
+      stats->quickened, stats->hits, stats->deopts, stats->generic, total ? 100.0 * stats->hits / total : 0.0);
+#else
+    eprintf("Quickening is disabled (SINTER_QUICKEN is not set)\n");
+#endif
+  }
 
-  switch (result.type) {
-  case sinter_type_undefined:
-    printf("undefined");
-    break;
-  case sinter_type_null:
-    printf("null");
-    break;
-  case sinter_type_boolean:
-    printf("%s", result.boolean_value ? "true" : "false");
-    break;
-  case sinter_type_integer:
-    printf("%d", result.integer_value);
-    break;
-  case sinter_type_float:
-    printf("%f", result.float_value);
-    break;
-  case sinter_type_string:
-    printf("%s", result.string_value);
-    break;
-  case sinter_type_array:
-  case sinter_type_function:
-    display_object_result(&result, false);
-    break;
-  default:
-    printf("(unable to print value)");
-    break;
+  print_result("Program", fault, &result);
+
+  unsigned char *chunk = program + size;
+  for (size_t i = 0; i < chunk_count; ++i) {
+    result = (sinter_value_t) { 0 };
+    fault = sinter_load_chunk(chunk, chunk_sizes[i], &result);
+    char what[32];
+    snprintf(what, sizeof(what), "Chunk %zu", i + 1);
+    print_result(what, fault, &result);
+    chunk += chunk_sizes[i];
   }
 
-  printf("\n");
+#ifdef SINTER_TASKS
+  if (task_count && fault == sinter_fault_none) {
+    run_tasks(tasks, task_count, budget);
+  }
+#endif
+
+  void *checkpoint = NULL;
+  size_t checkpoint_size = 0;
+  if (reset && fault == sinter_fault_none) {
+    checkpoint_size = sinter_checkpoint_size();
+    checkpoint = malloc(checkpoint_size);
+    if (!checkpoint) {
+      check_posix(-1, "Failed to allocate checkpoint");
+    }
+    sinter_checkpoint_save(checkpoint, checkpoint_size);
+  }
+
+  for (size_t i = 0; i < call_count; ++i) {
+    if (checkpoint && i) {
+      sinter_checkpoint_restore(checkpoint, checkpoint_size);
+    }
+    call_global(calls[i], arena);
+  }
+
+  if (save_snapshot) {
+    const size_t snapshot_size = sinter_snapshot_size();
+    void *snapshot = malloc(snapshot_size ? snapshot_size : 1);
+    if (!snapshot) {
+      check_posix(-1, "Failed to allocate snapshot");
+    }
+    const sinter_fault_t snapshot_fault = snapshot_size ? sinter_snapshot_save(snapshot, snapshot_size) : sinter_fault_not_loaded;
+    if (snapshot_fault != sinter_fault_none) {
+      eprintf("Failed to save snapshot: %s\n", FAULT_NAME(snapshot_fault));
+      return 1;
+    }
+    int snapshot_fd = check_posix(open(save_snapshot, O_WRONLY | O_CREAT | O_TRUNC, 0644), "Failed to open snapshot");
+    if (write(snapshot_fd, snapshot, snapshot_size) != (ssize_t) snapshot_size) {
+      check_posix(-1, "Failed to write snapshot");
+    }
+    close(snapshot_fd);
+  }
 
   return 0;
 }
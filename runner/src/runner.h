@@ -0,0 +1,39 @@
+#ifndef RUNNER_H
+#define RUNNER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <sinter.h>
+
+#ifndef RUNNER_HEAP_SIZE
+// the largest heap a 32-bit NaN-box can address
+#define RUNNER_HEAP_SIZE 0x2000000
+#endif
+
+extern const char *const fault_names[];
+extern const size_t fault_name_count;
+extern const char *const type_names[];
+extern const size_t type_name_count;
+
+#define FAULT_NAME(fault) ((size_t) (fault) < fault_name_count ? fault_names[fault] : "(unknown fault)")
+#define TYPE_NAME(type) ((size_t) (type) < type_name_count ? type_names[type] : "(unknown type)")
+
+void setup_internals(void);
+void display_object_result(sinter_value_t *res, _Bool is_error);
+
+#ifdef SINTER_TASKS
+/**
+ * Resumes the given task (suspended with sinter_task_suspend) after ms
+ * milliseconds, when task_timers_run is next called.
+ */
+void task_timer_start(unsigned int task, uint32_t ms);
+
+/**
+ * Resumes the tasks whose timers have ended. If wait is true, first waits for
+ * the earliest timer to end. Returns whether any task was resumed.
+ */
+_Bool task_timers_run(_Bool wait);
+#endif
+
+#endif
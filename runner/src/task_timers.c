@@ -0,0 +1,58 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <sinter.h>
+#include <sinter/config.h>
+
+#include "runner.h"
+
+// when each task suspended by a timer is to be resumed, in milliseconds of the
+// monotonic clock, or 0 if the task has no timer
+static uint64_t resume_at[SINTER_MAX_TASKS];
+
+static uint64_t now_ms(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t) now.tv_sec * 1000 + (uint64_t) now.tv_nsec / 1000000;
+}
+
+void task_timer_start(unsigned int task, uint32_t ms) {
+  // 0 means no timer, so a timer that ends at 0 ends a millisecond later
+  const uint64_t at = now_ms() + ms;
+  resume_at[task] = at ? at : 1;
+}
+
+bool task_timers_run(bool wait) {
+  unsigned int earliest = SINTER_MAX_TASKS;
+  for (unsigned int i = 0; i < SINTER_MAX_TASKS; ++i) {
+    if (resume_at[i] && (earliest == SINTER_MAX_TASKS || resume_at[i] < resume_at[earliest])) {
+      earliest = i;
+    }
+  }
+  if (earliest == SINTER_MAX_TASKS) {
+    return false;
+  }
+
+  const uint64_t now = now_ms();
+  if (wait && resume_at[earliest] > now) {
+    const uint64_t ms = resume_at[earliest] - now;
+    nanosleep(&(struct timespec){.tv_sec = (time_t) (ms / 1000), .tv_nsec = (long) (ms % 1000) * 1000000}, NULL);
+  }
+
+  // resume every task whose timer has ended, or at least the earliest one if
+  // waiting for it
+  const uint64_t until = wait && resume_at[earliest] > now ? resume_at[earliest] : now;
+  const sinter_value_t undefined = { .type = sinter_type_undefined };
+  bool resumed = false;
+  for (unsigned int i = 0; i < SINTER_MAX_TASKS; ++i) {
+    if (resume_at[i] && resume_at[i] <= until) {
+      resume_at[i] = 0;
+      sinter_task_resume(i, &undefined);
+      resumed = true;
+    }
+  }
+  return resumed;
+}
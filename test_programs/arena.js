@@ -0,0 +1,53 @@
+// Called with sinter_call_arena (runner --arena): handle's list and array are
+// garbage when it returns, and only what it stores into totals, and returns,
+// must be kept.
+let totals = null;
+let calls = 0;
+
+function handle(n) {
+  let xs = null;
+  let i = 0;
+  while (i < n) {
+    xs = pair(i, xs);
+    i = i + 1;
+  }
+  let sum = 0;
+  while (xs !== null) {
+    sum = sum + head(xs);
+    xs = tail(xs);
+  }
+  const arr = [];
+  i = 0;
+  while (i < n) {
+    arr[i] = i;
+    i = i + 1;
+  }
+  i = 0;
+  while (i < n) {
+    sum = sum + arr[i];
+    i = i + 1;
+  }
+  totals = pair(sum, totals);
+  calls = calls + 1;
+  return pair(calls, sum);
+}
+
+function total() {
+  let xs = totals;
+  let sum = 0;
+  while (xs !== null) {
+    sum = sum + head(xs);
+    xs = tail(xs);
+  }
+  return sum;
+}
+
+// allocates nothing but garbage
+function churn(n) {
+  let i = 0;
+  while (i < n) {
+    pair(i, i);
+    i = i + 1;
+  }
+  return n;
+}
@@ -0,0 +1,24 @@
+// A benchmark of string equality: member and remove on a list of keys that
+// share a long prefix, built by concatenation. Not run as a test.
+const prefix = "key-key-key-key-key-key-key-key-key-key-key-key-key-key-key-key-key-key-key-key-key-key-key-key-key-";
+
+function key(n, bits, s) {
+  return bits === 0 ? s : key(math_floor(n / 2), bits - 1, s + (n % 2 === 0 ? "a" : "b"));
+}
+
+function keys(n, acc) {
+  return n === 0 ? acc : keys(n - 1, pair(key(n - 1, 10, prefix), acc));
+}
+
+function count(xs, ks, acc) {
+  return is_null(ks) ? acc : count(xs, tail(ks), member(head(ks), xs) === null ? acc : acc + 1);
+}
+
+const xs = keys(1000, null);
+display(count(xs, xs, 0));
+const ys = remove(key(500, 10, prefix), xs);
+display(length(ys));
+display(member(key(500, 10, prefix), ys));
+display(head(member(key(999, 10, prefix), xs)));
+
+count(ys, xs, 0);
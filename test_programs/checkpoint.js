@@ -0,0 +1,10 @@
+let total = 0;
+const seen = [];
+
+function record(x) {
+  seen[array_length(seen)] = x;
+  total = total + x;
+  return array_length(seen) * 1000 + total;
+}
+
+total;
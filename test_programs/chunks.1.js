@@ -0,0 +1,8 @@
+// loaded after chunks.js, in a scope nested in its top level
+const base = add(5);
+
+function scaled(x) {
+  return x > 0 ? base * x : "none";
+}
+
+scaled(0);
@@ -0,0 +1,6 @@
+// loaded after chunks.1.js
+function total(y) {
+  return scaled(y) + count + base;
+}
+
+add(1);
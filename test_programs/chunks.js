@@ -0,0 +1,10 @@
+let count = 0;
+
+function add(x) {
+  count = count + x;
+  return count;
+}
+
+// the last load of add here must not move it out of the globals, which the
+// chunks go on to read
+add(0);
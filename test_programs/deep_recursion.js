@@ -0,0 +1,5 @@
+function f(n) {
+  return n === 0 ? 0 : f(n - 1) + 1;
+}
+
+f(100000);
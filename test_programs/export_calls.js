@@ -0,0 +1,22 @@
+let count = 0;
+
+function handler(x) {
+  count = count + 1;
+  return x * 10 + count;
+}
+
+function greet(s) {
+  return "hello " + s;
+}
+
+function pair_with_count(x) {
+  return [x, count];
+}
+
+function tail(x) {
+  return handler(x);
+}
+
+const show = display;
+
+count;
@@ -0,0 +1,26 @@
+// export_calls, with the last top-level loads of the globals before the calls,
+// which SINTER_SPECIALISE (the runner loads programs with sinter_load_mutable)
+// must not move out of the program's environment
+let count = 0;
+
+function handler(x) {
+  count = count + 1;
+  return x * 10 + count;
+}
+
+function greet(s) {
+  return "hello " + s;
+}
+
+function pair_with_count(x) {
+  return [x, count];
+}
+
+function tail(x) {
+  return handler(x);
+}
+
+const show = display;
+
+show(greet("world"));
+tail(0);
@@ -0,0 +1,16 @@
+display(0.1 + 0.2);
+display(1.5 * 2.5);
+display(7 / 2);
+display(-1 / 3);
+display(5.5 % 2);
+display(-5.5 % 2);
+display(3 < 3.25);
+display(0.5 + 0.5 === 1);
+display(-(0.25 - 1));
+display(math_sqrt(2));
+display(math_floor(-2.5));
+display(16000.5 + 1000);
+display(-16000.5 * 2);
+display(1000000 + 0.5);
+display(1 / 0);
+1 % 0;
@@ -0,0 +1,11 @@
+const a = [];
+let i = 0;
+while (i < 200000) {
+  a[i] = pair(i, i * 2);
+  i = i + 1;
+}
+display(array_length(a));
+display(head(a[0]));
+display(tail(a[199999]));
+display(a[100000]);
+tail(a[12345]);
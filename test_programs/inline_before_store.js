@@ -0,0 +1,9 @@
+// g calls f before f is declared, so the call must still fault, even where
+// SINTER_INLINE_CALLS would otherwise inline f into g
+function g(x) {
+  return f(x) + 1;
+}
+
+map(g, list(1));
+const f = x => x * 2;
+f(2);
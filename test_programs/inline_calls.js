@@ -0,0 +1,50 @@
+function square(x) {
+  return x * x;
+}
+
+function abs(x) {
+  return x < 0 ? -x : x;
+}
+
+function add3(a, b, c) {
+  const s = a + b;
+  return s + c;
+}
+
+function bump() {
+  counter = counter + 1;
+}
+
+function twice(f, x) {
+  return f(f(x));
+}
+
+// the calls are made from a block environment, and the call to square
+// is an argument to the call to abs
+function sum_squares(n) {
+  let i = 0;
+  let s = 0;
+  while (i < n) {
+    const v = i - 5;
+    s = s + square(abs(v));
+    i = i + 1;
+  }
+  return s;
+}
+
+// recursive, so not inlined
+function fact(n) {
+  return n === 0 ? 1 : n * fact(n - 1);
+}
+
+let counter = 0;
+
+display(square(7));
+display(abs(-3));
+display(add3(1, 2, 3));
+bump();
+bump();
+display(counter);
+display(twice(square, 3));
+display(sum_squares(20));
+fact(5);
@@ -0,0 +1,15 @@
+function build(n, acc) {
+  return n === 0 ? acc : build(n - 1, pair(n, acc));
+}
+
+// xs is dead once its length is taken, so only one of the two lists needs to
+// fit in the heap at a time
+function sum_twice(n) {
+  const xs = build(n, null);
+  const l = length(xs);
+  const ys = build(n, null);
+  return length(ys) + l;
+}
+
+display(sum_twice(600));
+sum_twice(600);
@@ -0,0 +1,9 @@
+display(16777216 + 1 === 16777217);
+display(0.1 + 0.2 === 0.30000000000000004);
+display(2147483647 + 1);
+display(-2147483647 - 1);
+display(-(-2147483647 - 1));
+display(math_abs(-2147483647 - 1));
+display(65536 * 65536);
+display(math_fround(0.1) === 0.10000000149011612);
+123456789 * 10;
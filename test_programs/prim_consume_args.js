@@ -0,0 +1,16 @@
+const s = "ab";
+const p = pair(s, "cd", "extra");
+display(p);
+set_head(p, p);
+display(head(p) === p);
+set_tail(p, s + "!");
+display(tail(p));
+set_head(p, null, "extra");
+display(p);
+set_tail(pair(1, 2), list(s, s));
+const xs = list(s, "x", pair(s, s));
+display(xs);
+const st = stream(s, "y", "z");
+display(stream_to_list(st));
+display(accumulate(pair, null, list(s, "q")));
+head(stream("only"));
@@ -0,0 +1,44 @@
+// map, filter, accumulate, build_list and for_each run the functions they call
+// from the main loop: nest them, call them in tail position and with
+// primitives, and collect the heap while they run
+
+function square(x) {
+  return x * x;
+}
+
+function add(x, acc) {
+  return x + acc;
+}
+
+function sum(xs) {
+  return accumulate(add, 0, xs);
+}
+
+function row(i) {
+  return build_list(i + 1, j => i * j);
+}
+
+function heads(xs) {
+  return map(head, xs);
+}
+
+function big(xs) {
+  return sum(xs) > 5;
+}
+
+function centre(i) {
+  return i - 100;
+}
+
+display(map(sum, build_list(4, row)));
+display(filter(big, map(xs => map(square, xs), build_list(3, row))));
+display(heads(list(pair(1, 2), pair(3, 4))));
+for_each(display, enum_list(1, 2));
+
+let total = 0;
+let i = 0;
+while (i < 10) {
+  total = total + sum(map(centre, build_list(200, centre)));
+  i = i + 1;
+}
+display(total);
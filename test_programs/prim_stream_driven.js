@@ -0,0 +1,22 @@
+// stream_for_each, stream_to_list, stream_member, stream_length, stream_ref,
+// stream_reverse, eval_stream and is_stream call functions, and the tails of
+// streams, from the main loop: use streams whose tails are functions of the
+// program
+
+function from(n) {
+  return pair(n, () => from(n + 1));
+}
+
+function upto(n, m) {
+  return n > m ? null : pair(n, () => upto(n + 1, m));
+}
+
+display(eval_stream(from(1), 3));
+display(stream_to_list(upto(1, 4)));
+display(stream_length(upto(1, 300)));
+display(stream_ref(from(0), 200));
+display(head(stream_member(50, from(0))));
+display(stream_member(5, upto(1, 3)));
+display(stream_to_list(stream_reverse(upto(1, 3))));
+display(is_stream(upto(1, 3)));
+stream_for_each(x => display(x * x), upto(1, 2));
@@ -0,0 +1,28 @@
+function ops(a, b) {
+  return list(a + b, a - b, a * b, a < b, a > b, a <= b, a >= b, a === b, a !== b);
+}
+
+function repeat(a, b, n) {
+  if (n > 0) {
+    display(ops(a, b));
+    return repeat(a, b, n - 1);
+  } else {
+    return undefined;
+  }
+}
+
+function strings(a, b) {
+  return list(a + b, a < b, a === b);
+}
+
+repeat(3, 2, 5);
+repeat(1.5, 0.25, 5);
+repeat(2, 0.5, 2);
+repeat(-7, -7, 5);
+repeat(0 / 0, 0 / 0, 1);
+display(strings(1, 2));
+display(strings(1, 2));
+display(strings(1, 2));
+display(strings(1, 2));
+display(strings(1, 2));
+strings("ab", "cd");
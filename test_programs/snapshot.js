@@ -0,0 +1,24 @@
+let count = 0;
+
+const table = [];
+for (let i = 0; i < 10; i = i + 1) {
+  table[i] = i * i;
+}
+
+const greeting = "hello " + "world";
+const naturals = integers_from(1);
+
+function handler(i) {
+  count = count + 1;
+  return table[i] + count;
+}
+
+function greet() {
+  return greeting;
+}
+
+function nth(n) {
+  return stream_ref(naturals, n);
+}
+
+count;
@@ -0,0 +1,63 @@
+function count(n) {
+  let s = 0;
+  let i = 0;
+  while (i < n) {
+    s = s + i * 2;
+    i = i + 1;
+  }
+  return s / i - s % 7;
+}
+
+function counter() {
+  let c = 0;
+  function inc() {
+    c = "done";
+    return c;
+  }
+  inc();
+  display(c + "!");
+  c = 1;
+  return c;
+}
+
+function mixed(b) {
+  let x = 1;
+  if (b) {
+    x = "s";
+  } else {}
+  return x;
+}
+
+function blocks(n) {
+  let t = 0;
+  let i = 0;
+  while (i < n) {
+    const j = i * i;
+    t = t + j;
+    i = i + 1;
+  }
+  return t > 3 ? -t : t;
+}
+
+function arrays() {
+  let a = [1, 2, 3];
+  function reset() {
+    a = [7];
+    return 9;
+  }
+  a[1] = reset();
+  let b = [a[0], 2, 3];
+  b[1] = b[0] + b[2];
+  let c = undefined;
+  c = b;
+  return b[0] + b[1] + b[2] + c[1] + a[0];
+}
+
+display(count(10));
+display(count(2.5));
+display(counter());
+display(mixed(true));
+display(mixed(false));
+display(blocks(5));
+display(arrays());
+count(1000);
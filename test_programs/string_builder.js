@@ -0,0 +1,21 @@
+function wrap(s, n) {
+  return n === 0 ? s : wrap("(" + s + ")", n - 1);
+}
+
+display("a" + "b" + "c" + "d");
+display("s00" + "s01" + "s02" + "s03" + "s04" + "s05" + "s06" + "s07" + "s08" + "s09"
+  + "s10" + "s11" + "s12" + "s13" + "s14" + "s15" + "s16" + "s17" + "s18" + "s19"
+  + "s20" + "s21" + "s22" + "s23" + "s24" + "s25" + "s26" + "s27" + "s28" + "s29");
+
+const x = "x" + "y";
+display(x + "z");
+display(x);
+display("<" + x + ">" === "<xy>");
+display(wrap("-" + x + "-", 40));
+
+// y + "," is only referred to by the stack, so the rest is appended to it
+const y = x + "0123456789";
+display(y + "," + y + ";");
+display(y);
+
+"a" + x + "b" + "" + x;
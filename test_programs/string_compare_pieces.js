@@ -0,0 +1,10 @@
+display("ab" + "c" < "a" + "bd");
+display("a" + "b" + "c" <= "abc");
+display("a" + "b" + "c" >= "ab" + "c");
+display("ab" < "a" + "bc");
+display("a" + "bc" > "ab");
+display("x" + "yz" < "xy" + "z");
+display("" < "a");
+display("ab" + "cd" === "a" + "bcd");
+
+"ab" + "cd" === "a" + "bce";
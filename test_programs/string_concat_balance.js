@@ -0,0 +1,19 @@
+function repeat(s, piece, n) {
+  return n === 0 ? s : repeat(s + piece, piece, n - 1);
+}
+
+function prepend(s, piece, n) {
+  return n === 0 ? s : prepend(piece + s, piece, n - 1);
+}
+
+const a = repeat("", "ab", 200);
+const b = prepend("", "ab", 200);
+const c = repeat(a, "x", 10);
+
+display(a === b);
+display(repeat("", "c", 400) === a);
+display(repeat(c, "y", 100) === a + repeat("", "x", 10) + repeat("", "y", 100));
+display(repeat("<", "-", 40) + ">");
+display(a + "a" < b + "b");
+
+prepend("", "ab", 200) === a;
@@ -0,0 +1,20 @@
+function key(n, bits, s) {
+  return bits === 0 ? s : key(math_floor(n / 2), bits - 1, s + (n % 2 === 0 ? "a" : "b"));
+}
+
+function keys(n, acc) {
+  return n === 0 ? acc : keys(n - 1, pair(key(n - 1, 6, "k"), acc));
+}
+
+function count(xs, ks, acc) {
+  return is_null(ks) ? acc : count(xs, tail(ks), member(head(ks), xs) === null ? acc : acc + 1);
+}
+
+const xs = keys(64, null);
+display(count(xs, xs, 0));
+const ys = remove(key(32, 6, "k"), xs);
+display(length(ys));
+display(member(key(32, 6, "k"), ys));
+display(head(member(key(63, 6, "k"), xs)));
+
+count(ys, xs, 0);
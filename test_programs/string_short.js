@@ -0,0 +1,14 @@
+const a = "ab" + "cd";
+const b = a + "efgh";
+
+display(a);
+display(b);
+display(b + "i");
+display("i" + b);
+display(a === "a" + "bcd");
+display(a === "abcd");
+display(b < a + "efgi");
+display("" + a + "" === a);
+display(member("c" + "d", list("ab", "c" + "d", "ef")));
+
+b + b;
@@ -0,0 +1,38 @@
+function loop(n, acc) {
+  return n === 0 ? acc : loop(n - 1, acc + 2);
+}
+
+// each closure must see its own n, so the environment cannot be reused
+function closures(n, fs) {
+  return n === 0 ? fs : closures(n - 1, pair(() => n, fs));
+}
+
+function sum_closures(fs, acc) {
+  return is_null(fs) ? acc : sum_closures(tail(fs), acc + head(fs)());
+}
+
+// is_even and is_odd have the same shape, so each reuses the other's
+// environment
+function is_even(n) {
+  return n === 0 ? true : is_odd(n - 1);
+}
+
+function is_odd(n) {
+  return n === 0 ? false : is_even(n - 1);
+}
+
+// the tail call is made from a block environment
+function countdown(n) {
+  if (n > 0) {
+    const m = n - 1;
+    return countdown(m);
+  } else {
+    return "done";
+  }
+}
+
+display(loop(100000, 0));
+display(sum_closures(closures(100, null), 0));
+display(is_even(10001));
+display(countdown(1000));
+loop(10, 0);
@@ -0,0 +1,9 @@
+// run as tasks by the runner (--task); the functions for_each calls run in the
+// task's own main loop, so the tasks take turns between them
+
+function each(start, n) {
+  for_each(display, enum_list(start, start + n - 1));
+  return n;
+}
+
+undefined;
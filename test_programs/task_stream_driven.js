@@ -0,0 +1,14 @@
+// run as tasks by the runner (--task); the functions stream_for_each calls, and
+// the tails of the stream, run in the task's own main loop, so the tasks take
+// turns between them
+
+function upto(n, m) {
+  return n > m ? null : pair(n, () => upto(n + 1, m));
+}
+
+function each(start, n) {
+  stream_for_each(display, upto(start, start + n - 1));
+  return n;
+}
+
+undefined;
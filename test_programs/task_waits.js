@@ -0,0 +1,19 @@
+// run as tasks by the runner (--task); sleep is the runner's VM-internal
+// function 2, which suspends the task with sinter_task_suspend and resumes it
+// after the given number of milliseconds
+
+function sleeper(id, ms) {
+  display(id);
+  sleep(ms);
+  display(id + 1);
+  return sleep(ms);
+}
+
+function counter(start, n) {
+  for (let i = 0; i < n; i = i + 1) {
+    display(start + i);
+  }
+  return n * 10;
+}
+
+undefined;
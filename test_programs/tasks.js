@@ -0,0 +1,19 @@
+// run as tasks by the runner (--task); yield is the runner's VM-internal
+// function 1, which calls sinter_task_yield
+
+function counter(start, n) {
+  for (let i = 0; i < n; i = i + 1) {
+    display(start + i);
+  }
+  return n * 10;
+}
+
+function polite(start, n) {
+  for (let i = 0; i < n; i = i + 1) {
+    display(start + i);
+    yield();
+  }
+  return n * 10;
+}
+
+undefined;
@@ -5,6 +5,19 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "sinter_config.h"
+
+#ifdef SINTER_REENTRANT
+// each thread has its own VM state
+#ifdef __cplusplus
+#define SINTER_THREAD_LOCAL thread_local
+#else
+#define SINTER_THREAD_LOCAL _Thread_local
+#endif
+#else
+#define SINTER_THREAD_LOCAL
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -34,17 +47,33 @@ typedef enum {
   sinter_fault_function_arity = 10,
   sinter_fault_program_error = 11,
   sinter_fault_uninitialised_heap = 12,
-  sinter_fault_stopped = 13
+  sinter_fault_stopped = 13,
+  sinter_fault_not_loaded = 14,
+  sinter_fault_invalid_snapshot = 15,
+  sinter_fault_busy = 16
 } sinter_fault_t;
 
+/**
+ * The type of Source numbers that are not small integers.
+ *
+ * This is double if SINTER_NANBOX64 is defined, and float otherwise.
+ */
+#ifdef SINTER_NANBOX64
+typedef double sinter_float_t;
+typedef uint64_t sinter_object_t;
+#else
+typedef float sinter_float_t;
+typedef uint32_t sinter_object_t;
+#endif
+
 typedef struct {
   sinter_type_t type;
   union {
     bool boolean_value;
     int32_t integer_value;
-    float float_value;
+    sinter_float_t float_value;
     const char *string_value;
-    uint32_t object_value;
+    sinter_object_t object_value;
   };
 } sinter_value_t;
 
@@ -55,9 +84,348 @@ typedef struct {
  */
 sinter_fault_t sinter_run(const unsigned char *code, const size_t code_size, sinter_value_t *result);
 
+/**
+ * Runs a program that the VM may modify, e.g. one that has been copied to RAM.
+ *
+ * If SINTER_QUICKEN is defined, the VM rewrites instructions in the program as
+ * it runs, specialising them for the types of operands they have seen. The
+ * program must not be run by anything else at the same time, and can only be
+ * run again with sinter_run_mutable.
+ *
+ * If SINTER_SPECIALISE is defined, the VM first analyses the program, and
+ * rewrites instructions that only operate on numbers to unchecked ones.
+ *
+ * Otherwise, this is the same as sinter_run.
+ */
+sinter_fault_t sinter_run_mutable(unsigned char *code, const size_t code_size, sinter_value_t *result);
+
+/**
+ * Loads a program: runs it like sinter_run, but keeps its heap and global
+ * environment afterwards, so that the host can call the functions it defines
+ * with sinter_call.
+ *
+ * The program stays loaded until it faults, or until another program is run or
+ * loaded (including with sinter_inline_calls).
+ */
+sinter_fault_t sinter_load(const unsigned char *code, const size_t code_size, sinter_value_t *result);
+
+/**
+ * Loads a program that the VM may modify, like sinter_run_mutable.
+ */
+sinter_fault_t sinter_load_mutable(unsigned char *code, const size_t code_size, sinter_value_t *result);
+
+/**
+ * Gets a global (a name declared at the top level) of the loaded program.
+ *
+ * SVML programs do not contain names, so globals are looked up by their index
+ * in the program's top-level environment, as assigned by the compiler.
+ *
+ * Object values are valid until the global is reassigned, or until the
+ * program is unloaded.
+ */
+sinter_fault_t sinter_get_global(const uint8_t index, sinter_value_t *value);
+
+/**
+ * Calls a function of the loaded program, e.g. one from sinter_get_global, with
+ * the given arguments.
+ *
+ * Strings in the arguments are copied to the heap; arrays and functions must
+ * be values returned by the VM. Object results are valid until the next call.
+ *
+ * If the call faults, the program is unloaded.
+ */
+sinter_fault_t sinter_call(const sinter_value_t *fn, const uint8_t argc, const sinter_value_t *argv, sinter_value_t *result);
+
+#ifdef SINTER_ARENA
+/**
+ * Calls a function of the loaded program like sinter_call, but takes the
+ * allocations of the call in turn from an arena: the largest free block of
+ * the heap. Freeing an object in the arena does nothing until the call
+ * returns, when the free parts of the arena are returned to the free list at
+ * once. Objects that are still referenced (e.g. by globals, or the result)
+ * stay where they are.
+ *
+ * This suits e.g. event handlers, whose allocations are mostly dead by the
+ * time they return. If the arena runs out, the rest of the call allocates
+ * from the heap as usual; if the heap runs out, the arena is closed first.
+ */
+sinter_fault_t sinter_call_arena(const sinter_value_t *fn, const uint8_t argc, const sinter_value_t *argv, sinter_value_t *result);
+#endif
+
+/**
+ * Loads a chunk, i.e. another SVM program, into the loaded program without
+ * resetting the heap, and runs it, e.g. to run the next input of a REPL.
+ *
+ * The chunk runs in a new top-level environment whose parent is that of the
+ * loaded program (or of the last chunk), as if it were a block at the end of
+ * the program: it reaches earlier globals with op_ldp and op_stp, and declares
+ * its own in its environment, which sinter_get_global then looks up.
+ *
+ * The chunk is relocated in place, so it must be writable, can only be loaded
+ * once, and must be placed after the program and earlier chunks in memory,
+ * within 4 GiB of the start of the program, e.g. by appending it to the buffer
+ * holding the program. Snapshots then need that buffer to be loaded.
+ *
+ * The result is as for sinter_call. If the chunk faults, the program is
+ * unloaded.
+ */
+sinter_fault_t sinter_load_chunk(unsigned char *chunk, const size_t chunk_size, sinter_value_t *result);
+
+/**
+ * Returns the size of a snapshot of the loaded program, or 0 if no program is
+ * loaded.
+ */
+size_t sinter_snapshot_size(void);
+
+/**
+ * Saves a snapshot of the loaded program, i.e. its heap and global environment,
+ * to the buffer, which must be at least sinter_snapshot_size() bytes.
+ *
+ * Loading the snapshot later with sinter_snapshot_load skips running the
+ * program again. Snapshots do not depend on where the heap or program is in
+ * memory, but can only be loaded with the same program, by a build of Sinter
+ * with the same configuration.
+ *
+ * Returns sinter_fault_busy if there are tasks (see sinter_task_spawn).
+ */
+sinter_fault_t sinter_snapshot_save(void *buffer, const size_t buffer_size);
+
+/**
+ * Loads a program from a snapshot saved with sinter_snapshot_save, as if it
+ * had been loaded with sinter_load. The result is that of the last call to the
+ * program before the snapshot was saved.
+ *
+ * The snapshot is copied to the heap, so it can be e.g. a read-only mapping of
+ * a file. The heap must be at least as large as the used part of the heap the
+ * snapshot was saved from.
+ */
+sinter_fault_t sinter_snapshot_load(const unsigned char *code, const size_t code_size,
+  const void *snapshot, const size_t snapshot_size, sinter_value_t *result);
+
+/**
+ * Loads a program that the VM may modify from a snapshot, like
+ * sinter_load_mutable.
+ */
+sinter_fault_t sinter_snapshot_load_mutable(unsigned char *code, const size_t code_size,
+  const void *snapshot, const size_t snapshot_size, sinter_value_t *result);
+
+/**
+ * Returns the size of a checkpoint of the loaded program, or 0 if no program
+ * is loaded.
+ */
+size_t sinter_checkpoint_size(void);
+
+/**
+ * Saves a checkpoint of the loaded program to the buffer, which must be at
+ * least sinter_checkpoint_size() bytes.
+ *
+ * A checkpoint is a copy of the used part of the heap, like a snapshot, but
+ * it is not relocatable: it can only be restored to the same heap and program
+ * in the same process. In return, restoring it is just a copy, so a program
+ * can be run over many inputs, each starting from the state after it was
+ * loaded, for little more than the cost of the calls.
+ *
+ * Returns sinter_fault_busy if there are tasks (see sinter_task_spawn).
+ */
+sinter_fault_t sinter_checkpoint_save(void *buffer, const size_t buffer_size);
+
+/**
+ * Restores a checkpoint saved with sinter_checkpoint_save, discarding the
+ * current state of the heap, and any tasks. This reloads the program, even if
+ * it has since faulted, but not if the heap has been set up again.
+ */
+sinter_fault_t sinter_checkpoint_restore(const void *buffer, const size_t buffer_size);
+
+#ifdef SINTER_TASKS
+/**
+ * Spawns a task, which calls a function of the loaded program (e.g. one from
+ * sinter_get_global) with the given arguments when it is first run by
+ * sinter_task_step. Sets *task to the number of the task.
+ *
+ * The function must be an SVML function. Tasks share the program's heap and
+ * globals, but each has a stack of its own, of SINTER_TASK_STACK_ENTRIES
+ * entries. Returns sinter_fault_busy if there are SINTER_MAX_TASKS tasks
+ * already.
+ */
+sinter_fault_t sinter_task_spawn(const sinter_value_t *fn, const uint8_t argc, const sinter_value_t *argv, unsigned int *task);
+
+/**
+ * Runs the next task, in turn, until it has run budget instructions (at least
+ * one), or yields (see sinter_task_yield), or returns. Sets *task to the
+ * number of the task, or to -1 if there are no tasks. If the task returned,
+ * *result is set to its result (as for sinter_call), and the task is removed;
+ * otherwise *result is zeroed. Tasks that are waiting (see sinter_task_suspend)
+ * are skipped; if every task is waiting, sets *task to -1 and returns
+ * sinter_fault_busy.
+ *
+ * A task yields only between instructions of its own, and not while e.g. a
+ * primitive such as map is calling a function. This needs no threads, so a
+ * host can run its tasks from its event loop.
+ *
+ * If the task faults, the program is unloaded, with all its tasks.
+ */
+sinter_fault_t sinter_task_step(const uint32_t budget, int *task, sinter_value_t *result);
+
+/**
+ * Returns the number of the running task, or -1 if no task is running.
+ */
+int sinter_task_current(void);
+
+/**
+ * Makes the running task yield once the current instruction is done, e.g.
+ * from a VM-internal function that waits for something. Does nothing if no
+ * task is running.
+ */
+void sinter_task_yield(void);
+
+/**
+ * Suspends the running task, from a VM-internal function that would otherwise
+ * block, e.g. to sleep or wait for a button. Returns the number of the task,
+ * which the host passes to sinter_task_resume once the result is ready. The
+ * task yields after the function returns, and does not run until then; the
+ * value the function returns is only a placeholder.
+ *
+ * Returns -1, and does nothing, if no task is running, or if the function was
+ * called by a primitive (e.g. map) rather than by the task itself. The function
+ * must then block as before.
+ */
+int sinter_task_suspend(void);
+
+/**
+ * Resumes a task suspended by sinter_task_suspend, with the given value as the
+ * result of the VM-internal function that suspended it. Does nothing if the
+ * task is not waiting. Like sinter_task_step, this must not be called while a
+ * task is running, e.g. from a VM-internal function.
+ */
+sinter_fault_t sinter_task_resume(const unsigned int task, const sinter_value_t *result);
+#endif
+
+#ifdef SINTER_INLINE_CALLS
+/**
+ * Inlines calls to small functions in a program, before it is run with
+ * sinter_run_mutable.
+ *
+ * The program is rewritten in place, and may grow to buffer_size bytes. Returns
+ * the new size of the program, which is code_size if nothing was inlined (or
+ * the heap is not set up).
+ */
+size_t sinter_inline_calls(unsigned char *code, const size_t code_size, const size_t buffer_size);
+#endif
+
+#ifdef SINTER_REENTRANT
+/**
+ * A VM instance, which owns a heap and the host's printer and VM-internal
+ * function hooks.
+ *
+ * Every thread has its own VM state, so instances can run on different threads
+ * at the same time. An instance must only run on one thread at a time.
+ */
+typedef struct sinter_vm sinter_vm_t;
+
+/**
+ * Creates a VM instance with a heap of the given size (see sinter_setup_heap).
+ *
+ * The instance uses the printer functions (sinter_printer_*) and VM-internal
+ * functions (sivmfn_vminternals) set on the calling thread when it is created.
+ *
+ * Returns NULL if out of memory.
+ */
+sinter_vm_t *sinter_vm_create(size_t heap_size, void *user_data);
+
+/**
+ * Runs a program on the VM instance, like sinter_run.
+ *
+ * This sets up the calling thread's VM state (the heap, printer functions and
+ * VM-internal functions) for the instance, and leaves it so afterwards, so
+ * that object results can be inspected (e.g. with sinter_printer_*) until the
+ * next run on the thread, or until the instance is destroyed. Call
+ * sinter_setup_heap etc. again before using sinter_run on the thread.
+ */
+sinter_fault_t sinter_vm_run(sinter_vm_t *vm, const unsigned char *code, const size_t code_size, sinter_value_t *result);
+
+/**
+ * Runs a program that the VM may modify on the VM instance, like
+ * sinter_run_mutable.
+ */
+sinter_fault_t sinter_vm_run_mutable(sinter_vm_t *vm, unsigned char *code, const size_t code_size, sinter_value_t *result);
+
+/**
+ * Loads a program on the VM instance, like sinter_load.
+ *
+ * The program is loaded in the calling thread's VM state, so sinter_call etc.
+ * call into it from that thread, until the next run or load on the thread.
+ */
+sinter_fault_t sinter_vm_load(sinter_vm_t *vm, const unsigned char *code, const size_t code_size, sinter_value_t *result);
+
+/**
+ * Loads a program that the VM may modify on the VM instance, like
+ * sinter_load_mutable.
+ */
+sinter_fault_t sinter_vm_load_mutable(sinter_vm_t *vm, unsigned char *code, const size_t code_size, sinter_value_t *result);
+
+/**
+ * Stops the program running on the VM instance, if any, like sinter_stop.
+ *
+ * Unlike sinter_stop, this can be called from any thread.
+ */
+void sinter_vm_stop(sinter_vm_t *vm);
+
+/**
+ * Destroys a VM instance, freeing its heap.
+ */
+void sinter_vm_destroy(sinter_vm_t *vm);
+
+/**
+ * Returns the VM instance last run on the calling thread, or NULL if there is
+ * none.
+ */
+sinter_vm_t *sinter_vm_current(void);
+
+/**
+ * Returns the user data the VM instance was created with.
+ */
+void *sinter_vm_user_data(const sinter_vm_t *vm);
+#endif
+
+#ifdef SINTER_QUICKEN
+/**
+ * Counters for quickening. The hit rate is hits / (hits + deopts + generic).
+ *
+ * These are reset at the start of every run.
+ */
+typedef struct {
+  /**
+   * The number of times an instruction was rewritten to a specialised one.
+   */
+  uint32_t quickened;
+  /**
+   * The number of times a specialised instruction was executed, and its
+   * operands were of the types it is specialised for.
+   */
+  uint32_t hits;
+  /**
+   * The number of times a specialised instruction was executed, but its
+   * operands were not of the types it is specialised for, so it was
+   * rewritten back to the generic instruction.
+   */
+  uint32_t deopts;
+  /**
+   * The number of times a generic instruction was executed with operands that
+   * a specialised instruction handles, in a program run or loaded with
+   * sinter_run_mutable etc. (Other programs are not counted.)
+   */
+  uint32_t generic;
+} sinter_quicken_stats_t;
+
+extern SINTER_THREAD_LOCAL sinter_quicken_stats_t sinter_quicken_stats;
+#endif
+
 /**
  * Set up the heap.
  *
+ * The heap is shrunk as needed so that it is aligned, and to the largest size a
+ * NaN-box can address (32 MB with 32-bit NaN-boxes).
+ *
  * This function is a no-op if SINTER_STATIC_HEAP is defined.
  */
 void sinter_setup_heap(void *heap, size_t size);
@@ -89,7 +457,7 @@ typedef void (*sinter_printfn_integer)(int32_t value, bool is_error);
  *
  * A newline should not be appended by the function.
  */
-typedef void (*sinter_printfn_float)(float value, bool is_error);
+typedef void (*sinter_printfn_float)(sinter_float_t value, bool is_error);
 
 /**
  * The type of a printer flush function.
@@ -100,10 +468,10 @@ typedef void (*sinter_printfn_float)(float value, bool is_error);
  */
 typedef void (*sinter_printfn_flush)(bool is_error);
 
-extern sinter_printfn_string sinter_printer_string;
-extern sinter_printfn_integer sinter_printer_integer;
-extern sinter_printfn_float sinter_printer_float;
-extern sinter_printfn_flush sinter_printer_flush;
+extern SINTER_THREAD_LOCAL sinter_printfn_string sinter_printer_string;
+extern SINTER_THREAD_LOCAL sinter_printfn_integer sinter_printer_integer;
+extern SINTER_THREAD_LOCAL sinter_printfn_float sinter_printer_float;
+extern SINTER_THREAD_LOCAL sinter_printfn_flush sinter_printer_flush;
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,28 @@
+#ifndef SINTER_CHUNK_H
+#define SINTER_CHUNK_H
+
+#include "config.h"
+
+#include "opcode.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Relocates a chunk, an SVM program that is loaded into an already loaded
+ * program (see sinter_load_chunk), to run at offset bytes from the start of the
+ * program (sistate.program).
+ *
+ * The addresses in the header, and in the instructions reachable from the
+ * chunk's entry point, are rewritten in place. Uses the heap as scratch memory.
+ *
+ * Faults with sinter_fault_invalid_program if the chunk is invalid.
+ */
+void sichunk_relocate(unsigned char *chunk, address_t chunk_size, address_t offset);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
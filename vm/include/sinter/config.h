@@ -44,6 +44,27 @@
 #undef NDEBUG
 #endif
 
+#if defined(SINTER_REENTRANT) && defined(SINTER_STATIC_HEAP)
+#error SINTER_REENTRANT requires SINTER_STATIC_HEAP to be unset
+#endif
+
+#if defined(SINTER_INLINE_CALLS) && !defined(SINTER_SPECIALISE)
+#error SINTER_INLINE_CALLS requires SINTER_SPECIALISE
+#endif
+
+#ifndef SINTER_INLINE_MAX_SIZE
+#define SINTER_INLINE_MAX_SIZE 32
+#endif
+
+#ifdef SINTER_TASKS
+#ifndef SINTER_MAX_TASKS
+#define SINTER_MAX_TASKS 4
+#endif
+#ifndef SINTER_TASK_STACK_ENTRIES
+#define SINTER_TASK_STACK_ENTRIES 0x100
+#endif
+#endif
+
 #if defined(SINTER_DEBUG_MEMORY_CHECK) && defined(NDEBUG)
 #warning SINTER_DEBUG_MEMORY_CHECK has no effect if NDEBUG is set
 #endif
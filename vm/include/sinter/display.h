@@ -11,7 +11,7 @@
 #define SIVMFN_PRINTFN(v) (_Generic((v), \
   char *: sinter_printer_string, \
   const char *: sinter_printer_string, \
-  float: sinter_printer_float, \
+  sinanbox_float_t: sinter_printer_float, \
   int32_t: sinter_printer_integer))
 #define SIVMFN_PRINT(v, is_error) do { \
   if (SIVMFN_PRINTFN(v)) SIVMFN_PRINTFN(v)((v), (is_error)); \
@@ -21,33 +21,13 @@
 SINTER_INLINEIFC void sidisplay_strobj(siheap_header_t *obj, bool is_error);
 #ifndef __cplusplus
 SINTER_INLINEIFC void sidisplay_strobj(siheap_header_t *obj, _Bool is_error) {
-  switch (obj->type) {
-  case sitype_strconst:
-    SIVMFN_PRINT((const char *) ((siheap_strconst_t *) obj)->string->data, is_error);
-    break;
-  case sitype_strpair: {
-    siheap_strpair_t *pair = (siheap_strpair_t *) obj;
-    sidisplay_strobj(pair->left, is_error);
-    if (pair->right) {
-      sidisplay_strobj(pair->right, is_error);
-    }
-    break;
-  }
-  case sitype_string: {
-    siheap_string_t *str = (siheap_string_t *) obj;
-    SIVMFN_PRINT((const char *) str->string, is_error);
-    break;
-  }
-
-  case sitype_intcont:
-  case sitype_array_data:
-  case sitype_empty:
-  case sitype_frame:
-  case sitype_free:
-  case sitype_env:
-  case sitype_array:
-  case sitype_function:
-    break;
+  // we don't flatten the string; we simply print each piece in succession
+  sistrobj_iter_t iter;
+  sistrobj_iter_init(&iter, obj);
+  const char *piece;
+  address_t length;
+  while (sistrobj_iter_next(&iter, &piece, &length)) {
+    SIVMFN_PRINT(piece, is_error);
   }
 }
 #endif
@@ -81,6 +61,7 @@ SINTER_INLINEIFC void sidisplay_nanbox(sinanbox_t v, bool is_error) {
       case sitype_strconst:
       case sitype_strpair:
       case sitype_string:
+      case sitype_strshort:
         sidisplay_strobj(obj, is_error);
         break;
       case sitype_array: {
@@ -107,6 +88,7 @@ SINTER_INLINEIFC void sidisplay_nanbox(sinanbox_t v, bool is_error) {
       case sitype_empty:
       case sitype_frame:
       case sitype_free:
+      case sitype_arena_free:
       case sitype_env:
       default:
         SIBUGM("Unexpected object type\n");
@@ -11,7 +11,7 @@
 extern "C" {
 #endif
 
-extern jmp_buf sinter_fault_jmp;
+extern SINTER_THREAD_LOCAL jmp_buf sinter_fault_jmp;
 
 /**
  * Halts the VM with the given fault reason (using `longjmp`).
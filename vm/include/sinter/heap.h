@@ -28,6 +28,10 @@ typedef enum __attribute__((__packed__)) {
   sitype_array_data = 26,
   sitype_function = 27,
   sitype_intcont = 28,
+  sitype_strshort = 29,
+  // a block in the arena that has been freed, but is not in the free list
+  // until the arena is closed (see siarena_open)
+  sitype_arena_free = 0xFE,
   sitype_free = 0xFF,
 } siheap_type_t;
 _Static_assert(sizeof(siheap_type_t) == 1, "siheap_type_t wider than needed");
@@ -35,12 +39,12 @@ _Static_assert(sizeof(siheap_type_t) == 1, "siheap_type_t wider than needed");
 #ifdef SINTER_STATIC_HEAP
 extern unsigned char siheap[SINTER_HEAP_SIZE];
 #else
-extern unsigned char *siheap;
-extern size_t siheap_size;
+extern SINTER_THREAD_LOCAL unsigned char *siheap;
+extern SINTER_THREAD_LOCAL size_t siheap_size;
 #endif
 
 #ifdef SINTER_DEBUG
-extern bool siheap_sweeping;
+extern SINTER_THREAD_LOCAL bool siheap_sweeping;
 #endif
 
 typedef address_t heapaddress_t;
@@ -53,8 +57,29 @@ SINTER_INLINE bool siheap_inrange(const unsigned char *const ent) {
 #else
 #define SIHEAP_INRANGE(ent) (((unsigned char *) (ent)) < siheap + SINTER_HEAP_SIZE)
 #endif
-#define SIHEAP_PTRTONANBOX(ptr) NANBOX_OFPTR((uint32_t) (((unsigned char *) (ptr)) - siheap))
-#define SIHEAP_NANBOXTOPTR(val) ((void *) (siheap + NANBOX_PTR(val)))
+
+/**
+ * All heap blocks start and end on a multiple of SIHEAP_ALIGNMENT bytes, so
+ * pointer NaN-boxes store the offset shifted right by SIHEAP_ALIGN_SHIFT. This
+ * lets the 22-bit pointer of a 32-bit NaN-box address a 32 MB heap.
+ */
+#define SIHEAP_ALIGN_SHIFT 3
+#define SIHEAP_ALIGNMENT (1u << SIHEAP_ALIGN_SHIFT)
+#define SIHEAP_ALIGN(size) (((size) + (SIHEAP_ALIGNMENT - 1)) & ~(address_t) (SIHEAP_ALIGNMENT - 1))
+/**
+ * The largest heap size that pointer NaN-boxes (and address_t block sizes) can
+ * address.
+ */
+#define SIHEAP_MAX_SIZE ((size_t) NANBOX_PTRMAX < (UINT32_MAX >> SIHEAP_ALIGN_SHIFT) ? \
+  ((size_t) NANBOX_PTRMAX + 1) << SIHEAP_ALIGN_SHIFT : (size_t) UINT32_MAX & ~(size_t) (SIHEAP_ALIGNMENT - 1))
+
+#ifdef SINTER_STATIC_HEAP
+_Static_assert(SINTER_HEAP_SIZE % SIHEAP_ALIGNMENT == 0, "SINTER_HEAP_SIZE is not a multiple of SIHEAP_ALIGNMENT");
+_Static_assert(SINTER_HEAP_SIZE <= SIHEAP_MAX_SIZE, "SINTER_HEAP_SIZE is too large to be addressed by a NaN-box");
+#endif
+
+#define SIHEAP_PTRTONANBOX(ptr) NANBOX_OFPTR((uint32_t) ((((unsigned char *) (ptr)) - siheap) >> SIHEAP_ALIGN_SHIFT))
+#define SIHEAP_NANBOXTOPTR(val) ((void *) (siheap + ((size_t) NANBOX_PTR(val) << SIHEAP_ALIGN_SHIFT)))
 
 /**
  * The header of a heap allocation.
@@ -69,6 +94,10 @@ typedef struct siheap_header {
 #ifdef SINTER_DEBUG_MEMORY_CHECK
   uint16_t debug_refcount;
   uint16_t internal_refcount;
+  /**
+   * The number of borrowed (uncounted) references to this object on the stack.
+   */
+  uint16_t borrow_count;
 #endif
   siheap_type_t type;
   _Bool flag_marked : 1;
@@ -82,7 +111,50 @@ typedef struct siheap_free {
   struct siheap_free *next_free;
 } siheap_free_t;
 
-extern siheap_free_t *siheap_first_free;
+/**
+ * The size of the block that siheap_malloc allocates for size bytes, which is
+ * never smaller than a free block, so that it can be freed.
+ */
+#define SIHEAP_BLOCK_SIZE(size) SIHEAP_ALIGN((size) < sizeof(siheap_free_t) ? (address_t) sizeof(siheap_free_t) : (address_t) (size))
+
+extern SINTER_THREAD_LOCAL siheap_free_t *siheap_first_free;
+
+#ifdef SINTER_ARENA
+/**
+ * The arena, a free block taken out of the free list while it is open, which
+ * allocations are taken from in turn, from the start. Blocks in the arena that
+ * are freed stay where they are, until the arena is closed.
+ */
+extern SINTER_THREAD_LOCAL unsigned char *siarena_start;
+extern SINTER_THREAD_LOCAL unsigned char *siarena_end;
+/**
+ * The rest of the arena, which the next allocation is taken from, or NULL if
+ * there is no arena open.
+ */
+extern SINTER_THREAD_LOCAL siheap_header_t *siarena_rest;
+
+#define SIHEAP_INARENA(ent) (((unsigned char *) (ent)) >= siarena_start && ((unsigned char *) (ent)) < siarena_end)
+
+SINTER_INLINE void siarena_reset(void) {
+  siarena_start = siarena_end = NULL;
+  siarena_rest = NULL;
+}
+
+/**
+ * Opens the arena, taking the largest free block. Does nothing if there is no
+ * free block.
+ */
+void siarena_open(void);
+
+/**
+ * Closes the arena, returning the blocks in it that are free (including the
+ * rest of it) to the free list. Blocks that are still referenced stay where
+ * they are. Does nothing if there is no arena open.
+ */
+void siarena_close(void);
+#else
+#define SIHEAP_INARENA(ent) false
+#endif
 
 SINTER_INLINE void siheap_ref(void *vent) {
   assert(vent);
@@ -151,6 +223,9 @@ SINTER_INLINE void siheap_free_fix_neighbours(siheap_free_t *cur) {
 SINTER_INLINEIFC void siheap_init(void);
 #ifndef __cplusplus
 SINTER_INLINEIFC void siheap_init(void) {
+#ifdef SINTER_ARENA
+  siarena_reset();
+#endif
   siheap_first_free = (siheap_free_t *) siheap;
   *siheap_first_free = (siheap_free_t) {
     .header = {
@@ -193,11 +268,57 @@ SINTER_INLINE siheap_free_t *siheap_malloc_find(address_t size) {
   }
 }
 
+/**
+ * Ensures that `count` blocks of `size` bytes can then be allocated without
+ * triggering a mark-sweep, running one now if needed. Faults if there is still
+ * not enough memory.
+ *
+ * This is for operations that hold references only in C locals across several
+ * allocations, which a mark-sweep cannot see. Everything the caller needs must
+ * be reachable (e.g. from the stack) when this is called.
+ */
+SINTER_INLINE void siheap_reserve(unsigned int count, address_t size) {
+  if (size < sizeof(siheap_free_t)) {
+    size = sizeof(siheap_free_t);
+  }
+  size = SIHEAP_ALIGN(size);
+
+  bool sweeped = false;
+  while (1) {
+    // a free block of n * size bytes can be split into n allocations
+    unsigned int available = 0;
+#ifdef SINTER_ARENA
+    // the rest of the arena must keep room for a free block header
+    if (siarena_rest && siarena_rest->size >= size + sizeof(siheap_free_t)) {
+      available += (siarena_rest->size - sizeof(siheap_free_t)) / size;
+    }
+#endif
+    for (siheap_free_t *cur = siheap_first_free; cur && available < count; cur = cur->next_free) {
+      available += cur->header.size / size;
+    }
+
+    if (available >= count) {
+      return;
+    }
+
+    if (sweeped) {
+      sifault(sinter_fault_out_of_memory);
+      return;
+    }
+    sweeped = true;
+    siheap_mark_sweep();
+  }
+}
+
 SINTER_INLINEIFC siheap_header_t *siheap_malloc_split(siheap_free_t *cur, address_t size, siheap_type_t type);
 #ifndef __cplusplus
 SINTER_INLINEIFC siheap_header_t *siheap_malloc_split(siheap_free_t *cur, address_t size, siheap_type_t type) {
   if (size + sizeof(siheap_free_t) <= cur->header.size) {
     // enough space for a new free node
+    assert(cur->prev_free != cur);
+    assert(cur->next_free != cur);
+    assert(cur->prev_free != cur->next_free || cur->prev_free == NULL);
+
     // create one
     siheap_free_t *newfree = (siheap_free_t *) (((unsigned char *) cur) + size);
     *newfree = (siheap_free_t) {
@@ -210,9 +331,6 @@ SINTER_INLINEIFC siheap_header_t *siheap_malloc_split(siheap_free_t *cur, addres
       .prev_free = cur->prev_free,
       .next_free = cur->next_free
     };
-    assert(cur->prev_free != cur);
-    assert(cur->next_free != cur);
-    assert(cur->prev_free != cur->next_free || cur->prev_free == NULL);
     cur->header.size = size;
     siheap_free_fix_neighbours(newfree);
     siheap_fix_next(&newfree->header);
@@ -225,11 +343,44 @@ SINTER_INLINEIFC siheap_header_t *siheap_malloc_split(siheap_free_t *cur, addres
   cur->header.flag_destroying = cur->header.flag_displayed = cur->header.flag_marked = false;
 #ifdef SINTER_DEBUG_MEMORY_CHECK
   cur->header.internal_refcount = 0;
+  cur->header.borrow_count = 0;
 #endif
   return &cur->header;
 }
 #endif
 
+#ifdef SINTER_ARENA
+/**
+ * Takes an allocation from the start of the rest of the arena, which must be at
+ * least size + sizeof(siheap_free_t) bytes, so that the rest can still be made
+ * a free block.
+ */
+SINTER_INLINEIFC siheap_header_t *siarena_malloc(address_t size, siheap_type_t type);
+#ifndef __cplusplus
+SINTER_INLINEIFC siheap_header_t *siarena_malloc(address_t size, siheap_type_t type) {
+  siheap_header_t *const allocated = siarena_rest;
+  siheap_header_t *const rest = (siheap_header_t *) (((unsigned char *) allocated) + size);
+  *rest = (siheap_header_t) {
+    .type = sitype_arena_free,
+    .refcount = 0,
+    .prev_node = allocated,
+    .size = allocated->size - size
+  };
+  siheap_fix_next(rest);
+  siarena_rest = rest;
+
+  allocated->size = size;
+  allocated->type = type;
+  allocated->flag_destroying = allocated->flag_displayed = allocated->flag_marked = false;
+#ifdef SINTER_DEBUG_MEMORY_CHECK
+  allocated->internal_refcount = 0;
+  allocated->borrow_count = 0;
+#endif
+  return allocated;
+}
+#endif
+#endif
+
 /**
  * Allocate memory.
  *
@@ -239,6 +390,15 @@ SINTER_INLINE siheap_header_t *siheap_malloc(address_t size, siheap_type_t type)
   if (size < sizeof(siheap_free_t)) {
     size = sizeof(siheap_free_t);
   }
+  size = SIHEAP_ALIGN(size);
+
+#ifdef SINTER_ARENA
+  if (siarena_rest && siarena_rest->size >= size + sizeof(siheap_free_t)) {
+    siheap_header_t *allocated = siarena_malloc(size, type);
+    siheap_ref(allocated);
+    return allocated;
+  }
+#endif
 
   siheap_free_t *free_block = siheap_malloc_find(size);
   siheap_header_t *allocated = siheap_malloc_split(free_block, size, type);
@@ -255,6 +415,19 @@ SINTER_INLINE siheap_header_t *siheap_mfree_inner(siheap_header_t *ent) {
     assert(false);
   }
 
+#ifdef SINTER_ARENA
+  if (SIHEAP_INARENA(ent)) {
+    // freed all at once when the arena is closed
+    ent->type = sitype_arena_free;
+    ent->flag_destroying = ent->flag_displayed = ent->flag_marked = false;
+#ifdef SINTER_DEBUG_MEMORY_CHECK
+    ent->internal_refcount = 0;
+    ent->borrow_count = 0;
+#endif
+    return ent;
+  }
+#endif
+
   siheap_header_t *const next = siheap_next(ent);
   siheap_header_t *const prev = ent->prev_node;
   const bool next_inrange = SIHEAP_INRANGE(next);
@@ -281,6 +454,7 @@ SINTER_INLINE siheap_header_t *siheap_mfree_inner(siheap_header_t *ent) {
     ent->flag_destroying = ent->flag_displayed = ent->flag_marked = false;
 #ifdef SINTER_DEBUG_MEMORY_CHECK
     ent->internal_refcount = 0;
+    ent->borrow_count = 0;
 #endif
     entf->prev_free = nextf->prev_free;
     entf->next_free = nextf->next_free;
@@ -308,6 +482,7 @@ SINTER_INLINE siheap_header_t *siheap_mfree_inner(siheap_header_t *ent) {
     ent->flag_destroying = ent->flag_displayed = ent->flag_marked = false;
 #ifdef SINTER_DEBUG_MEMORY_CHECK
     ent->internal_refcount = 0;
+    ent->borrow_count = 0;
 #endif
     entf->prev_free = NULL;
     entf->next_free = siheap_first_free;
@@ -380,6 +555,22 @@ SINTER_INLINE void siheap_intderefbox(sinanbox_t ent) {
   }
 }
 
+SINTER_INLINE void siheap_borrowbox(sinanbox_t ent) {
+  if (NANBOX_ISPTR(ent)) {
+    siheap_header_t *obj = SIHEAP_NANBOXTOPTR(ent);
+    assert(obj->type != sitype_free);
+    obj->borrow_count += 1;
+  }
+}
+
+SINTER_INLINE void siheap_unborrowbox(sinanbox_t ent) {
+  if (NANBOX_ISPTR(ent)) {
+    siheap_header_t *obj = SIHEAP_NANBOXTOPTR(ent);
+    assert(obj->borrow_count);
+    obj->borrow_count -= 1;
+  }
+}
+
 void debug_memorycheck(void);
 void debug_memorycheck_search(const siheap_header_t *needle);
 #else
@@ -387,6 +578,8 @@ void debug_memorycheck_search(const siheap_header_t *needle);
 #define siheap_intderef(x) ((void) 0)
 #define siheap_intrefbox(x) ((void) 0)
 #define siheap_intderefbox(x) ((void) 0)
+#define siheap_borrowbox(x) ((void) 0)
+#define siheap_unborrowbox(x) ((void) 0)
 #endif
 
 #ifdef __cplusplus
@@ -154,36 +154,164 @@ SINTER_INLINE siheap_frame_t *siframe_new(void) {
 typedef struct {
   siheap_header_t header;
   const svm_constant_t *string;
+  /**
+   * The hash of the string, or 0 if it has not been computed yet.
+   *
+   * This is cached here rather than in the constant pool, as the program may
+   * be in read-only memory.
+   */
+  uint32_t hash;
 } siheap_strconst_t;
 
 SINTER_INLINE siheap_strconst_t *sistrconst_new(const svm_constant_t *string) {
   siheap_strconst_t *obj = (siheap_strconst_t *) siheap_malloc(sizeof(siheap_strconst_t), sitype_strconst);
   obj->string = string;
+  obj->hash = 0;
 
   return obj;
 }
 
+/**
+ * The maximum depth of a string pair tree.
+ *
+ * String pairs are kept balanced when they are created (see sistrobj_concat),
+ * so a tree this deep would need far more nodes than can fit in the heap.
+ */
+#define SISTRPAIR_MAX_DEPTH 48
+
 typedef struct {
   siheap_header_t header;
   siheap_header_t *left;
   siheap_header_t *right;
+  /**
+   * The length of the string, excluding the null terminator.
+   */
+  address_t length;
+  /**
+   * The hash of the string, or 0 if it has not been computed yet.
+   */
+  uint32_t hash;
+  /**
+   * The height of the tree rooted at this pair. Zero once the pair is flattened.
+   */
+  uint8_t depth;
 } siheap_strpair_t;
 
+#ifdef __cplusplus
+struct siheap_string;
+typedef struct siheap_string siheap_string_t;
+#else
+typedef struct siheap_string {
+  siheap_header_t header;
+  address_t size;
+  /**
+   * The hash of the string, or 0 if it has not been computed yet.
+   */
+  uint32_t hash;
+  char string[];
+} siheap_string_t;
+#endif
+
+/**
+ * The maximum length of a short string.
+ */
+#define SISTRSHORT_MAX 8
+
+/**
+ * A short string, stored inline in the heap object.
+ *
+ * Concatenations with a result of at most SISTRSHORT_MAX bytes produce one of
+ * these rather than a string pair, which is much smaller than a string pair and
+ * the two (or more) objects it refers to.
+ */
+typedef struct {
+  siheap_header_t header;
+  uint8_t length;
+  char string[SISTRSHORT_MAX + 1];
+} siheap_strshort_t;
+
+SINTER_INLINE siheap_strshort_t *sistrshort_new(void) {
+  siheap_strshort_t *obj = (siheap_strshort_t *) siheap_malloc(sizeof(siheap_strshort_t), sitype_strshort);
+  obj->length = 0;
+  obj->string[0] = '\0';
+  return obj;
+}
+
+SINTER_INLINEIFC siheap_string_t *sistring_new(address_t size);
+#ifndef __cplusplus
+SINTER_INLINEIFC siheap_string_t *sistring_new(address_t size) {
+  siheap_string_t *obj = (siheap_string_t *) siheap_malloc(sizeof(siheap_string_t) + size, sitype_string);
+  obj->size = size;
+  obj->hash = 0;
+  return obj;
+}
+#endif
+
+/**
+ * Gets the length of a string object, excluding the null terminator.
+ */
+SINTER_INLINEIFC address_t sistrobj_length(siheap_header_t *obj);
+#ifndef __cplusplus
+SINTER_INLINEIFC address_t sistrobj_length(siheap_header_t *obj) {
+  switch (obj->type) {
+  case sitype_strconst:
+    return ((siheap_strconst_t *) obj)->string->length - 1;
+  case sitype_strpair:
+    return ((siheap_strpair_t *) obj)->length;
+  case sitype_string:
+    return ((siheap_string_t *) obj)->size - 1;
+  case sitype_strshort:
+    return ((siheap_strshort_t *) obj)->length;
+  case sitype_array:
+  case sitype_array_data:
+  case sitype_empty:
+  case sitype_free:
+  case sitype_arena_free:
+  case sitype_function:
+  case sitype_frame:
+  case sitype_env:
+  case sitype_intcont:
+  default:
+    SIBUGM("Unknown string type\n");
+    sifault(sinter_fault_internal_error);
+    return 0;
+  }
+}
+#endif
+
+/**
+ * Gets the depth of a string object. Anything other than an unflattened string
+ * pair has depth 0.
+ */
+SINTER_INLINE unsigned int sistrobj_depth(siheap_header_t *obj) {
+  return obj->type == sitype_strpair ? ((siheap_strpair_t *) obj)->depth : 0;
+}
+
 /**
  * Creates a new string pair, representing concatenation.
  *
  * The refcount of left and right are incremented.
+ *
+ * Note: this does not balance the tree. Use sistrobj_concat instead.
  */
-SINTER_INLINE siheap_strpair_t *sistrpair_new(siheap_header_t *left, siheap_header_t *right) {
+SINTER_INLINEIFC siheap_strpair_t *sistrpair_new(siheap_header_t *left, siheap_header_t *right);
+#ifndef __cplusplus
+SINTER_INLINEIFC siheap_strpair_t *sistrpair_new(siheap_header_t *left, siheap_header_t *right) {
   siheap_strpair_t *obj = (siheap_strpair_t *) siheap_malloc(sizeof(siheap_strpair_t), sitype_strpair);
+  const unsigned int left_depth = sistrobj_depth(left), right_depth = sistrobj_depth(right);
   obj->left = left;
   obj->right = right;
+  obj->length = sistrobj_length(left) + sistrobj_length(right);
+  obj->hash = 0;
+  obj->depth = 1 + (left_depth > right_depth ? left_depth : right_depth);
+  assert(obj->depth <= SISTRPAIR_MAX_DEPTH);
 
   siheap_ref(left);
   siheap_ref(right);
 
   return obj;
 }
+#endif
 
 SINTER_INLINE void sistrpair_destroy(siheap_strpair_t *obj) {
   siheap_deref(obj->left);
@@ -192,28 +320,161 @@ SINTER_INLINE void sistrpair_destroy(siheap_strpair_t *obj) {
   }
 }
 
-#ifdef __cplusplus
-struct siheap_string;
-typedef struct siheap_string siheap_string_t;
-#else
-typedef struct siheap_string {
-  siheap_header_t header;
-  address_t size;
-  char string[];
-} siheap_string_t;
-#endif
+siheap_string_t *sistrpair_flatten(siheap_strpair_t *obj);
 
-SINTER_INLINEIFC siheap_string_t *sistring_new(address_t size);
+/**
+ * Concatenates two string objects.
+ *
+ * The resulting string pair tree is kept balanced, so its depth is logarithmic
+ * in the number of pieces, no matter the order in which it was built. Results
+ * of at most SISTRSHORT_MAX bytes are short strings instead.
+ *
+ * Returns a new reference. The references to left and right are not consumed.
+ *
+ * This may run a mark-sweep, so left and right must be reachable from the
+ * stack.
+ */
+siheap_header_t *sistrobj_concat(siheap_header_t *left, siheap_header_t *right);
+
+/**
+ * The longest right operand for which sistrobj_append will start a new string
+ * builder, and the longest string pair it will start one from. Longer strings
+ * are concatenated into string pairs instead, so that e.g. repeatedly
+ * prepending to a long string, or `s = s + x + y`, does not copy it each time.
+ */
+#define SISTRING_BUILDER_START_MAX 64
+
+/**
+ * Appends right to left, where the caller holds the only reference to left.
+ *
+ * If left is a string, it is used as a string builder: right is copied onto
+ * its end in place, and the string is grown geometrically when full. If left
+ * is any other string object (a string pair only if it is short too) and right
+ * is short, a new string builder is started from a copy of both (unless the
+ * result fits in a short string). Otherwise, this is the same as
+ * sistrobj_concat.
+ *
+ * The reference to left is consumed; the reference to right is not. Returns a
+ * new reference.
+ *
+ * This may run a mark-sweep, so left and right must be reachable from the
+ * stack.
+ */
+siheap_header_t *sistrobj_append(siheap_header_t *left, siheap_header_t *right);
+
+/**
+ * An iterator over the pieces of a string object, from left to right.
+ *
+ * String pair trees are walked using an explicit stack, rather than recursion.
+ */
+typedef struct {
+  siheap_header_t *stack[SISTRPAIR_MAX_DEPTH + 1];
+  unsigned int top;
+} sistrobj_iter_t;
+
+SINTER_INLINE void sistrobj_iter_init(sistrobj_iter_t *iter, siheap_header_t *obj) {
+  iter->stack[0] = obj;
+  iter->top = 1;
+}
+
+/**
+ * Gets the next piece of a string object.
+ *
+ * Returns false if there are no more pieces. Otherwise, sets piece to the
+ * (null-terminated) piece, and length to its length.
+ */
+SINTER_INLINEIFC _Bool sistrobj_iter_next(sistrobj_iter_t *iter, const char **piece, address_t *length);
 #ifndef __cplusplus
-SINTER_INLINEIFC siheap_string_t *sistring_new(address_t size) {
-  siheap_string_t *obj = (siheap_string_t *) siheap_malloc(sizeof(siheap_string_t) + size, sitype_string);
-  obj->size = size;
-  return obj;
+SINTER_INLINEIFC _Bool sistrobj_iter_next(sistrobj_iter_t *iter, const char **piece, address_t *length) {
+  if (!iter->top) {
+    return false;
+  }
+
+  siheap_header_t *obj = iter->stack[--iter->top];
+  while (obj->type == sitype_strpair && ((siheap_strpair_t *) obj)->right) {
+    siheap_strpair_t *pair = (siheap_strpair_t *) obj;
+    assert(iter->top < SISTRPAIR_MAX_DEPTH + 1);
+    iter->stack[iter->top++] = pair->right;
+    obj = pair->left;
+  }
+
+  switch (obj->type) {
+  case sitype_strconst: {
+    siheap_strconst_t *v = (siheap_strconst_t *) obj;
+    *piece = (const char *) v->string->data;
+    *length = v->string->length - 1;
+    return true;
+  }
+
+  case sitype_strpair: {
+    // flattened
+    siheap_string_t *v = (siheap_string_t *) ((siheap_strpair_t *) obj)->left;
+    *piece = v->string;
+    *length = v->size - 1;
+    return true;
+  }
+
+  case sitype_string: {
+    siheap_string_t *v = (siheap_string_t *) obj;
+    *piece = v->string;
+    *length = v->size - 1;
+    return true;
+  }
+
+  case sitype_strshort: {
+    siheap_strshort_t *v = (siheap_strshort_t *) obj;
+    *piece = v->string;
+    *length = v->length;
+    return true;
+  }
+
+  case sitype_array:
+  case sitype_array_data:
+  case sitype_empty:
+  case sitype_free:
+  case sitype_arena_free:
+  case sitype_function:
+  case sitype_frame:
+  case sitype_env:
+  case sitype_intcont:
+  default:
+    SIBUGM("Unknown string type\n");
+    sifault(sinter_fault_internal_error);
+    return false;
+  }
 }
 #endif
 
-siheap_string_t *sistrpair_flatten(siheap_strpair_t *obj);
+/**
+ * Gets the hash of a string object, computing and caching it if needed.
+ *
+ * The hash is computed over the pieces of the string; it is not flattened.
+ */
+uint32_t sistrobj_hash(siheap_header_t *obj);
+
+/**
+ * Checks if two string objects are equal.
+ *
+ * Strings with different lengths or hashes are rejected without comparing
+ * their contents.
+ */
+bool sistrobj_equal(siheap_header_t *left, siheap_header_t *right);
+
+/**
+ * Compares two string objects, like `strcmp`.
+ *
+ * The strings are walked piece by piece, so string pairs are neither flattened
+ * nor copied, and nothing is allocated.
+ */
+int sistrobj_compare(siheap_header_t *left, siheap_header_t *right);
 
+/**
+ * Gets a contiguous, NUL-terminated `char *` for a string object.
+ *
+ * String pairs are flattened (permanently) to do so, which allocates; prefer
+ * `sistrobj_compare` or `sistrobj_iter_t` where a contiguous string is not
+ * needed.
+ */
 SINTER_INLINEIFC const char *sistrobj_tocharptr(siheap_header_t *obj);
 #ifndef __cplusplus
 SINTER_INLINEIFC const char *sistrobj_tocharptr(siheap_header_t *obj) {
@@ -234,10 +495,16 @@ SINTER_INLINEIFC const char *sistrobj_tocharptr(siheap_header_t *obj) {
     return v->string;
   }
 
+  case sitype_strshort: {
+    siheap_strshort_t *v = (siheap_strshort_t *) obj;
+    return v->string;
+  }
+
   case sitype_array:
   case sitype_array_data:
   case sitype_empty:
   case sitype_free:
+  case sitype_arena_free:
   case sitype_function:
   case sitype_frame:
   case sitype_env:
@@ -254,15 +521,14 @@ SINTER_INLINE _Bool siheap_is_string(siheap_header_t *h) {
   switch (h->type) {
   case sitype_strconst:
   case sitype_strpair:
-    return true;
   case sitype_string:
-    SIBUGM("siheap_string_t seen on stack\n");
-    sifault(sinter_fault_internal_error);
-    return false;
+  case sitype_strshort:
+    return true;
   case sitype_array:
   case sitype_array_data:
   case sitype_empty:
   case sitype_free:
+  case sitype_arena_free:
   case sitype_function:
   case sitype_frame:
   case sitype_env:
@@ -296,10 +562,14 @@ SINTER_INLINEIFC void siarray_destroy(siheap_array_t *array);
 
 #ifndef __cplusplus
 SINTER_INLINEIFC siheap_array_t *siarray_new(address_t alloc_size) {
+  const address_t data_size = sizeof(siheap_array_data_t) + alloc_size*sizeof(sinanbox_t);
+  // a mark-sweep between the two allocations would free the array, which is not
+  // yet reachable, while its data pointer is still unset
+  siheap_reserve(1, SIHEAP_BLOCK_SIZE(sizeof(siheap_array_t)) + SIHEAP_BLOCK_SIZE(data_size));
   siheap_array_t *array = (siheap_array_t *) siheap_malloc(sizeof(siheap_array_t), sitype_array);
   array->count = 0;
   array->alloc_size = alloc_size;
-  array->data = (siheap_array_data_t *) siheap_malloc(sizeof(siheap_array_data_t) + alloc_size*sizeof(sinanbox_t), sitype_array_data);
+  array->data = (siheap_array_data_t *) siheap_malloc(data_size, sitype_array_data);
 
   for (address_t i = 0; i < alloc_size; ++i) {
     array->data->data[i] = NANBOX_OFUNDEF();
@@ -6,6 +6,7 @@
 #include <stdint.h>
 
 #include "nanbox.h"
+#include "../sinter.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -18,11 +19,86 @@ extern "C" {
  */
 typedef sinanbox_t (*sivmfnptr_t)(uint8_t argc, sinanbox_t *argv);
 
-extern sivmfnptr_t sivmfn_primitives[];
+/**
+ * Who owns the arguments of a VM-internal function.
+ */
+typedef enum {
+  /**
+   * The function borrows its arguments: it must take a reference to any
+   * argument it keeps (e.g. stores in a heap object), and the VM dereferences
+   * the arguments after the call.
+   */
+  sivmfn_borrows_args = 0,
+  /**
+   * The function is given the caller's references to its arguments: it must
+   * keep or dereference each of them (including any beyond those it uses), and
+   * the VM does not dereference them.
+   */
+  sivmfn_consumes_args = 1,
+  /**
+   * The function is a primitive driven by the main loop (see sivmfn_drive_t).
+   * Called from C (e.g. siexec_nanbox), it borrows its arguments.
+   */
+  sivmfn_driven = 2
+} sivmfn_convention_t;
+
+/**
+ * A VM-internal function, and its ownership convention.
+ */
+typedef struct {
+  sivmfnptr_t fn;
+  sivmfn_convention_t convention;
+} sivmfn_t;
+
+extern const sivmfn_t sivmfn_primitives[];
 #define SIVMFN_PRIMITIVE_COUNT (92)
 
-extern const sivmfnptr_t *sivmfn_vminternals;
-extern size_t sivmfn_vminternal_count;
+/**
+ * A step of a driven primitive.
+ *
+ * state points to the primitive's state on its stack frame: its arguments,
+ * followed by entries that start as null. result is the value returned by the
+ * function the previous step called, or empty on the first step; it stays on
+ * the frame until the next step, so a step that keeps it must take a
+ * reference.
+ *
+ * To call a function, a step pushes the function and then its arguments, and
+ * returns the number of arguments (at most SIVMFN_DRIVE_MAX_CALL_ARGC). To
+ * return, it sets *retv (which it must own) and returns -1.
+ */
+typedef int (*sivmfn_step_t)(sinanbox_t *state, sinanbox_t result, sinanbox_t *retv);
+
+#define SIVMFN_DRIVE_MAX_CALL_ARGC 2
+#define SIVMFN_DRIVE_MAX_ARGC 3
+
+/**
+ * A primitive that calls functions (e.g. map) without the C recursion of
+ * siexec_nanbox: it runs as a series of steps on a stack frame of its own, and
+ * the main loop runs the functions it calls, and continues it with their
+ * results.
+ */
+typedef struct {
+  sivmfnptr_t fn;
+  sivmfn_step_t step;
+  // the number of arguments the primitive takes (at most
+  // SIVMFN_DRIVE_MAX_ARGC); any more are ignored
+  uint8_t argc;
+  // the number of entries of state, including the arguments
+  uint8_t state_size;
+} sivmfn_drive_t;
+
+extern const sivmfn_drive_t sivmfn_drives[];
+extern const size_t sivmfn_drive_count;
+
+/**
+ * The functions that internal continuations (siheap_intcont_t) are created
+ * with.
+ */
+extern const sivmfnptr_t sivmfn_continuations[];
+extern const size_t sivmfn_continuation_count;
+
+extern SINTER_THREAD_LOCAL const sivmfn_t *sivmfn_vminternals;
+extern SINTER_THREAD_LOCAL size_t sivmfn_vminternal_count;
 
 #ifdef __cplusplus
 }
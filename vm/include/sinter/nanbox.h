@@ -4,6 +4,7 @@
 #include "config.h"
 
 #include <stdint.h>
+#include <inttypes.h>
 #include <math.h>
 
 #include "fault.h"
@@ -52,6 +53,7 @@
  *
  * Thus to check the type, we can simply check (val & 0xfff00000).
  */
+#ifndef SINTER_NANBOX64
 #ifndef __cplusplus
 typedef
 #endif
@@ -100,7 +102,9 @@ _Static_assert(sizeof(sinanbox_t) == 4, "sinanbox_t has wrong size");
 #define NANBOX_ISIFN(val) (NANBOX_GETTYPE(val) == NANBOX_TIFN)
 #define NANBOX_ISNUMERIC(val) (NANBOX_ISFLOAT(val) || NANBOX_ISINT(val))
 
+#ifndef SINTER_FIXED_POINT
 #define NANBOX_FLOAT(val) ((val).as_float)
+#endif
 #define NANBOX_BOOL(val) ((val).as_u32 & 1u)
 #ifdef __cplusplus
 inline int32_t nanbox_int(sinanbox_t val) {
@@ -121,11 +125,15 @@ inline int32_t nanbox_int(sinanbox_t val) {
 
 #ifdef __cplusplus
 #define NANBOX_WITH_I32(i) (sinanbox_t(i, 0u))
+#ifndef SINTER_FIXED_POINT
 #define NANBOX_OFFLOAT(f) (sinanbox_t(f))
+#endif
 #else
 #define NANBOX_WITH_I32(i) ((sinanbox_t) { .as_u32 = (i) })
+#ifndef SINTER_FIXED_POINT
 #define NANBOX_OFFLOAT(val) (isnan((float)(val)) ? (NANBOX_CANONICAL_NAN) : ((sinanbox_t) { .as_float = (val) }))
 #endif
+#endif
 
 #define NANBOX_OFEMPTY() (NANBOX_WITH_I32(NANBOX_TEMPTY))
 #define NANBOX_OFUNDEF() (NANBOX_WITH_I32(NANBOX_TUNDEF))
@@ -150,22 +158,284 @@ inline int32_t nanbox_int(sinanbox_t val) {
 
 #define NANBOX_INTMAX 0xFFFFF
 #define NANBOX_INTMIN (-0x100000)
+#define NANBOX_PTRMAX 0x3fffffu
 
 #define NANBOX_CANONICAL_NAN (NANBOX_WITH_I32(0x7FC00000u))
 #define NANBOX_IDENTICAL(v0, v1) ((v0).as_u32 == (v1).as_u32)
 
+#define NANBOX_BITS(val) ((val).as_u32)
+#define NANBOX_WITH_BITS(i) NANBOX_WITH_I32(i)
+#define PRIxNANBOX "08" PRIx32
+
+typedef float sinanbox_float_t;
+/**
+ * Integer type wide enough to hold the sum or difference of two small
+ * integers without overflowing.
+ */
+typedef int32_t sinanbox_wideint_t;
+/**
+ * The math.h function operating on sinanbox_float_t, e.g. sqrtf or sqrt.
+ */
+#define NANBOX_MATHFN(name) name ## f
+
+#else
+/**
+ * Sinter 64-bit NaN-box
+ *
+ * Enabled by SINTER_NANBOX64, for hosted builds where double-precision
+ * arithmetic is cheap. Numbers are doubles, as in JavaScript.
+ *
+ * A double has 11 exponent bits and 52 mantissa bits, and the canonical qNaN
+ * is 0x7ff8000000000000. We use the top 16 bits as the type, leaving 48 bits
+ * for the payload, of which we use the bottom 32:
+ * - empty: 0x7ff9000000000000
+ * - undefined: 0x7ffa000000000000
+ * - null: 0x7ffb000000000000
+ * - false: 0x7ffd000000000000
+ * - true: 0x7ffd000000000001
+ * - small integers (32-bit): 0x7ffe0000xxxxxxxx
+ * - heap pointers (32-bit offset): 0xfffc0000xxxxxxxx
+ * - primitive function objects: 0xfff90000000000xx
+ * - vm-internal function objects: 0xfff90000000001xx
+ *
+ * Thus to check the type, we can simply check (val & 0xffff000000000000).
+ */
+#ifndef __cplusplus
+typedef
+#endif
+union
+#ifdef __cplusplus
+sinanbox_t
+#endif
+{
+  double as_float;
+  uint64_t as_u64;
+
+#ifdef __cplusplus
+  // The dummy 2nd argument is to avoid any type-promotion shenanigans
+  constexpr sinanbox_t(uint64_t i, uint64_t) : as_u64(i) {}
+
+  constexpr sinanbox_t(double f) : as_float(f) {}
+#endif
+}
+#ifndef __cplusplus
+sinanbox_t
+#endif
+;
+_Static_assert(sizeof(sinanbox_t) == 8, "sinanbox_t has wrong size");
+
+#define NANBOX_TYPEMASK 0xffff000000000000u
+#define NANBOX_TEMPTY 0x7ff9000000000000u
+#define NANBOX_TUNDEF 0x7ffa000000000000u
+#define NANBOX_TNULL 0x7ffb000000000000u
+#define NANBOX_TBOOL 0x7ffd000000000000u
+#define NANBOX_TINT 0x7ffe000000000000u
+#define NANBOX_TPTR 0xfffc000000000000u
+#define NANBOX_TIFN 0xfff9000000000000u
+
+#define NANBOX_CASES_TINT case NANBOX_TINT:
+#define NANBOX_CASES_TPTR case NANBOX_TPTR:
+#define NANBOX_GETTYPE(val) ((val).as_u64 & NANBOX_TYPEMASK)
+
+#define NANBOX_ISFLOAT(val) (nanbox_isfloat(val))
+#define NANBOX_ISEMPTY(val) ((val).as_u64 == NANBOX_TEMPTY)
+#define NANBOX_ISUNDEF(val) ((val).as_u64 == NANBOX_TUNDEF)
+#define NANBOX_ISNULL(val) ((val).as_u64 == NANBOX_TNULL)
+#define NANBOX_ISBOOL(val) (NANBOX_GETTYPE(val) == NANBOX_TBOOL)
+#define NANBOX_ISINT(val) (NANBOX_GETTYPE(val) == NANBOX_TINT)
+#define NANBOX_ISPTR(val) (NANBOX_GETTYPE(val) == NANBOX_TPTR)
+#define NANBOX_ISIFN(val) (NANBOX_GETTYPE(val) == NANBOX_TIFN)
+#define NANBOX_ISNUMERIC(val) (NANBOX_ISFLOAT(val) || NANBOX_ISINT(val))
+
+#define NANBOX_FLOAT(val) ((val).as_float)
+#define NANBOX_BOOL(val) ((val).as_u64 & 1u)
+#define NANBOX_INT(val) ((int32_t) (uint32_t) (val).as_u64)
+#define NANBOX_PTR(val) ((uint32_t) (val).as_u64)
+#define NANBOX_TOFLOAT(val) (nanbox_tofloat((val)))
+#define NANBOX_TOI32(val) (nanbox_toi32((val)))
+#define NANBOX_TOU32(val) (nanbox_tou32((val)))
+
+#define NANBOX_IFN_TYPE(val) (((val).as_u64 & 0x100) >> 8)
+#define NANBOX_IFN_NUMBER(val) ((val).as_u64 & 0xff)
+
+#ifdef __cplusplus
+#define NANBOX_WITH_BITS(i) (sinanbox_t((uint64_t) (i), (uint64_t) 0))
+#define NANBOX_OFFLOAT(f) (sinanbox_t((double) (f)))
+#else
+#define NANBOX_WITH_BITS(i) ((sinanbox_t) { .as_u64 = (i) })
+#define NANBOX_OFFLOAT(val) (isnan((double)(val)) ? (NANBOX_CANONICAL_NAN) : ((sinanbox_t) { .as_float = (val) }))
+#endif
+
+#define NANBOX_OFEMPTY() (NANBOX_WITH_BITS(NANBOX_TEMPTY))
+#define NANBOX_OFUNDEF() (NANBOX_WITH_BITS(NANBOX_TUNDEF))
+#define NANBOX_OFNULL() (NANBOX_WITH_BITS(NANBOX_TNULL))
+#define NANBOX_OFBOOL(val) (NANBOX_WITH_BITS(((uint64_t) !!(val)) | NANBOX_TBOOL))
+/**
+ * Creates a NaN-box of an integer.
+ *
+ * Note: the value MUST be within range, or will be wrapped around.
+ *
+ * Use NANBOX_WRAP_INT if it may not be within range.
+ */
+#define NANBOX_OFINT(val) (NANBOX_WITH_BITS(((uint32_t) (val)) | NANBOX_TINT))
+#define NANBOX_OFPTR(val) (NANBOX_WITH_BITS(((uint32_t) (val)) | NANBOX_TPTR))
+#define NANBOX_WRAP_INT(v) (((v) >= NANBOX_INTMIN && (v) <= NANBOX_INTMAX) ? \
+  NANBOX_OFINT(v) : NANBOX_OFFLOAT(v))
+#define NANBOX_WRAP_UINT(v) (((v) <= NANBOX_INTMAX) ? \
+  NANBOX_OFINT(v) : NANBOX_OFFLOAT(v))
+
+#define NANBOX_OFIFN_PRIMITIVE(number) (NANBOX_WITH_BITS(NANBOX_TIFN | (number)))
+#define NANBOX_OFIFN_VM(number) (NANBOX_WITH_BITS(NANBOX_TIFN | 0x100 | (number)))
+
+#define NANBOX_INTMAX INT32_MAX
+#define NANBOX_INTMIN INT32_MIN
+#define NANBOX_PTRMAX UINT32_MAX
+
+#define NANBOX_CANONICAL_NAN (NANBOX_WITH_BITS(0x7ff8000000000000u))
+#define NANBOX_IDENTICAL(v0, v1) ((v0).as_u64 == (v1).as_u64)
+
+#define NANBOX_BITS(val) ((val).as_u64)
+#define PRIxNANBOX "016" PRIx64
+
+typedef double sinanbox_float_t;
+typedef int64_t sinanbox_wideint_t;
+#define NANBOX_MATHFN(name) name
+#endif
+
+#ifdef SINTER_FIXED_POINT
+#ifdef SINTER_NANBOX64
+#error SINTER_FIXED_POINT requires 32-bit NaN-boxes
+#endif
+/**
+ * Fixed-point numbers
+ *
+ * With SINTER_FIXED_POINT, numbers that are not small integers are Q15.16
+ * fixed-point values instead of floats, so that arithmetic on them does not
+ * need floating-point operations. This is for microcontrollers without an FPU,
+ * where every float operation is a (slow) library call.
+ *
+ * A value q, where -0x40000000 <= q <= 0x3fffffff, is stored as q with bit 30
+ * cleared. Bits 23 to 30 are then never all set, so it does not collide with
+ * any of the NaN-boxed types above. Every float with bit 30 set has a
+ * magnitude of at least 2, so numbers out of the fixed-point range (e.g. large
+ * integers) are stored as floats, as are infinities and NaN.
+ *
+ * NANBOX_FLOAT and NANBOX_OFFLOAT convert to and from float, so code that
+ * works on floats still works, just without the fixed-point fast paths.
+ */
+#define NANBOX_FIXED_SHIFT 16
+#define NANBOX_FIXED_ONE (1 << NANBOX_FIXED_SHIFT)
+#define NANBOX_FIXED_MAX 0x3fffffff
+#define NANBOX_FIXED_MIN (-0x40000000)
+
+#define NANBOX_ISFIXED(val) (((val).as_u32 & 0x40000000u) == 0)
+/**
+ * Whether the value is a fixed-point value, or an integer that can be
+ * converted to one.
+ */
+#define NANBOX_ISFIXEDNUM(val) (NANBOX_ISFIXED(val) || (NANBOX_ISINT(val) \
+  && NANBOX_INT(val) >= (NANBOX_FIXED_MIN >> NANBOX_FIXED_SHIFT) \
+  && NANBOX_INT(val) <= (NANBOX_FIXED_MAX >> NANBOX_FIXED_SHIFT)))
+#define NANBOX_FIXED(val) ((int32_t) ((val).as_u32 | (((val).as_u32 >> 1) & 0x40000000u)))
+#define NANBOX_TOFIXED(val) (NANBOX_ISINT(val) ? NANBOX_INT(val) * NANBOX_FIXED_ONE : NANBOX_FIXED(val))
+/**
+ * Creates a NaN-box of a fixed-point value.
+ *
+ * Note: the value MUST be within range. Use nanbox_wrap_fixed if it may not be.
+ */
+#define NANBOX_OFFIXED(q) (NANBOX_WITH_I32(((uint32_t) (q)) & 0xbfffffffu))
+
+#define NANBOX_FLOAT(val) (nanbox_fixed_tofloat((val)))
+#define NANBOX_OFFLOAT(val) (nanbox_fixed_offloat((float) (val)))
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 SINTER_INLINE _Bool nanbox_isfloat(sinanbox_t v) {
+#ifdef SINTER_NANBOX64
+  uint64_t i = v.as_u64;
+  return ((i & 0x7ff0000000000000u) != 0x7ff0000000000000u) || ((i & 0xfffffffffffffu) == 0)
+    || i == 0x7ff8000000000000u;
+#else
   uint32_t i = v.as_u32;
   return ((i & 0x7f800000) != 0x7f800000) || ((i & 0x7fffff) == 0) || i == 0x7fc00000;
+#endif
+}
+
+#ifdef SINTER_FIXED_POINT
+SINTER_INLINE sinanbox_t nanbox_wrap_fixed(int64_t q) {
+  if (q > NANBOX_FIXED_MAX || q < NANBOX_FIXED_MIN) {
+    // out of range, so a float
+    sinanbox_t v = NANBOX_WITH_I32(0u);
+    v.as_float = (float) q / NANBOX_FIXED_ONE;
+    return v;
+  }
+  return NANBOX_OFFIXED(q);
+}
+
+SINTER_INLINE sinanbox_t nanbox_fixed_mul(int64_t f0, int64_t f1) {
+  // round to nearest
+  return nanbox_wrap_fixed((f0 * f1 + NANBOX_FIXED_ONE/2) >> NANBOX_FIXED_SHIFT);
+}
+
+SINTER_INLINE sinanbox_t nanbox_fixed_div(int64_t f0, int64_t f1) {
+  if (!f1) {
+    return f0 ? NANBOX_WITH_I32(f0 > 0 ? 0x7f800000u : 0xff800000u) : NANBOX_CANONICAL_NAN;
+  }
+  return nanbox_wrap_fixed(f0 * NANBOX_FIXED_ONE / f1);
+}
+
+SINTER_INLINE sinanbox_t nanbox_fixed_mod(int64_t f0, int64_t f1) {
+  // C's % truncates like JavaScript's
+  return f1 ? NANBOX_OFFIXED(f0 % f1) : NANBOX_CANONICAL_NAN;
 }
 
-SINTER_INLINE float nanbox_tofloat(sinanbox_t v) {
+SINTER_INLINE float nanbox_fixed_tofloat(sinanbox_t v) {
+  if (NANBOX_ISFIXED(v)) {
+    return (float) NANBOX_FIXED(v) / NANBOX_FIXED_ONE;
+  }
+  return v.as_float;
+}
+
+/**
+ * Converts a float to a fixed-point NaN-box, using only integer operations.
+ */
+SINTER_INLINE sinanbox_t nanbox_fixed_offloat(float f) {
+  sinanbox_t v = NANBOX_WITH_I32(0u);
+  v.as_float = f;
+  const uint32_t bits = v.as_u32;
+  const int exponent = (int) ((bits >> 23) & 0xff);
+  if (exponent == 0xff) {
+    // infinity, or NaN
+    return (bits & 0x7fffff) ? NANBOX_CANONICAL_NAN : v;
+  } else if (exponent == 0) {
+    // zero, or subnormal, which is too small to represent
+    return NANBOX_OFFIXED(0);
+  }
+
+  // f = mantissa * 2^(exponent - 127 - 23); q = f * 2^16
+  const int64_t mantissa = (bits & 0x7fffff) | 0x800000;
+  const int shift = exponent - 127 - 23 + NANBOX_FIXED_SHIFT;
+  int64_t q;
+  if (shift >= 0) {
+    q = shift > 30 ? ((int64_t) NANBOX_FIXED_MAX + 1) : mantissa << shift;
+  } else {
+    // round to nearest
+    q = -shift > 24 ? 0 : (mantissa + (((int64_t) 1) << (-shift - 1))) >> -shift;
+  }
+  if ((bits >> 31) ? -q < NANBOX_FIXED_MIN : q > NANBOX_FIXED_MAX) {
+    // out of range, so it stays a float
+    return v;
+  }
+  return NANBOX_OFFIXED((bits >> 31) ? -q : q);
+}
+#endif
+
+SINTER_INLINE sinanbox_float_t nanbox_tofloat(sinanbox_t v) {
   if (NANBOX_ISINT(v)) {
-    return (float) NANBOX_INT(v);
+    return (sinanbox_float_t) NANBOX_INT(v);
   } else if (NANBOX_ISFLOAT(v)) {
     return NANBOX_FLOAT(v);
   } else {
@@ -95,7 +95,69 @@ typedef enum __attribute__((__packed__)) {
   op_neg_f    = 0x51,
   op_neq_g    = 0x52,
   op_neq_f    = 0x53,
-  op_neq_b    = 0x54
+  op_neq_b    = 0x54,
+
+  // Internal opcodes, which are never in an SVM program as compiled; the VM
+  // rewrites generic instructions to these when quickening (SINTER_QUICKEN).
+  // Each pair is specialised for two integer or two float operands.
+  op_add_ii   = 0x55,
+  op_add_ff   = 0x56,
+  op_sub_ii   = 0x57,
+  op_sub_ff   = 0x58,
+  op_mul_ii   = 0x59,
+  op_mul_ff   = 0x5A,
+  op_lt_ii    = 0x5B,
+  op_lt_ff    = 0x5C,
+  op_gt_ii    = 0x5D,
+  op_gt_ff    = 0x5E,
+  op_le_ii    = 0x5F,
+  op_le_ff    = 0x60,
+  op_ge_ii    = 0x61,
+  op_ge_ff    = 0x62,
+  op_eq_ii    = 0x63,
+  op_eq_ff    = 0x64,
+  op_neq_ii   = 0x65,
+  op_neq_ff   = 0x66,
+
+  // Internal opcodes that the load-time analysis (SINTER_SPECIALISE) rewrites
+  // instructions to, where it has proven the operands to be numbers. The
+  // loads and stores also do not check for uninitialised entries or
+  // reference-count the values.
+  op_ldl_n    = 0x67,
+  op_stl_n    = 0x68,
+  op_ldp_n    = 0x69,
+  op_stp_n    = 0x6A,
+  op_add_nn   = 0x6B,
+  op_sub_nn   = 0x6C,
+  op_mul_nn   = 0x6D,
+  op_div_nn   = 0x6E,
+  op_mod_nn   = 0x6F,
+  op_lt_nn    = 0x70,
+  op_gt_nn    = 0x71,
+  op_le_nn    = 0x72,
+  op_ge_nn    = 0x73,
+
+  // Internal opcodes for borrowed references (SINTER_SPECIALISE): a load or
+  // dup whose value is consumed later in the same basic block, while another
+  // reference keeps it alive, does not increment the reference count, and the
+  // instruction that consumes it does not decrement it.
+  op_ldl_bw   = 0x74,
+  op_ldp_bw   = 0x75,
+  op_dup_bw   = 0x76,
+  op_lda_bw   = 0x77,
+  op_sta_bw   = 0x78,
+  op_pop_bw   = 0x79,
+
+  // Internal opcodes for the last load of an environment entry
+  // (SINTER_SPECIALISE): the value is moved to the stack, and the entry is
+  // cleared, so that the environment does not keep it alive.
+  op_ldl_mv   = 0x7A,
+  op_ldp_mv   = 0x7B,
+
+  // Internal opcode that continues a driven primitive (sivmfn_drive_t) with
+  // the result of the function it called. It is only in the VM's own code for
+  // driven primitives, never in a program.
+  op_drive    = 0x7C
 } sinter_opcode_t;
 _Static_assert(sizeof(sinter_opcode_t) == 1, "enum sinter_opcode has wrong size");
 
@@ -159,4 +221,65 @@ SINTER_OPSTRUCT(call_internal, 2,
 
 #undef SINTER_OPSTRUCT
 
+/**
+ * Returns the size of the instruction with the given opcode, or 0 if the
+ * opcode is invalid.
+ */
+static inline unsigned int siinstr_size(opcode_t op) {
+  switch (op) {
+  case op_ldc_i:
+  case op_lgc_i:
+    return sizeof(struct op_i32);
+  case op_ldc_f32:
+  case op_lgc_f32:
+    return sizeof(struct op_f32);
+  case op_ldc_f64:
+  case op_lgc_f64:
+    return sizeof(struct op_f64);
+  case op_lgc_s:
+  case op_new_c:
+  case op_jmp:
+    return sizeof(struct op_address);
+  case op_br_t:
+  case op_br_f:
+  case op_br:
+    return sizeof(struct op_offset);
+  case op_ldl_g:
+  case op_ldl_f:
+  case op_ldl_b:
+  case op_ldl_n:
+  case op_ldl_bw:
+  case op_ldl_mv:
+  case op_stl_g:
+  case op_stl_b:
+  case op_stl_f:
+  case op_stl_n:
+  case op_newenv:
+  case op_new_c_p:
+  case op_new_c_v:
+    return sizeof(struct op_oneindex);
+  case op_call:
+  case op_call_t:
+    return sizeof(struct op_call);
+  case op_ldp_g:
+  case op_ldp_f:
+  case op_ldp_b:
+  case op_ldp_n:
+  case op_ldp_bw:
+  case op_ldp_mv:
+  case op_stp_g:
+  case op_stp_b:
+  case op_stp_f:
+  case op_stp_n:
+    return sizeof(struct op_twoindex);
+  case op_call_p:
+  case op_call_t_p:
+  case op_call_v:
+  case op_call_t_v:
+    return sizeof(struct op_call_internal);
+  default:
+    return op <= op_drive ? sizeof(opcode_t) : 0;
+  }
+}
+
 #endif // SINTER_OPCODE_H
@@ -0,0 +1,47 @@
+#ifndef SINTER_SNAPSHOT_H
+#define SINTER_SNAPSHOT_H
+
+#include "config.h"
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Returns the size of a snapshot of the loaded program.
+ *
+ * The program must be loaded (see sinter_load), i.e. the stack must hold just
+ * the frame that keeps the global environment, and the last result.
+ */
+size_t sisnapshot_size(void);
+
+/**
+ * Returns the number of bytes of the heap that a snapshot saves: up to the end
+ * of the header of the free block at the end of the heap, if any.
+ */
+size_t sisnapshot_heap_used(void);
+
+/**
+ * Saves a snapshot of the loaded program to the buffer, which must be at least
+ * sisnapshot_size() bytes.
+ *
+ * Faults if the heap cannot be saved.
+ */
+void sisnapshot_save(unsigned char *buffer);
+
+/**
+ * Restores a snapshot of the program being run (sistate.program) into the heap
+ * and stack, leaving the program loaded as it was when the snapshot was saved.
+ *
+ * Faults with sinter_fault_invalid_snapshot if the snapshot is invalid, or was
+ * saved from a different program or build of the VM.
+ */
+void sisnapshot_restore(const unsigned char *snapshot, size_t snapshot_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
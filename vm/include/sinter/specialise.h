@@ -0,0 +1,40 @@
+#ifndef SINTER_SPECIALISE_H
+#define SINTER_SPECIALISE_H
+
+#include "config.h"
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef SINTER_SPECIALISE
+/**
+ * Analyses the program, and rewrites instructions whose operands are proven
+ * to be numbers to unchecked internal instructions.
+ *
+ * Uses the heap as scratch memory, so this must be called after the heap is
+ * initialised, and before the program starts running.
+ */
+void sispecialise_program(unsigned char *program, size_t program_size);
+#endif
+
+#ifdef SINTER_INLINE_CALLS
+/**
+ * Inlines calls to small functions defined at the top level of the program,
+ * relocating the functions of the program within the buffer.
+ *
+ * The program may grow to buffer_size bytes. Returns the new size of the
+ * program, which is program_size if nothing was inlined.
+ *
+ * Uses the heap as scratch memory, like sispecialise_program.
+ */
+size_t siinline_program(unsigned char *program, size_t program_size, size_t buffer_size);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
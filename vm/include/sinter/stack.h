@@ -14,16 +14,57 @@
 extern "C" {
 #endif
 
-extern sinanbox_t sistack[SINTER_STACK_ENTRIES];
+#ifdef SINTER_TASKS
+// the stacks of tasks follow the main stack
+#define SISTACK_ENTRIES (SINTER_STACK_ENTRIES + SINTER_MAX_TASKS * SINTER_TASK_STACK_ENTRIES)
+#else
+#define SISTACK_ENTRIES SINTER_STACK_ENTRIES
+#endif
+
+extern SINTER_THREAD_LOCAL sinanbox_t sistack[SISTACK_ENTRIES];
 
 // (Inclusive) Bottom of the current function's operand stack, as an index into
 // sistack.
-extern sinanbox_t *sistack_bottom;
+extern SINTER_THREAD_LOCAL sinanbox_t *sistack_bottom;
 // (Exclusive) Limit of the current function's operand stack, as an index into
 // sistack.
-extern sinanbox_t *sistack_limit;
+extern SINTER_THREAD_LOCAL sinanbox_t *sistack_limit;
 // Index of the next empty entry of the current function's operand stack.
-extern sinanbox_t *sistack_top;
+extern SINTER_THREAD_LOCAL sinanbox_t *sistack_top;
+
+#ifdef SINTER_TASKS
+/**
+ * A part of sistack: the main stack (segment 0), or the stack of a task (see
+ * sinter_task_spawn). The state of the segments that are not running is saved
+ * here, and their stacks and environments are roots for the garbage collector.
+ */
+typedef struct {
+  // the saved stack pointers; top is NULL if the segment is not in use
+  sinanbox_t *bottom;
+  sinanbox_t *limit;
+  sinanbox_t *top;
+  siheap_env_t *env;
+  const opcode_t *pc;
+} sistack_segment_t;
+
+extern SINTER_THREAD_LOCAL sistack_segment_t sistack_segments[SINTER_MAX_TASKS + 1];
+// The running segment.
+extern SINTER_THREAD_LOCAL unsigned int sistack_segment;
+// (Exclusive) End of the running segment.
+extern SINTER_THREAD_LOCAL sinanbox_t *sistack_end;
+
+#define SISTACK_SEGMENT_BASE(segment) \
+  (sistack + ((segment) ? SINTER_STACK_ENTRIES + ((segment) - 1) * SINTER_TASK_STACK_ENTRIES : 0))
+
+/**
+ * Saves the state of the running segment, and installs that of the given
+ * segment, which must be in use.
+ */
+void sistack_switch(unsigned int segment);
+#define SISTACK_END sistack_end
+#else
+#define SISTACK_END (sistack + SINTER_STACK_ENTRIES)
+#endif
 
 SINTER_INLINE void sistack_push_force(sinanbox_t entry) {
 #if SINTER_DEBUG_LOGLEVEL >= 2
@@ -72,8 +113,22 @@ SINTER_INLINE sinanbox_t sistack_peek(unsigned int index) {
   return *v;
 }
 
-SINTER_INLINE void sistack_new(unsigned int size, const opcode_t *return_address, siheap_env_t *return_env) {
-  siheap_frame_t *frame = siframe_new();
+SINTER_INLINE void sistack_check_room(unsigned int size) {
+#ifndef SINTER_DISABLE_CHECKS
+  // room for the frame, and the new stack
+  if (size >= (size_t) (SISTACK_END - sistack_top)) {
+    sifault(sinter_fault_stack_overflow);
+  }
+#else
+  (void) size;
+#endif
+}
+
+/**
+ * Like sistack_new, with a frame that the caller has allocated, and checked
+ * there is room for (see sistack_check_room).
+ */
+SINTER_INLINE void sistack_new_frame(siheap_frame_t *frame, unsigned int size, const opcode_t *return_address, siheap_env_t *return_env) {
   frame->return_address = return_address;
   frame->saved_env = return_env;
   frame->saved_stack_bottom = sistack_bottom;
@@ -86,6 +141,11 @@ SINTER_INLINE void sistack_new(unsigned int size, const opcode_t *return_address
   sistack_limit = sistack_bottom + size;
 }
 
+SINTER_INLINE void sistack_new(unsigned int size, const opcode_t *return_address, siheap_env_t *return_env) {
+  sistack_check_room(size);
+  sistack_new_frame(siframe_new(), size, return_address, return_env);
+}
+
 SINTER_INLINE void sistack_destroy(const opcode_t **return_address, siheap_env_t **return_env) {
   while (sistack_top > sistack_bottom) {
     sinanbox_t v = sistack_pop();
@@ -19,35 +19,68 @@ extern "C" {
 #endif
 
 struct sistate {
+  // cleared to stop the program (see sinter_stop)
   volatile bool running;
+#ifdef SINTER_REENTRANT
+  // the stop flag of the VM instance running on the thread, if any, which
+  // sinter_vm_stop sets from any thread, so the main loop reads it atomically
+  bool *stop_requested;
+#endif
   sinter_fault_t fault_reason;
   const opcode_t *pc;
   const opcode_t *program;
   const opcode_t *program_end;
   siheap_env_t *env;
+#ifdef SINTER_QUICKEN
+  bool program_mutable;
+#endif
+#ifdef SINTER_TASKS
+  // the number of instructions the running task may run before it yields
+  uint32_t budget;
+  // the number of siexec_env calls in progress; a task only yields from the
+  // main loop that sivm_resume runs, and not from e.g. a function that a
+  // primitive calls
+  unsigned int exec_depth;
+#endif
 };
 
-extern struct sistate sistate;
+extern SINTER_THREAD_LOCAL struct sistate sistate;
 
 sinanbox_t __attribute__((warn_unused_result)) siexec(const svm_function_t *fn, siheap_env_t *parent_env, uint8_t argc, sinanbox_t *argv);
 
+/**
+ * Runs the function in the given environment, which the function takes (and
+ * releases when it returns) a reference to.
+ */
+sinanbox_t __attribute__((warn_unused_result)) siexec_env(const svm_function_t *fn, siheap_env_t *env);
+
+/**
+ * Runs a driven primitive (see sivmfn_drive_t) from C, which borrows its
+ * arguments, and returns its result. The functions it calls run in a nested
+ * main loop, as with siexec.
+ */
+sinanbox_t __attribute__((warn_unused_result)) sivm_drive(const sivmfn_drive_t *drive, uint8_t argc, sinanbox_t *argv);
+
 SINTER_INLINEIFC __attribute__((warn_unused_result)) sinanbox_t siexec_nanbox(sinanbox_t fn, uint8_t argc, sinanbox_t *argv);
 #ifndef __cplusplus
 SINTER_INLINEIFC __attribute__((warn_unused_result)) sinanbox_t siexec_nanbox(sinanbox_t fn, uint8_t argc, sinanbox_t *argv) {
   if (NANBOX_ISIFN(fn)) {
     uint8_t ifn = NANBOX_IFN_NUMBER(fn);
-    sinanbox_t ret = NANBOX_OFEMPTY();
+    const sivmfn_t *vmfn = NULL;
     if (NANBOX_IFN_TYPE(fn) && ifn < sivmfn_vminternal_count) {
       // vm-internal function
-      ret = sivmfn_vminternals[ifn](argc, argv);
+      vmfn = sivmfn_vminternals + ifn;
     } else if (!NANBOX_IFN_TYPE(fn) && ifn < SIVMFN_PRIMITIVE_COUNT) {
-      ret = sivmfn_primitives[ifn](argc, argv);
+      vmfn = sivmfn_primitives + ifn;
     } else {
       sifault(sinter_fault_invalid_program);
       return NANBOX_OFEMPTY();
     }
-    for (size_t i = 0; i < argc; ++i) {
-      siheap_derefbox(argv[i]);
+    sinanbox_t ret = vmfn->fn(argc, argv);
+    if (vmfn->convention != sivmfn_consumes_args) {
+      for (size_t i = 0; i < argc; ++i) {
+        siheap_derefbox(argv[i]);
+      }
     }
     return ret;
   } else if (NANBOX_ISPTR(fn)) {
@@ -68,9 +101,11 @@ SINTER_INLINEIFC __attribute__((warn_unused_result)) sinanbox_t siexec_nanbox(si
     case sitype_strconst:
     case sitype_strpair:
     case sitype_string:
+    case sitype_strshort:
     case sitype_array:
     case sitype_array_data:
     case sitype_free:
+    case sitype_arena_free:
     default:
       sifault(sinter_fault_type);
       return NANBOX_OFEMPTY();
@@ -84,8 +119,28 @@ SINTER_INLINEIFC __attribute__((warn_unused_result)) sinanbox_t siexec_nanbox(si
 
 bool sivm_equal(sinanbox_t l, sinanbox_t r);
 
+#ifdef SINTER_TASKS
+/**
+ * Continues running the installed stack segment (see sistack_switch) from
+ * sistate.pc, until it has run budget instructions (at least one), or has been
+ * made to yield (by setting sistate.budget to 0), or has returned. Returns
+ * true if it returned, leaving the result on its stack.
+ */
+bool sivm_resume(uint32_t budget);
+#endif
+
 void sistop(void);
 
+#ifdef SINTER_QUICKEN
+void sivm_quicken_reset(void);
+#endif
+
+#ifdef SINTER_REENTRANT
+#define SISTATE_STOP_REQUESTED() (sistate.stop_requested && __atomic_load_n(sistate.stop_requested, __ATOMIC_RELAXED))
+#else
+#define SISTATE_STOP_REQUESTED() false
+#endif
+
 #define SISTATE_CURADDR (sistate.pc - sistate.program)
 #define SISTATE_ADDRTOPC(addr) (sistate.program + (addr))
 
@@ -42,10 +42,111 @@
 
 /**
  * Set the number of entries of the statically-allocated stack, in entries.
- * Each entry is 4 bytes.
+ * Each entry is 4 bytes (8 bytes if SINTER_NANBOX64 is set).
  *
  * Defaults to 0x200.
  */
 // #define SINTER_STACK_ENTRIES 0x200
 
+/**
+ * Use 64-bit NaN-boxes, with double-precision numbers and 32-bit small
+ * integers. This doubles the size of every stack entry, environment slot and
+ * array element, so it is meant for hosted builds where double-precision
+ * arithmetic is cheap.
+ *
+ * Off by default (numbers are single-precision floats).
+ */
+// #define SINTER_NANBOX64
+
+/**
+ * Represent numbers that are not small integers as Q15.16 fixed-point values
+ * instead of floats, for microcontrollers without an FPU. Fixed-point values
+ * have a range of about -16384 to 16384 and a precision of about 0.00002;
+ * numbers out of that range are stored as floats, as without this.
+ *
+ * Cannot be used with SINTER_NANBOX64. Off by default.
+ */
+// #define SINTER_FIXED_POINT
+
+/**
+ * Enable quickening of programs run with sinter_run_mutable: generic
+ * arithmetic and comparison instructions that keep seeing two integers or two
+ * floats are rewritten in place to instructions specialised for them, which
+ * revert to the generic instruction if they see anything else.
+ *
+ * Off by default.
+ */
+// #define SINTER_QUICKEN
+
+/**
+ * Analyse programs run with sinter_run_mutable before running them, and
+ * rewrite loads, stores, arithmetic and comparisons of locals that are proven
+ * to hold numbers to instructions that skip the type and reference count
+ * checks. Also rewrites loads whose reference count increment is undone
+ * later in the same basic block to not count the reference, and the last load
+ * of each local to move the value out of the environment.
+ *
+ * Off by default.
+ */
+// #define SINTER_SPECIALISE
+
+/**
+ * Give each thread its own VM state, and enable the sinter_vm_t API to create
+ * VM instances with their own heaps, so that programs can run on several
+ * threads at the same time. Requires the heap to be set up at runtime (i.e.
+ * SINTER_STATIC_HEAP must not be defined).
+ *
+ * Off by default.
+ */
+// #define SINTER_REENTRANT
+
+/**
+ * Enable sinter_inline_calls, which inlines calls to small functions defined
+ * at the top level of a program into their callers, given room for the
+ * program to grow. Requires SINTER_SPECIALISE.
+ *
+ * Off by default.
+ */
+// #define SINTER_INLINE_CALLS
+
+/**
+ * The largest function (in bytes of code) that sinter_inline_calls inlines.
+ *
+ * Default: 32
+ */
+// #define SINTER_INLINE_MAX_SIZE 32
+
+/**
+ * Enable tasks: functions of a loaded program that are spawned with
+ * sinter_task_spawn, and run in turns by sinter_task_step, each for a budget
+ * of instructions, on stacks of their own.
+ *
+ * Off by default.
+ */
+// #define SINTER_TASKS
+
+/**
+ * The number of tasks that can exist at once, if SINTER_TASKS is set.
+ *
+ * Defaults to 4.
+ */
+// #define SINTER_MAX_TASKS 4
+
+/**
+ * The number of stack entries of each task, if SINTER_TASKS is set. These are
+ * allocated statically, after the SINTER_STACK_ENTRIES of the main stack.
+ *
+ * Defaults to 0x100.
+ */
+// #define SINTER_TASK_STACK_ENTRIES 0x100
+
+/**
+ * Enable sinter_call_arena, which calls a function of a loaded program with
+ * its allocations taken in turn from one free block of the heap, which is
+ * returned to the free list all at once after the call.
+ *
+ * Off by default.
+ */
+// #define SINTER_ARENA
+
 #endif
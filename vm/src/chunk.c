@@ -0,0 +1,174 @@
+#include <sinter/config.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <sinter/opcode.h>
+#include <sinter/program.h>
+#include <sinter/heap.h>
+#include <sinter/fault.h>
+#include <sinter/debug.h>
+#include <sinter/chunk.h>
+
+/*
+ * Relocation of chunks loaded with sinter_load_chunk.
+ *
+ * Addresses in SVML are offsets from the start of the program, and the
+ * functions of the program and of chunks loaded before stay where they are, so
+ * a chunk placed after them runs as part of the same program once the
+ * addresses in it are offset by its position.
+ *
+ * The code of a function is not delimited, so the instructions to relocate are
+ * found by following branches and op_new_c from the entry point, like
+ * sispecialise_program does. This is done in two passes over the basic blocks
+ * (the instructions that are branched to or follow a branch): the first finds
+ * and checks all of them, and the second relocates each instruction once.
+ */
+
+// each byte of the chunk has two bits in the marks
+#define MARK_LEADER 1u
+#define MARK_WALKED 2u
+
+typedef struct {
+  unsigned char *chunk;
+  address_t size;
+  address_t offset;
+  uint8_t *marks;
+} chunk_t;
+
+static inline unsigned int get_mark(const chunk_t *c, address_t pc) {
+  return (c->marks[pc >> 2] >> ((pc & 3u) << 1)) & 3u;
+}
+
+static inline void set_mark(chunk_t *c, address_t pc, unsigned int mark) {
+  c->marks[pc >> 2] |= (uint8_t) (mark << ((pc & 3u) << 1));
+}
+
+static void invalid_chunk(address_t pc) {
+  SIDEBUG("Invalid chunk at address 0x%x\n", pc);
+  (void) pc;
+  sifault(sinter_fault_invalid_program);
+}
+
+static void add_leader(chunk_t *c, uint64_t pc) {
+  if (pc >= c->size) {
+    invalid_chunk((address_t) pc);
+  }
+  set_mark(c, (address_t) pc, MARK_LEADER);
+}
+
+static void add_function(chunk_t *c, address_t address) {
+  if (address > c->size || c->size - address < sizeof(svm_function_t)) {
+    invalid_chunk(address);
+  }
+  add_leader(c, (uint64_t) address + offsetof(svm_function_t, code));
+}
+
+static inline void relocate(chunk_t *c, opcode_t *instr) {
+  struct op_address *op = (struct op_address *) instr;
+  op->address += c->offset;
+}
+
+/**
+ * Walks the basic block starting at pc, adding the blocks it branches to, and
+ * relocating its instructions if relocate_block is true.
+ */
+static void walk_block(chunk_t *c, address_t pc, bool relocate_block) {
+  set_mark(c, pc, MARK_WALKED);
+  while (true) {
+    const unsigned int size = pc < c->size ? siinstr_size(c->chunk[pc]) : 0;
+    if (!size || c->size - pc < size) {
+      invalid_chunk(pc);
+    }
+    opcode_t *instr = c->chunk + pc;
+    const address_t next = pc + size;
+
+    switch (*instr) {
+    case op_br_t:
+    case op_br_f:
+      add_leader(c, next);
+      // fallthrough
+    case op_br:
+      add_leader(c, (uint64_t) next + (int64_t) ((const struct op_offset *) instr)->offset);
+      return;
+    case op_jmp:
+      add_leader(c, ((const struct op_address *) instr)->address);
+      if (relocate_block) {
+        relocate(c, instr);
+      }
+      return;
+    case op_ret_g:
+    case op_ret_f:
+    case op_ret_b:
+    case op_ret_u:
+    case op_ret_n:
+    case op_call_t:
+    case op_call_t_p:
+    case op_call_t_v:
+      return;
+    case op_new_c:
+      add_function(c, ((const struct op_address *) instr)->address);
+      if (relocate_block) {
+        relocate(c, instr);
+      }
+      break;
+    case op_lgc_s: {
+      const address_t address = ((const struct op_address *) instr)->address;
+      if (address > c->size || c->size - address < sizeof(svm_constant_t)) {
+        invalid_chunk(pc);
+      }
+      if (relocate_block) {
+        relocate(c, instr);
+      }
+      break;
+    }
+    default:
+      break;
+    }
+
+    pc = next;
+    if (pc < c->size && (get_mark(c, pc) & MARK_LEADER)) {
+      // the rest is a block of its own
+      return;
+    }
+  }
+}
+
+void sichunk_relocate(unsigned char *chunk, address_t chunk_size, address_t offset) {
+  svm_header_t *header = (svm_header_t *) chunk;
+  if (chunk_size < sizeof(svm_header_t) || header->magic != SVM_MAGIC) {
+    invalid_chunk(0);
+  }
+
+  const address_t marks_size = chunk_size / 4 + 1;
+  if (marks_size > SIHEAP_MAX_SIZE - sizeof(siheap_header_t)) {
+    sifault(sinter_fault_out_of_memory);
+  }
+  siheap_header_t *scratch = siheap_malloc((address_t) (sizeof(siheap_header_t) + marks_size), sitype_array_data);
+  chunk_t c = { .chunk = chunk, .size = chunk_size, .offset = offset, .marks = (uint8_t *) (scratch + 1) };
+  memset(c.marks, 0, marks_size);
+
+  add_function(&c, header->entry);
+  bool found;
+  do {
+    found = false;
+    for (address_t pc = 0; pc < chunk_size; ++pc) {
+      if (get_mark(&c, pc) == MARK_LEADER) {
+        walk_block(&c, pc, false);
+        found = true;
+      }
+    }
+  } while (found);
+
+  // every block has been checked, and now every instruction is in exactly one
+  for (address_t pc = 0; pc < chunk_size; ++pc) {
+    if (get_mark(&c, pc) & MARK_LEADER) {
+      walk_block(&c, pc, true);
+    }
+  }
+  header->entry += offset;
+
+  siheap_deref(scratch);
+}
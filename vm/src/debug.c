@@ -12,13 +12,13 @@
 
 #if SINTER_DEBUG_LOGLEVEL >= 1
 void debug_nanbox(sinanbox_t v) {
-  SIDEBUG("%"PRIx32 " ", v.as_u32);
+  SIDEBUG("%"PRIxNANBOX " ", NANBOX_BITS(v));
   switch (NANBOX_GETTYPE(v)) {
   NANBOX_CASES_TINT
     SIDEBUG(("integer, value: %" PRId32), NANBOX_INT(v));
     break;
   case NANBOX_TBOOL:
-    SIDEBUG("boolean, value: %d", NANBOX_BOOL(v));
+    SIDEBUG("boolean, value: %d", (int) NANBOX_BOOL(v));
     break;
   case NANBOX_TUNDEF:
     SIDEBUG("undefined");
@@ -27,7 +27,7 @@ void debug_nanbox(sinanbox_t v) {
     SIDEBUG("null");
     break;
   case NANBOX_TIFN:
-    SIDEBUG("internal function, type: %s, number: %d", NANBOX_IFN_TYPE(v) ? "VM-internal" : "primitive", NANBOX_IFN_NUMBER(v));
+    SIDEBUG("internal function, type: %s, number: %d", NANBOX_IFN_TYPE(v) ? "VM-internal" : "primitive", (int) NANBOX_IFN_NUMBER(v));
     break;
   NANBOX_CASES_TPTR
     SIDEBUG("pointer to ");
@@ -37,7 +37,7 @@ void debug_nanbox(sinanbox_t v) {
     if (NANBOX_ISFLOAT(v)) {
       SIDEBUG("float, value: %f", NANBOX_FLOAT(v));
     } else {
-      SIDEBUG("unknown NaNbox value: %08x", v.as_u32);
+      SIDEBUG("unknown NaNbox value: %"PRIxNANBOX, NANBOX_BITS(v));
     }
     break;
   }
@@ -129,10 +129,50 @@ const char *get_opcode_name(opcode_t op) {
     "neg_f",
     "neq_g",
     "neq_f",
-    "neq_b"
+    "neq_b",
+    "add_ii",
+    "add_ff",
+    "sub_ii",
+    "sub_ff",
+    "mul_ii",
+    "mul_ff",
+    "lt_ii",
+    "lt_ff",
+    "gt_ii",
+    "gt_ff",
+    "le_ii",
+    "le_ff",
+    "ge_ii",
+    "ge_ff",
+    "eq_ii",
+    "eq_ff",
+    "neq_ii",
+    "neq_ff",
+    "ldl_n",
+    "stl_n",
+    "ldp_n",
+    "stp_n",
+    "add_nn",
+    "sub_nn",
+    "mul_nn",
+    "div_nn",
+    "mod_nn",
+    "lt_nn",
+    "gt_nn",
+    "le_nn",
+    "ge_nn",
+    "ldl_bw",
+    "ldp_bw",
+    "dup_bw",
+    "lda_bw",
+    "sta_bw",
+    "pop_bw",
+    "ldl_mv",
+    "ldp_mv",
+    "drive"
   };
 
-  if (op > op_neq_b) {
+  if (op > op_drive) {
     return "invalid_opcode";
   } else {
     return opcode_names[op];
@@ -162,7 +202,7 @@ void debug_heap_obj(const siheap_header_t *o) {
   }
   case sitype_strpair: {
     const siheap_strpair_t *s = (const siheap_strpair_t *) o;
-    SIDEBUG("string pair; left %p, right %p", (void *) s->left, (void *) s->right);
+    SIDEBUG("string pair; left %p, right %p, length %d, depth %d", (void *) s->left, (void *) s->right, s->length, s->depth);
     break;
   }
   case sitype_strconst: {
@@ -175,6 +215,11 @@ void debug_heap_obj(const siheap_header_t *o) {
     SIDEBUG("string; address %p; value \"%s\"", (void *) s, s->string);
     break;
   }
+  case sitype_strshort: {
+    const siheap_strshort_t *s = (const siheap_strshort_t *) o;
+    SIDEBUG("short string; address %p; value \"%s\"", (void *) s, s->string);
+    break;
+  }
   case sitype_array: {
     const siheap_array_t *a = (const siheap_array_t *) o;
     SIDEBUG("array; address %p; data address %p; count %d; allocated %d", (void *) a, (void *) a->data, a->count, a->alloc_size);
@@ -188,6 +233,7 @@ void debug_heap_obj(const siheap_header_t *o) {
   case sitype_array_data:
   case sitype_empty:
   case sitype_free:
+  case sitype_arena_free:
   default:
     SIDEBUG("unknown heap object type %d at address %p", o->type, (void *) o);
     break;
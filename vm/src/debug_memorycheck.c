@@ -40,11 +40,9 @@ static void debug_memorycheck_walk_check_nanboxes(sinanbox_t *arr, const size_t
     switch (refobj->type) {
       case sitype_array_data:
       case sitype_free:
+      case sitype_arena_free:
       case sitype_empty:
       case sitype_env:
-      // string caches the result of flattening a strpair, it should never be
-      // referred to in a nanbox
-      case sitype_string:
       default:
         SIBUGV("Unexpected pointer to type %d seen in NaNbox\n", refobj->type);
         assert(false);
@@ -53,6 +51,8 @@ static void debug_memorycheck_walk_check_nanboxes(sinanbox_t *arr, const size_t
       case sitype_array:
       case sitype_strconst:
       case sitype_strpair:
+      case sitype_string:
+      case sitype_strshort:
       case sitype_intcont:
         break;
       case sitype_frame:
@@ -140,9 +140,9 @@ static void debug_memorycheck_walk_do_object_2(const siheap_header_t *obj) {
     assert(c->saved_stack_bottom <= c->saved_stack_top);
 
     // check that the saved stack bottom is in the stack
-    assert(c->saved_stack_bottom >= sistack && c->saved_stack_bottom <= sistack + SINTER_STACK_ENTRIES);
+    assert(c->saved_stack_bottom >= sistack && c->saved_stack_bottom <= sistack + SISTACK_ENTRIES);
     // check that the saved stack limit is in the stack
-    assert(c->saved_stack_limit >= sistack && c->saved_stack_limit <= sistack + SINTER_STACK_ENTRIES);
+    assert(c->saved_stack_limit >= sistack && c->saved_stack_limit <= sistack + SISTACK_ENTRIES);
 
     if (c->saved_env) {
       c->saved_env->header.debug_refcount++;
@@ -161,6 +161,13 @@ static void debug_memorycheck_walk_do_object_2(const siheap_header_t *obj) {
     break;
   }
 
+  case sitype_arena_free: {
+    // check that the refcount is actually zero, and the block is in the arena
+    assert(obj->refcount == 0);
+    assert(SIHEAP_INARENA(obj));
+    break;
+  }
+
   case sitype_function: {
     siheap_function_t *c = (siheap_function_t *) obj;
 
@@ -195,6 +202,16 @@ static void debug_memorycheck_walk_do_object_2(const siheap_header_t *obj) {
     break;
   }
 
+  case sitype_strshort: {
+    siheap_strshort_t *c = (siheap_strshort_t *) obj;
+
+    // check that the string is short and null-terminated
+    assert(c->length <= SISTRSHORT_MAX);
+    assert(c->string[c->length] == '\0');
+
+    break;
+  }
+
   case sitype_strpair: {
     siheap_strpair_t *c = (siheap_strpair_t *) obj;
 
@@ -202,15 +219,26 @@ static void debug_memorycheck_walk_do_object_2(const siheap_header_t *obj) {
     assert(SIHEAP_INRANGE(c->left));
 
     // check that the left points to the right thing
-    assert(c->left->type == sitype_strpair || c->left->type == sitype_string || c->left->type == sitype_strconst);
+    assert(c->left->type == sitype_strpair || c->left->type == sitype_string || c->left->type == sitype_strconst
+      || c->left->type == sitype_strshort);
 
     // check that the right pointer exists, or the string is flattened
     assert((!c->right && c->left->type == sitype_string) || SIHEAP_INRANGE(c->right));
 
-    // check that the left points to the right type
-    // the right CANNOT point to an sitype_string
-    // that is only used to cache the result of flattening a strpair
-    assert(!c->right || c->right->type == sitype_strpair || c->right->type == sitype_strconst);
+    // check that the right points to the right type
+    assert(!c->right || c->right->type == sitype_strpair || c->right->type == sitype_string || c->right->type == sitype_strconst
+      || c->right->type == sitype_strshort);
+
+    // check that the pair is not short enough to be a short string
+    assert(c->length > SISTRSHORT_MAX);
+
+    // check that the cached length is correct
+    assert(c->length == sistrobj_length(c->left) + (c->right ? sistrobj_length(c->right) : 0));
+
+    // check that the cached depth is an upper bound of the actual depth
+    // (it can be larger if a subtree has since been flattened)
+    assert(c->depth <= SISTRPAIR_MAX_DEPTH);
+    assert(c->right ? (c->depth > sistrobj_depth(c->left) && c->depth > sistrobj_depth(c->right)) : c->depth == 0);
 
     c->left->debug_refcount++;
     if (c->right) {
@@ -225,13 +253,16 @@ static void debug_memorycheck_walk_do_object_2(const siheap_header_t *obj) {
     break;
   }
 
-  if (obj->type != sitype_free) {
+  if (obj->type != sitype_free && obj->type != sitype_arena_free) {
     assert(obj->refcount);
   }
 }
 
 static void debug_memorycheck_walk_do_object_3(const siheap_header_t *obj) {
-  assert(obj->refcount == obj->debug_refcount + obj->internal_refcount);
+  // borrowed references on the stack are seen, but not counted
+  assert(obj->refcount + obj->borrow_count == obj->debug_refcount + obj->internal_refcount);
+  // and something else must keep a borrowed object alive
+  assert(!obj->borrow_count || obj->refcount);
 }
 
 #define WALK_HEAP(fn) do { \
@@ -246,8 +277,24 @@ void debug_memorycheck(void) {
   WALK_HEAP(debug_memorycheck_walk_do_object_1);
 
   // walk the stack
-  debug_memorycheck_walk_check_nanboxes(sistack, sistack_top - sistack, true);
-  sistate.env->header.debug_refcount++;
+#ifdef SINTER_TASKS
+  for (unsigned int i = 0; i <= SINTER_MAX_TASKS; ++i) {
+    const sistack_segment_t *segment = sistack_segments + i;
+    if (i != sistack_segment && segment->top) {
+      debug_memorycheck_walk_check_nanboxes(SISTACK_SEGMENT_BASE(i), segment->top - SISTACK_SEGMENT_BASE(i), true);
+      if (segment->env) {
+        segment->env->header.debug_refcount++;
+      }
+    }
+  }
+  sinanbox_t *const stack_base = SISTACK_SEGMENT_BASE(sistack_segment);
+#else
+  sinanbox_t *const stack_base = sistack;
+#endif
+  debug_memorycheck_walk_check_nanboxes(stack_base, sistack_top - stack_base, true);
+  if (sistate.env) {
+    sistate.env->header.debug_refcount++;
+  }
 
   WALK_HEAP(debug_memorycheck_walk_do_object_2);
   WALK_HEAP(debug_memorycheck_walk_do_object_3);
@@ -360,8 +407,10 @@ static void debug_memorycheck_search_do_object(const siheap_header_t *needle, co
   case sitype_empty:
   case sitype_array_data:
   case sitype_free:
+  case sitype_arena_free:
   case sitype_strconst:
   case sitype_string:
+  case sitype_strshort:
   default:
     break;
   }
@@ -7,7 +7,7 @@
 #include <sinter/fault.h>
 #include <sinter/vm.h>
 
-jmp_buf sinter_fault_jmp = { 0 };
+SINTER_THREAD_LOCAL jmp_buf sinter_fault_jmp = { 0 };
 
 /**
  * Faults with the given reason. This will immediately abort execution.
@@ -1,11 +1,20 @@
 #include <sinter/config.h>
 
+#include <string.h>
+
+#ifdef SINTER_REENTRANT
+#include <stdlib.h>
+#endif
+
 #include <sinter.h>
 
 #include <sinter/heap.h>
 #include <sinter/stack.h>
 #include <sinter/program.h>
 #include <sinter/vm.h>
+#include <sinter/specialise.h>
+#include <sinter/snapshot.h>
+#include <sinter/chunk.h>
 
 /**
  * Validates the program header. Faults if it is invalid.
@@ -48,13 +57,14 @@ static void set_result(sinanbox_t exec_result, sinter_value_t *result) {
     break;
   case NANBOX_TIFN:
     result->type = sinter_type_function;
-    result->object_value = exec_result.as_u32;
+    result->object_value = NANBOX_BITS(exec_result);
     break;
   NANBOX_CASES_TPTR {
     siheap_header_t *obj = SIHEAP_NANBOXTOPTR(exec_result);
     switch (obj->type) {
     case sitype_strconst:
     case sitype_string:
+    case sitype_strshort:
     case sitype_strpair:
       result->type = sinter_type_string;
       result->string_value = sistrobj_tocharptr(obj);
@@ -62,16 +72,17 @@ static void set_result(sinanbox_t exec_result, sinter_value_t *result) {
     case sitype_intcont:
     case sitype_function:
       result->type = sinter_type_function;
-      result->object_value = exec_result.as_u32;
+      result->object_value = NANBOX_BITS(exec_result);
       break;
     case sitype_array:
       result->type = sinter_type_array;
-      result->object_value = exec_result.as_u32;
+      result->object_value = NANBOX_BITS(exec_result);
       break;
     case sitype_array_data:
     case sitype_empty:
     case sitype_frame:
     case sitype_free:
+    case sitype_arena_free:
     case sitype_env:
     default:
       SIBUGV("Unexpected return object type %d\n", obj->type);
@@ -84,13 +95,56 @@ static void set_result(sinanbox_t exec_result, sinter_value_t *result) {
       result->type = sinter_type_float;
       result->float_value = NANBOX_FLOAT(exec_result);
     } else {
-      SIBUGV("Unexpected NaNbox: %08x\n", exec_result.as_u32);
+      SIBUGV("Unexpected NaNbox: %"PRIxNANBOX"\n", NANBOX_BITS(exec_result));
     }
     break;
   }
 }
 
-sinter_fault_t sinter_run(const unsigned char *const code, const size_t code_size, sinter_value_t *result) {
+// whether a program was loaded with sinter_load, and can be called into
+static SINTER_THREAD_LOCAL bool program_loaded = false;
+
+/**
+ * Returns whether the loaded program has tasks (see sinter_task_spawn), whose
+ * stacks a snapshot or checkpoint would not save.
+ */
+static bool has_tasks(void) {
+#ifdef SINTER_TASKS
+  for (unsigned int i = 1; i <= SINTER_MAX_TASKS; ++i) {
+    if (sistack_segments[i].top) {
+      return true;
+    }
+  }
+#endif
+  return false;
+}
+
+/**
+ * Runs the entry function of a program that is loaded with sinter_load.
+ *
+ * The program's global environment is kept alive by a frame at the bottom of
+ * the stack, which saves it as its environment. The frame's stack holds the
+ * result of the last call, so that it is kept alive until the next call.
+ */
+static sinanbox_t load_entry(const svm_function_t *entry_fn) {
+  sistack_new(1, NULL, NULL);
+  siheap_env_t *env = sienv_new(NULL, entry_fn->env_size);
+  ((siheap_frame_t *) SIHEAP_NANBOXTOPTR(sistack[0]))->saved_env = env;
+
+  // the entry function releases its own reference when it returns
+  siheap_ref(env);
+  sinanbox_t exec_result = siexec_env(entry_fn, env);
+  sistack_push(exec_result);
+  return exec_result;
+}
+
+/**
+ * Runs a program. If load is true, the program stays loaded afterwards (see
+ * load_entry); if a snapshot is given, the program is loaded from the snapshot
+ * instead of running its entry function.
+ */
+static sinter_fault_t run(const unsigned char *const code, const size_t code_size, const bool program_mutable, const bool load,
+  const unsigned char *const snapshot, const size_t snapshot_size, sinter_value_t *result) {
 #ifndef SINTER_STATIC_HEAP
   if (!siheap) {
     SIDEBUG("Heap not yet initialised!\n");
@@ -98,12 +152,17 @@ sinter_fault_t sinter_run(const unsigned char *const code, const size_t code_siz
   }
 #endif
 
+  program_loaded = false;
   sistate.fault_reason = sinter_fault_none;
   sistate.program = code;
   sistate.program_end = code + code_size;
-  sistate.running = true;
+  __atomic_store_n(&sistate.running, true, __ATOMIC_RELAXED);
   sistate.pc = NULL;
   sistate.env = NULL;
+#ifdef SINTER_QUICKEN
+  sistate.program_mutable = program_mutable;
+  sivm_quicken_reset();
+#endif
 
   if (SINTER_FAULTED()) {
     *result = (sinter_value_t) { 0 };
@@ -117,23 +176,713 @@ sinter_fault_t sinter_run(const unsigned char *const code, const size_t code_siz
   const svm_header_t *header = (const svm_header_t *) code;
   validate_header(header);
 
-  const svm_function_t *entry_fn = (const svm_function_t *) SISTATE_ADDRTOPC(header->entry);
-  sinanbox_t exec_result = siexec(entry_fn, NULL, 0, NULL);
+#ifdef SINTER_SPECIALISE
+  if (program_mutable) {
+    sispecialise_program((unsigned char *) code, code_size);
+  }
+#endif
+#if !defined(SINTER_QUICKEN) && !defined(SINTER_SPECIALISE)
+  (void) program_mutable;
+#endif
+
+  sinanbox_t exec_result;
+  if (snapshot) {
+    sisnapshot_restore(snapshot, snapshot_size);
+    exec_result = sistack[1];
+  } else {
+    const svm_function_t *entry_fn = (const svm_function_t *) SISTATE_ADDRTOPC(header->entry);
+    exec_result = load ? load_entry(entry_fn) : siexec(entry_fn, NULL, 0, NULL);
+  }
+  set_result(exec_result, result);
+  program_loaded = load;
+
+  return sinter_fault_none;
+}
+
+sinter_fault_t sinter_run(const unsigned char *const code, const size_t code_size, sinter_value_t *result) {
+  return run(code, code_size, false, false, NULL, 0, result);
+}
+
+sinter_fault_t sinter_run_mutable(unsigned char *const code, const size_t code_size, sinter_value_t *result) {
+  return run(code, code_size, true, false, NULL, 0, result);
+}
+
+sinter_fault_t sinter_load(const unsigned char *const code, const size_t code_size, sinter_value_t *result) {
+  return run(code, code_size, false, true, NULL, 0, result);
+}
+
+sinter_fault_t sinter_load_mutable(unsigned char *const code, const size_t code_size, sinter_value_t *result) {
+  return run(code, code_size, true, true, NULL, 0, result);
+}
+
+size_t sinter_snapshot_size(void) {
+  return program_loaded ? sisnapshot_size() : 0;
+}
+
+sinter_fault_t sinter_snapshot_save(void *buffer, const size_t buffer_size) {
+  if (!program_loaded) {
+    return sinter_fault_not_loaded;
+  }
+  if (has_tasks()) {
+    return sinter_fault_busy;
+  }
+  if (buffer_size < sisnapshot_size()) {
+    return sinter_fault_out_of_memory;
+  }
+
+  sistate.fault_reason = sinter_fault_none;
+  if (SINTER_FAULTED()) {
+    program_loaded = false;
+    return sistate.fault_reason;
+  }
+  sisnapshot_save(buffer);
+  return sinter_fault_none;
+}
+
+sinter_fault_t sinter_snapshot_load(const unsigned char *const code, const size_t code_size,
+  const void *const snapshot, const size_t snapshot_size, sinter_value_t *result) {
+  return run(code, code_size, false, true, snapshot, snapshot_size, result);
+}
+
+sinter_fault_t sinter_snapshot_load_mutable(unsigned char *const code, const size_t code_size,
+  const void *const snapshot, const size_t snapshot_size, sinter_value_t *result) {
+  return run(code, code_size, true, true, snapshot, snapshot_size, result);
+}
+
+/**
+ * The header of a checkpoint, which is followed by the used part of the heap.
+ *
+ * Unlike a snapshot, the heap is saved as is, so a checkpoint can only be
+ * restored to the heap (and program) it was saved from, but restoring it is
+ * just a copy.
+ */
+typedef struct {
+  const unsigned char *heap;
+  size_t heap_size;
+  const opcode_t *program;
+  const opcode_t *program_end;
+#ifdef SINTER_QUICKEN
+  bool program_mutable;
+#endif
+  size_t heap_used;
+  siheap_free_t *first_free;
+  sinanbox_t stack[2];
+} checkpoint_header_t;
+
+#define CHECKPOINT_HEAP_OFFSET SIHEAP_ALIGN(sizeof(checkpoint_header_t))
+
+size_t sinter_checkpoint_size(void) {
+  return program_loaded ? CHECKPOINT_HEAP_OFFSET + sisnapshot_heap_used() : 0;
+}
+
+sinter_fault_t sinter_checkpoint_save(void *buffer, const size_t buffer_size) {
+  if (!program_loaded) {
+    return sinter_fault_not_loaded;
+  }
+  if (has_tasks()) {
+    return sinter_fault_busy;
+  }
+  const size_t used = sisnapshot_heap_used();
+  if (buffer_size < CHECKPOINT_HEAP_OFFSET + used) {
+    return sinter_fault_out_of_memory;
+  }
+
+  const checkpoint_header_t header = {
+    .heap = siheap,
+    .heap_size = SINTER_HEAP_SIZE,
+    .program = sistate.program,
+    .program_end = sistate.program_end,
+#ifdef SINTER_QUICKEN
+    .program_mutable = sistate.program_mutable,
+#endif
+    .heap_used = used,
+    .first_free = siheap_first_free,
+    .stack = { sistack[0], sistack[1] }
+  };
+  memcpy(buffer, &header, sizeof(header));
+  memcpy((unsigned char *) buffer + CHECKPOINT_HEAP_OFFSET, siheap, used);
+  return sinter_fault_none;
+}
+
+sinter_fault_t sinter_checkpoint_restore(const void *buffer, const size_t buffer_size) {
+  checkpoint_header_t header;
+  if (buffer_size < CHECKPOINT_HEAP_OFFSET) {
+    return sinter_fault_invalid_snapshot;
+  }
+  memcpy(&header, buffer, sizeof(header));
+  if (header.heap != siheap || header.heap_size != SINTER_HEAP_SIZE || buffer_size < CHECKPOINT_HEAP_OFFSET + header.heap_used) {
+    SIDEBUG("Checkpoint is of a different heap\n");
+    return sinter_fault_invalid_snapshot;
+  }
+
+  memcpy(siheap, (const unsigned char *) buffer + CHECKPOINT_HEAP_OFFSET, header.heap_used);
+  siheap_first_free = header.first_free;
+  sistack_init();
+  sistack[0] = header.stack[0];
+  sistack[1] = header.stack[1];
+  sistack_bottom = sistack + 1;
+  sistack_limit = sistack + 2;
+  sistack_top = sistack + 2;
+
+  sistate.program = header.program;
+  sistate.program_end = header.program_end;
+#ifdef SINTER_QUICKEN
+  sistate.program_mutable = header.program_mutable;
+#endif
+  program_loaded = true;
+  return sinter_fault_none;
+}
+
+static siheap_env_t *loaded_globals(void) {
+  return ((siheap_frame_t *) SIHEAP_NANBOXTOPTR(sistack[0]))->saved_env;
+}
+
+/**
+ * Converts a value from the host to a NaN-box, which the caller owns a
+ * reference to. Faults if the value is invalid.
+ */
+static sinanbox_t value_to_nanbox(const sinter_value_t *value) {
+  switch (value->type) {
+  case sinter_type_undefined:
+    return NANBOX_OFUNDEF();
+  case sinter_type_null:
+    return NANBOX_OFNULL();
+  case sinter_type_boolean:
+    return NANBOX_OFBOOL(value->boolean_value);
+  case sinter_type_integer:
+    return NANBOX_WRAP_INT(value->integer_value);
+  case sinter_type_float:
+    return NANBOX_OFFLOAT(value->float_value);
+  case sinter_type_string: {
+    const size_t size = strlen(value->string_value) + 1;
+    if (size > SIHEAP_MAX_SIZE) {
+      sifault(sinter_fault_out_of_memory);
+      return NANBOX_OFEMPTY();
+    }
+    siheap_string_t *str = sistring_new((address_t) size);
+    memcpy(str->string, value->string_value, size);
+    return SIHEAP_PTRTONANBOX(str);
+  }
+  case sinter_type_array:
+  case sinter_type_function: {
+    // objects are passed back as they were returned to the host
+    const sinanbox_t v = NANBOX_WITH_BITS(value->object_value);
+    if (NANBOX_ISIFN(v)) {
+      return v;
+    }
+    if (!NANBOX_ISPTR(v) || !SIHEAP_INRANGE(SIHEAP_NANBOXTOPTR(v))) {
+      sifault(sinter_fault_type);
+      return NANBOX_OFEMPTY();
+    }
+    const siheap_type_t type = ((siheap_header_t *) SIHEAP_NANBOXTOPTR(v))->type;
+    if (value->type == sinter_type_array ? type != sitype_array : type != sitype_function && type != sitype_intcont) {
+      sifault(sinter_fault_type);
+      return NANBOX_OFEMPTY();
+    }
+    siheap_refbox(v);
+    return v;
+  }
+  default:
+    sifault(sinter_fault_type);
+    return NANBOX_OFEMPTY();
+  }
+}
+
+sinter_fault_t sinter_get_global(const uint8_t index, sinter_value_t *value) {
+  if (!program_loaded) {
+    return sinter_fault_not_loaded;
+  }
+
+  siheap_env_t *globals = loaded_globals();
+  if (index >= globals->entry_count) {
+    return sinter_fault_invalid_load;
+  }
+  const sinanbox_t v = globals->entry[index];
+  if (NANBOX_ISEMPTY(v)) {
+    return sinter_fault_uninitialised_load;
+  }
+
+  sistate.fault_reason = sinter_fault_none;
+  if (SINTER_FAULTED()) {
+    // e.g. out of memory flattening a string
+    program_loaded = false;
+    *value = (sinter_value_t) { 0 };
+    return sistate.fault_reason;
+  }
+  set_result(v, value);
+  return sinter_fault_none;
+}
+
+/**
+ * Calls the function on the stack below the arguments, like siexec_nanbox, and
+ * leaves the function on the stack.
+ */
+static sinanbox_t call_loaded(const uint8_t argc) {
+  const sinanbox_t fn = sistack_peek(argc);
+  if (!NANBOX_ISPTR(fn)) {
+    // internal functions release their arguments themselves
+    const sinanbox_t ret = siexec_nanbox(fn, argc, sistack_top - argc);
+    sistack_top -= argc;
+    return ret;
+  }
+
+  siheap_header_t *obj = SIHEAP_NANBOXTOPTR(fn);
+  if (obj->type == sitype_intcont) {
+    // continuations are zero-arity
+    if (argc) {
+      sifault(sinter_fault_function_arity);
+      return NANBOX_OFEMPTY();
+    }
+    return siexec_nanbox(fn, 0, NULL);
+  }
+
+  const siheap_function_t *fn_obj = (const siheap_function_t *) obj;
+  const svm_function_t *fn_code = fn_obj->code;
+  if (argc != fn_code->num_args) {
+    sifault(sinter_fault_function_arity);
+    return NANBOX_OFEMPTY();
+  }
+  if (fn_code->num_args > fn_code->env_size) {
+    sifault(sinter_fault_invalid_load);
+    return NANBOX_OFEMPTY();
+  }
+
+  // the arguments stay on the stack until they are in the new environment
+  siheap_env_t *env = sienv_new(fn_obj->env, fn_code->env_size);
+  sistack_top -= argc;
+  memcpy(env->entry, sistack_top, argc*sizeof(sinanbox_t));
+  return siexec_env(fn_code, env);
+}
+
+/**
+ * Calls a function of the loaded program; if arena is true, with its
+ * allocations taken from the arena.
+ */
+static sinter_fault_t call(const sinter_value_t *fn, const uint8_t argc, const sinter_value_t *argv, sinter_value_t *result,
+  const bool arena) {
+  if (!program_loaded) {
+    return sinter_fault_not_loaded;
+  }
+  if (fn->type != sinter_type_function) {
+    return sinter_fault_type;
+  }
+
+  sistate.fault_reason = sinter_fault_none;
+  __atomic_store_n(&sistate.running, true, __ATOMIC_RELAXED);
+  sistate.pc = NULL;
+  sistate.env = NULL;
+
+  if (SINTER_FAULTED()) {
+    // the state of the program is unknown after a fault
+    program_loaded = false;
+#ifdef SINTER_ARENA
+    siarena_reset();
+#endif
+    *result = (sinter_value_t) { 0 };
+    return sistate.fault_reason;
+  }
+
+#ifdef SINTER_ARENA
+  if (arena) {
+    siarena_open();
+  }
+#else
+  (void) arena;
+#endif
+
+  // the stack holds the result of the last call, then the function and the
+  // arguments, so that they are all reachable while the call allocates
+  sistack_limit = sistack_bottom + 2 + argc;
+  sistack_push(value_to_nanbox(fn));
+  for (unsigned int i = 0; i < argc; ++i) {
+    sistack_push(value_to_nanbox(argv + i));
+  }
+
+  const sinanbox_t exec_result = call_loaded(argc);
+
+  siheap_derefbox(sistack_pop());
+  siheap_derefbox(sistack_bottom[0]);
+  sistack_bottom[0] = exec_result;
+  sistack_limit = sistack_bottom + 1;
+#ifdef SINTER_ARENA
+  siarena_close();
+#endif
+
   set_result(exec_result, result);
+  return sinter_fault_none;
+}
+
+sinter_fault_t sinter_call(const sinter_value_t *fn, const uint8_t argc, const sinter_value_t *argv, sinter_value_t *result) {
+  return call(fn, argc, argv, result, false);
+}
 
+#ifdef SINTER_ARENA
+sinter_fault_t sinter_call_arena(const sinter_value_t *fn, const uint8_t argc, const sinter_value_t *argv, sinter_value_t *result) {
+  return call(fn, argc, argv, result, true);
+}
+#endif
+
+sinter_fault_t sinter_load_chunk(unsigned char *const chunk, const size_t chunk_size, sinter_value_t *result) {
+  if (!program_loaded) {
+    return sinter_fault_not_loaded;
+  }
+  // addresses are offsets from the start of the program, which the chunk must
+  // come after
+  const uintptr_t start = (uintptr_t) sistate.program;
+  if ((uintptr_t) chunk < (uintptr_t) sistate.program_end || (uintptr_t) chunk - start > UINT32_MAX - chunk_size) {
+    return sinter_fault_invalid_program;
+  }
+
+  sistate.fault_reason = sinter_fault_none;
+  __atomic_store_n(&sistate.running, true, __ATOMIC_RELAXED);
+  sistate.pc = NULL;
+  sistate.env = NULL;
+
+  if (SINTER_FAULTED()) {
+    program_loaded = false;
+    *result = (sinter_value_t) { 0 };
+    return sistate.fault_reason;
+  }
+
+  sichunk_relocate(chunk, (address_t) chunk_size, (address_t) ((uintptr_t) chunk - start));
+  sistate.program_end = chunk + chunk_size;
+
+  // the chunk's environment replaces the frame's reference to the globals
+  const svm_function_t *entry_fn = (const svm_function_t *) SISTATE_ADDRTOPC(((const svm_header_t *) chunk)->entry);
+  siheap_frame_t *frame = (siheap_frame_t *) SIHEAP_NANBOXTOPTR(sistack[0]);
+  siheap_env_t *globals = frame->saved_env;
+  siheap_env_t *env = sienv_new(globals, entry_fn->env_size);
+  frame->saved_env = env;
+  siheap_deref(globals);
+
+  siheap_ref(env);
+  const sinanbox_t exec_result = siexec_env(entry_fn, env);
+
+  siheap_derefbox(sistack_bottom[0]);
+  sistack_bottom[0] = exec_result;
+
+  set_result(exec_result, result);
   return sinter_fault_none;
 }
 
+#ifdef SINTER_TASKS
+// the task that runs after the last one run
+static SINTER_THREAD_LOCAL unsigned int next_task;
+// whether each task (by stack segment) is suspended until sinter_task_resume
+static SINTER_THREAD_LOCAL bool task_waiting[SINTER_MAX_TASKS + 1];
+
+/**
+ * Returns the stack segment of the next task to run, starting from the given
+ * one, or 0 if there is none. If free is true, returns the next unused segment
+ * instead.
+ */
+static unsigned int find_segment(unsigned int first, bool free) {
+  for (unsigned int i = 0; i < SINTER_MAX_TASKS; ++i) {
+    const unsigned int segment = (first + i) % SINTER_MAX_TASKS + 1;
+    if ((sistack_segments[segment].top == NULL) == free && (free || !task_waiting[segment])) {
+      return segment;
+    }
+  }
+  return 0;
+}
+
+sinter_fault_t sinter_task_spawn(const sinter_value_t *fn, const uint8_t argc, const sinter_value_t *argv, unsigned int *task) {
+  if (!program_loaded) {
+    return sinter_fault_not_loaded;
+  }
+  if (fn->type != sinter_type_function) {
+    return sinter_fault_type;
+  }
+  const unsigned int segment = find_segment(0, true);
+  if (!segment) {
+    return sinter_fault_busy;
+  }
+
+  sistate.fault_reason = sinter_fault_none;
+  __atomic_store_n(&sistate.running, true, __ATOMIC_RELAXED);
+
+  if (SINTER_FAULTED()) {
+    program_loaded = false;
+    sistack_init();
+    return sistate.fault_reason;
+  }
+
+  // the function and arguments are pushed to the task's own stack, so that
+  // they are reachable while the arguments are converted
+  sinanbox_t *const base = SISTACK_SEGMENT_BASE(segment);
+  sistack_segments[segment] = (sistack_segment_t) { .bottom = base, .limit = base + 1 + argc, .top = base };
+  task_waiting[segment] = false;
+  sistack_switch(segment);
+  sistack_push(value_to_nanbox(fn));
+  for (unsigned int i = 0; i < argc; ++i) {
+    sistack_push(value_to_nanbox(argv + i));
+  }
+
+  const sinanbox_t fn_v = sistack_peek(argc);
+  siheap_header_t *const obj = NANBOX_ISPTR(fn_v) ? SIHEAP_NANBOXTOPTR(fn_v) : NULL;
+  if (!obj || obj->type != sitype_function) {
+    sifault(sinter_fault_type);
+  }
+  const siheap_function_t *fn_obj = (const siheap_function_t *) obj;
+  const svm_function_t *fn_code = fn_obj->code;
+  if (argc != fn_code->num_args) {
+    sifault(sinter_fault_function_arity);
+  }
+  if (fn_code->num_args > fn_code->env_size) {
+    sifault(sinter_fault_invalid_load);
+  }
+
+  // set up the call like op_call does, with a frame that returns to the host,
+  // and leaves the result at the base of the task's stack
+  siheap_env_t *env = sienv_new(fn_obj->env, fn_code->env_size);
+  sistack_top -= argc;
+  memcpy(env->entry, sistack_top, argc*sizeof(sinanbox_t));
+  siheap_derefbox(sistack_pop());
+  sistack_new(fn_code->stack_size, NULL, NULL);
+  sistate.env = env;
+  sistate.pc = &fn_code->code;
+
+  sistack_switch(0);
+  *task = segment - 1;
+  return sinter_fault_none;
+}
+
+sinter_fault_t sinter_task_step(const uint32_t budget, int *task, sinter_value_t *result) {
+  *task = -1;
+  *result = (sinter_value_t) { 0 };
+  if (!program_loaded) {
+    return sinter_fault_not_loaded;
+  }
+
+  const unsigned int segment = find_segment(next_task, false);
+  if (!segment) {
+    return has_tasks() ? sinter_fault_busy : sinter_fault_none;
+  }
+  *task = segment - 1;
+  next_task = segment % SINTER_MAX_TASKS;
+
+  sistate.fault_reason = sinter_fault_none;
+  __atomic_store_n(&sistate.running, true, __ATOMIC_RELAXED);
+
+  if (SINTER_FAULTED()) {
+    program_loaded = false;
+    sistack_init();
+    return sistate.fault_reason;
+  }
+
+  // a task that suspended itself by a tail call may have returned already, and
+  // its result is only known once it is resumed
+  sistack_switch(segment);
+  if ((sistate.pc && !sivm_resume(budget ? budget : 1)) || task_waiting[segment]) {
+    sistack_switch(0);
+    return sinter_fault_none;
+  }
+
+  // the result replaces that of the last call, which keeps it alive
+  const sinanbox_t exec_result = sistack_pop();
+  sistack_switch(0);
+  sistack_segments[segment].top = NULL;
+  siheap_derefbox(sistack_bottom[0]);
+  sistack_bottom[0] = exec_result;
+
+  set_result(exec_result, result);
+  return sinter_fault_none;
+}
+
+int sinter_task_current(void) {
+  return (int) sistack_segment - 1;
+}
+
+void sinter_task_yield(void) {
+  sistate.budget = 0;
+}
+
+int sinter_task_suspend(void) {
+  if (!sistack_segment || sistate.exec_depth) {
+    return -1;
+  }
+  task_waiting[sistack_segment] = true;
+  sistate.budget = 0;
+  return (int) sistack_segment - 1;
+}
+
+sinter_fault_t sinter_task_resume(const unsigned int task, const sinter_value_t *result) {
+  if (!program_loaded) {
+    return sinter_fault_not_loaded;
+  }
+  const unsigned int segment = task + 1;
+  if (task >= SINTER_MAX_TASKS || !sistack_segments[segment].top || !task_waiting[segment]) {
+    return sinter_fault_none;
+  }
+
+  sistate.fault_reason = sinter_fault_none;
+  __atomic_store_n(&sistate.running, true, __ATOMIC_RELAXED);
+
+  if (SINTER_FAULTED()) {
+    program_loaded = false;
+    sistack_init();
+    return sistate.fault_reason;
+  }
+
+  // the result replaces the placeholder that the VM-internal function returned,
+  // which is on top of the task's stack
+  sinanbox_t *const slot = sistack_segments[segment].top - 1;
+  const sinanbox_t value = value_to_nanbox(result);
+  siheap_derefbox(*slot);
+  *slot = value;
+  task_waiting[segment] = false;
+  return sinter_fault_none;
+}
+#endif
+
+#ifdef SINTER_INLINE_CALLS
+size_t sinter_inline_calls(unsigned char *const code, const size_t code_size, const size_t buffer_size) {
+#ifndef SINTER_STATIC_HEAP
+  if (!siheap) {
+    SIDEBUG("Heap not yet initialised!\n");
+    return code_size;
+  }
+#endif
+
+  if (code_size < sizeof(svm_header_t) || ((const svm_header_t *) code)->magic != SVM_MAGIC) {
+    return code_size;
+  }
+
+  // the heap is only used as scratch memory, and is reset again when the
+  // program is run
+  program_loaded = false;
+  siheap_init();
+  return siinline_program(code, code_size, buffer_size);
+}
+#endif
+
 void sinter_setup_heap(void *heap, size_t size) {
 #ifdef SINTER_STATIC_HEAP
 (void) heap; (void) size;
 return;
 #else
-  siheap = heap;
-  siheap_size = size;
+  // heap blocks are aligned relative to the start of the heap, so the start
+  // must be aligned too
+  const size_t misalignment = (uintptr_t) heap % SIHEAP_ALIGNMENT;
+  const size_t skip = misalignment ? SIHEAP_ALIGNMENT - misalignment : 0;
+  size = size > skip ? size - skip : 0;
+  if (size > SIHEAP_MAX_SIZE) {
+    size = SIHEAP_MAX_SIZE;
+  }
+  siheap = ((unsigned char *) heap) + skip;
+  siheap_size = size & ~(size_t) (SIHEAP_ALIGNMENT - 1);
 #endif
 }
 
 void sinter_stop(void) {
   sistop();
 }
+
+#ifdef SINTER_REENTRANT
+struct sinter_vm {
+  void *heap;
+  size_t heap_size;
+  sinter_printfn_string printer_string;
+  sinter_printfn_integer printer_integer;
+  sinter_printfn_float printer_float;
+  sinter_printfn_flush printer_flush;
+  const sivmfn_t *vminternals;
+  size_t vminternal_count;
+  void *user_data;
+  // set to stop the program running on the instance, which may be on another
+  // thread; the thread's sistate.stop_requested points here while it runs
+  bool stop_requested;
+};
+
+static SINTER_THREAD_LOCAL sinter_vm_t *current_vm;
+
+sinter_vm_t *sinter_vm_create(size_t heap_size, void *user_data) {
+  sinter_vm_t *vm = malloc(sizeof(sinter_vm_t));
+  void *heap = malloc(heap_size);
+  if (!vm || !heap) {
+    free(vm);
+    free(heap);
+    return NULL;
+  }
+
+  *vm = (sinter_vm_t) {
+    .heap = heap,
+    .heap_size = heap_size,
+    .printer_string = sinter_printer_string,
+    .printer_integer = sinter_printer_integer,
+    .printer_float = sinter_printer_float,
+    .printer_flush = sinter_printer_flush,
+    .vminternals = sivmfn_vminternals,
+    .vminternal_count = sivmfn_vminternal_count,
+    .user_data = user_data
+  };
+  return vm;
+}
+
+/**
+ * Runs the program with the thread's state set up for the instance. The
+ * instance stays installed afterwards, so that object results (which refer to
+ * its heap) can be inspected.
+ */
+static sinter_fault_t vm_run(sinter_vm_t *vm, const unsigned char *code, size_t code_size, bool program_mutable, bool load, sinter_value_t *result) {
+  sinter_setup_heap(vm->heap, vm->heap_size);
+  sinter_printer_string = vm->printer_string;
+  sinter_printer_integer = vm->printer_integer;
+  sinter_printer_float = vm->printer_float;
+  sinter_printer_flush = vm->printer_flush;
+  sivmfn_vminternals = vm->vminternals;
+  sivmfn_vminternal_count = vm->vminternal_count;
+  current_vm = vm;
+  // a stop requested while the instance was not running is not carried over
+  __atomic_store_n(&vm->stop_requested, false, __ATOMIC_RELAXED);
+  sistate.stop_requested = &vm->stop_requested;
+
+  const sinter_fault_t fault = run(code, code_size, program_mutable, load, NULL, 0, result);
+  sistate.stop_requested = NULL;
+  return fault;
+}
+
+sinter_fault_t sinter_vm_run(sinter_vm_t *vm, const unsigned char *code, const size_t code_size, sinter_value_t *result) {
+  return vm_run(vm, code, code_size, false, false, result);
+}
+
+sinter_fault_t sinter_vm_run_mutable(sinter_vm_t *vm, unsigned char *code, const size_t code_size, sinter_value_t *result) {
+  return vm_run(vm, code, code_size, true, false, result);
+}
+
+sinter_fault_t sinter_vm_load(sinter_vm_t *vm, const unsigned char *code, const size_t code_size, sinter_value_t *result) {
+  return vm_run(vm, code, code_size, false, true, result);
+}
+
+sinter_fault_t sinter_vm_load_mutable(sinter_vm_t *vm, unsigned char *code, const size_t code_size, sinter_value_t *result) {
+  return vm_run(vm, code, code_size, true, true, result);
+}
+
+void sinter_vm_stop(sinter_vm_t *vm) {
+  // only the instance is written to, so this is safe even if the thread it
+  // was running on has moved on to another instance, or exited
+  __atomic_store_n(&vm->stop_requested, true, __ATOMIC_RELAXED);
+}
+
+void sinter_vm_destroy(sinter_vm_t *vm) {
+  if (!vm) {
+    return;
+  }
+  if (current_vm == vm) {
+    current_vm = NULL;
+    program_loaded = false;
+    siheap = NULL;
+    siheap_size = 0;
+  }
+  free(vm->heap);
+  free(vm);
+}
+
+sinter_vm_t *sinter_vm_current(void) {
+  return current_vm;
+}
+
+void *sinter_vm_user_data(const sinter_vm_t *vm) {
+  return vm->user_data;
+}
+#endif
@@ -9,23 +9,36 @@
 #include <sinter/nanbox.h>
 
 #ifdef SINTER_STATIC_HEAP
-unsigned char siheap[SINTER_HEAP_SIZE] = { 0 };
+_Alignas(SIHEAP_ALIGNMENT) unsigned char siheap[SINTER_HEAP_SIZE] = { 0 };
 #else
-unsigned char *siheap = NULL;
-size_t siheap_size = 0;
+SINTER_THREAD_LOCAL unsigned char *siheap = NULL;
+SINTER_THREAD_LOCAL size_t siheap_size = 0;
 #endif
 
 #ifdef SINTER_DEBUG
-bool siheap_sweeping = 0;
+SINTER_THREAD_LOCAL bool siheap_sweeping = 0;
 #endif
 
-siheap_free_t *siheap_first_free = NULL;
+SINTER_THREAD_LOCAL siheap_free_t *siheap_first_free = NULL;
 
-sinanbox_t sistack[SINTER_STACK_ENTRIES];
+#ifdef SINTER_ARENA
+SINTER_THREAD_LOCAL unsigned char *siarena_start = NULL;
+SINTER_THREAD_LOCAL unsigned char *siarena_end = NULL;
+SINTER_THREAD_LOCAL siheap_header_t *siarena_rest = NULL;
+#endif
+
+SINTER_THREAD_LOCAL sinanbox_t sistack[SISTACK_ENTRIES];
 
-sinanbox_t *sistack_bottom = sistack;
-sinanbox_t *sistack_limit = sistack;
-sinanbox_t *sistack_top = sistack;
+// set by sistack_init (the address of a thread-local array is not a constant)
+SINTER_THREAD_LOCAL sinanbox_t *sistack_bottom = NULL;
+SINTER_THREAD_LOCAL sinanbox_t *sistack_limit = NULL;
+SINTER_THREAD_LOCAL sinanbox_t *sistack_top = NULL;
+
+#ifdef SINTER_TASKS
+SINTER_THREAD_LOCAL sistack_segment_t sistack_segments[SINTER_MAX_TASKS + 1];
+SINTER_THREAD_LOCAL unsigned int sistack_segment = 0;
+SINTER_THREAD_LOCAL sinanbox_t *sistack_end = NULL;
+#endif
 
 /**
  * Runs the destructor for the given heap object.
@@ -58,10 +71,12 @@ void siheap_mdestroy(siheap_header_t *ent) {
   case sitype_frame:
   case sitype_strconst:
   case sitype_string:
+  case sitype_strshort:
     break;
   default:
   case sitype_empty:
   case sitype_free:
+  case sitype_arena_free:
     SIBUGV("Attempting to destroy object of type %d\n", ent->type);
     assert(false);
     break;
@@ -133,9 +148,11 @@ static void siheap_mark(siheap_header_t *vent) {
     case sitype_array_data:
     case sitype_strconst:
     case sitype_string:
+    case sitype_strshort:
       // These types have no children, no need to do anything
       break;
     case sitype_free:
+    case sitype_arena_free:
       SIBUGM("Attempting to mark free block\n");
       break;
     case sitype_empty:
@@ -171,8 +188,28 @@ static inline void siheap_sweep(void) {
 }
 
 void siheap_mark_sweep(void) {
+#ifdef SINTER_ARENA
+   // the sweep merges free blocks, which the arena cannot have
+   siarena_close();
+#endif
+#ifdef SINTER_TASKS
+   // the segments that are not running
+   for (unsigned int i = 0; i <= SINTER_MAX_TASKS; ++i) {
+      const sistack_segment_t *segment = sistack_segments + i;
+      if (i == sistack_segment || !segment->top) {
+         continue;
+      }
+      for (sinanbox_t *curr = SISTACK_SEGMENT_BASE(i); curr < segment->top; ++curr) {
+         siheap_markbox(*curr);
+      }
+      siheap_mark(&segment->env->header);
+   }
+   sinanbox_t *const stack_base = SISTACK_SEGMENT_BASE(sistack_segment);
+#else
+   sinanbox_t *const stack_base = sistack;
+#endif
    sinanbox_t *curr = sistack_top - 1;
-   while (curr >= sistack) {
+   while (curr >= stack_base) {
       siheap_markbox(*(curr--));
    }
    siheap_mark(&sistate.env->header);
@@ -183,101 +220,419 @@ void sistack_init(void) {
   sistack_bottom = sistack;
   sistack_limit = sistack;
   sistack_top = sistack;
+#ifdef SINTER_TASKS
+  // this also discards all tasks
+  memset(sistack_segments, 0, sizeof(sistack_segments));
+  sistack_segment = 0;
+  sistack_end = sistack + SINTER_STACK_ENTRIES;
+#endif
 }
 
-static address_t sizeof_strobj(siheap_header_t *obj) {
-  switch (obj->type) {
-  case sitype_strconst: {
-    siheap_strconst_t *v = (siheap_strconst_t *) obj;
-    return v->string->length - 1;
+#ifdef SINTER_ARENA
+void siarena_open(void) {
+  if (siarena_rest) {
+    return;
   }
 
-  case sitype_strpair: {
-    siheap_strpair_t *v = (siheap_strpair_t *) obj;
-    return sizeof_strobj(v->left) + (v->right ? sizeof_strobj(v->right) : 0);
+  siheap_free_t *largest = NULL;
+  for (siheap_free_t *cur = siheap_first_free; cur; cur = cur->next_free) {
+    if (!largest || cur->header.size > largest->header.size) {
+      largest = cur;
+    }
+  }
+  if (!largest) {
+    return;
   }
 
-  case sitype_string: {
-    siheap_string_t *v = (siheap_string_t *) obj;
-    return v->header.size - sizeof(siheap_string_t) - 1;
+  siheap_free_remove(largest);
+  largest->header.type = sitype_arena_free;
+  siarena_start = (unsigned char *) largest;
+  siarena_end = siarena_start + largest->header.size;
+  siarena_rest = &largest->header;
+}
+
+void siarena_close(void) {
+  if (!siarena_rest) {
+    return;
   }
 
-  case sitype_intcont:
+  // siheap_mfree_inner adds blocks to the free list only outside the arena
+  unsigned char *const end = siarena_end;
+  siheap_header_t *curr = (siheap_header_t *) siarena_start;
+  siarena_reset();
+
+  while ((unsigned char *) curr < end) {
+    if (curr->type != sitype_arena_free) {
+      curr = siheap_next(curr);
+      continue;
+    }
+
+    // merge each run of free blocks into one, which may merge in turn with the
+    // free blocks before and after the arena
+    siheap_header_t *run_end = siheap_next(curr);
+    while ((unsigned char *) run_end < end && run_end->type == sitype_arena_free) {
+      run_end = siheap_next(run_end);
+    }
+    curr->size = (address_t) ((unsigned char *) run_end - (unsigned char *) curr);
+    siheap_fix_next(curr);
+    curr = siheap_next(siheap_mfree_inner(curr));
+  }
+}
+#endif
+
+#ifdef SINTER_TASKS
+void sistack_switch(unsigned int segment) {
+  sistack_segment_t *saved = sistack_segments + sistack_segment;
+  saved->bottom = sistack_bottom;
+  saved->limit = sistack_limit;
+  saved->top = sistack_top;
+  saved->env = sistate.env;
+  saved->pc = sistate.pc;
+
+  const sistack_segment_t *installed = sistack_segments + segment;
+  sistack_bottom = installed->bottom;
+  sistack_limit = installed->limit;
+  sistack_top = installed->top;
+  sistate.env = installed->env;
+  sistate.pc = installed->pc;
+  sistack_segment = segment;
+  sistack_end = segment ? SISTACK_SEGMENT_BASE(segment) + SINTER_TASK_STACK_ENTRIES : sistack + SINTER_STACK_ENTRIES;
+}
+#endif
+
+siheap_string_t *sistrpair_flatten(siheap_strpair_t *obj) {
+  if (!obj->right) {
+    return (siheap_string_t *) obj->left;
+  }
+
+  siheap_string_t *string = sistring_new(obj->length + 1);
+
+  char *to = string->string;
+  sistrobj_iter_t iter;
+  sistrobj_iter_init(&iter, &obj->header);
+  const char *piece;
+  address_t length;
+  while (sistrobj_iter_next(&iter, &piece, &length)) {
+    memcpy(to, piece, length);
+    to += length;
+  }
+  *to = '\0';
+
+  siheap_deref(obj->left);
+  siheap_deref(obj->right);
+
+  obj->left = &string->header;
+  obj->right = NULL;
+  obj->depth = 0;
+  return string;
+}
+
+uint32_t sistrobj_hash(siheap_header_t *obj) {
+  uint32_t *cached;
+  switch (obj->type) {
+  case sitype_strconst:
+    cached = &((siheap_strconst_t *) obj)->hash;
+    break;
+  case sitype_strpair:
+    cached = &((siheap_strpair_t *) obj)->hash;
+    break;
+  case sitype_string:
+    cached = &((siheap_string_t *) obj)->hash;
+    break;
+  case sitype_strshort:
+    // not cached; short strings are cheap to hash
+    cached = NULL;
+    break;
+  case sitype_array:
   case sitype_array_data:
   case sitype_empty:
-  case sitype_frame:
   case sitype_free:
-  case sitype_env:
-  case sitype_array:
+  case sitype_arena_free:
   case sitype_function:
+  case sitype_frame:
+  case sitype_env:
+  case sitype_intcont:
   default:
     SIBUGM("Unknown string type\n");
     sifault(sinter_fault_internal_error);
-    break;
+    return 0;
   }
+
+  if (cached && *cached) {
+    return *cached;
+  }
+
+  // 32-bit FNV-1a
+  uint32_t hash = 0x811c9dc5u;
+  sistrobj_iter_t iter;
+  sistrobj_iter_init(&iter, obj);
+  const char *piece;
+  address_t length;
+  while (sistrobj_iter_next(&iter, &piece, &length)) {
+    for (address_t i = 0; i < length; ++i) {
+      hash = (hash ^ (unsigned char) piece[i]) * 0x01000193u;
+    }
+  }
+
+  // 0 means "not computed"
+  if (!hash) {
+    hash = 1;
+  }
+  if (cached) {
+    *cached = hash;
+  }
+  return hash;
 }
 
-static void write_strobj(siheap_header_t *obj, char **to) {
-  if (!obj) {
-    return;
+bool sistrobj_equal(siheap_header_t *left, siheap_header_t *right) {
+  if (left == right) {
+    return true;
   }
-  switch (obj->type) {
-  case sitype_strconst: {
-    siheap_strconst_t *v = (siheap_strconst_t *) obj;
-    const address_t size = v->string->length - 1;
-    memcpy(*to, v->string->data, size);
-    *to += size;
-    return;
+
+  const address_t length = sistrobj_length(left);
+  if (length != sistrobj_length(right) || sistrobj_hash(left) != sistrobj_hash(right)) {
+    return false;
   }
 
-  case sitype_strpair: {
-    siheap_strpair_t *v = (siheap_strpair_t *) obj;
-    write_strobj(v->left, to);
-    write_strobj(v->right, to);
-    return;
+  return sistrobj_compare(left, right) == 0;
+}
+
+int sistrobj_compare(siheap_header_t *left, siheap_header_t *right) {
+  if (left == right) {
+    return 0;
   }
 
-  case sitype_string: {
-    siheap_string_t *v = (siheap_string_t *) obj;
-    const address_t size = v->size - 1;
-    memcpy(*to, v->string, size);
-    *to += size;
-    return;
+  sistrobj_iter_t liter, riter;
+  sistrobj_iter_init(&liter, left);
+  sistrobj_iter_init(&riter, right);
+  const char *lpiece = NULL, *rpiece = NULL;
+  address_t llength = 0, rlength = 0;
+
+  while (true) {
+    // skip to the next non-empty piece of each side
+    while (!llength && sistrobj_iter_next(&liter, &lpiece, &llength)) {}
+    while (!rlength && sistrobj_iter_next(&riter, &rpiece, &rlength)) {}
+
+    if (!llength || !rlength) {
+      // at least one side has ended; the shorter string is smaller
+      return (llength > 0) - (rlength > 0);
+    }
+
+    const address_t length = llength < rlength ? llength : rlength;
+    const int result = memcmp(lpiece, rpiece, length);
+    if (result) {
+      return result;
+    }
+    lpiece += length;
+    rpiece += length;
+    llength -= length;
+    rlength -= length;
   }
+}
 
-  case sitype_intcont:
-  case sitype_array_data:
-  case sitype_empty:
-  case sitype_frame:
-  case sitype_free:
-  case sitype_env:
-  case sitype_array:
-  case sitype_function:
-  default:
-    SIBUGM("Unknown string type\n");
-    sifault(sinter_fault_internal_error);
-    break;
+/**
+ * Copies the contents of the string object obj to to, which must be large
+ * enough. No null terminator is written. Returns the number of bytes copied.
+ */
+static address_t strobj_copy(char *to, siheap_header_t *obj) {
+  sistrobj_iter_t iter;
+  sistrobj_iter_init(&iter, obj);
+  const char *piece;
+  address_t length, total = 0;
+  while (sistrobj_iter_next(&iter, &piece, &length)) {
+    memcpy(to + total, piece, length);
+    total += length;
   }
+  return total;
 }
 
-siheap_string_t *sistrpair_flatten(siheap_strpair_t *obj) {
-  if (!obj->right) {
-    return (siheap_string_t *) obj->left;
+/**
+ * Creates a short string containing left followed by right, which must be at
+ * most SISTRSHORT_MAX bytes long in total. Returns a new reference.
+ */
+static siheap_header_t *strshort_concat(siheap_header_t *left, siheap_header_t *right) {
+  siheap_strshort_t *obj = sistrshort_new();
+  address_t length = strobj_copy(obj->string, left);
+  length += strobj_copy(obj->string + length, right);
+  assert(length <= SISTRSHORT_MAX);
+  obj->string[length] = '\0';
+  obj->length = (uint8_t) length;
+  return &obj->header;
+}
+
+/**
+ * Creates a string pair from two trees whose depths differ by at most 2,
+ * rotating to restore balance if needed.
+ *
+ * The caller's references to left and right are consumed. Returns a new reference.
+ */
+static siheap_header_t *strpair_join(siheap_header_t *left, siheap_header_t *right) {
+  const unsigned int left_depth = sistrobj_depth(left), right_depth = sistrobj_depth(right);
+  siheap_header_t *a, *b, *c, *d;
+
+  if (left_depth > right_depth + 1) {
+    siheap_strpair_t *l = (siheap_strpair_t *) left;
+    if (sistrobj_depth(l->left) >= sistrobj_depth(l->right)) {
+      // ((a b) c) => (a (b c))
+      a = l->left; b = l->right; c = right;
+      siheap_ref(a);
+      siheap_ref(b);
+      siheap_deref(left);
+      return strpair_join(a, strpair_join(b, c));
+    }
+
+    // (a (b c)) d => ((a b) (c d))
+    siheap_strpair_t *lr = (siheap_strpair_t *) l->right;
+    a = l->left; b = lr->left; c = lr->right; d = right;
+    siheap_ref(a);
+    siheap_ref(b);
+    siheap_ref(c);
+    siheap_deref(left);
+  } else if (right_depth > left_depth + 1) {
+    siheap_strpair_t *r = (siheap_strpair_t *) right;
+    if (sistrobj_depth(r->right) >= sistrobj_depth(r->left)) {
+      // (a (b c)) => ((a b) c)
+      a = left; b = r->left; c = r->right;
+      siheap_ref(b);
+      siheap_ref(c);
+      siheap_deref(right);
+      return strpair_join(strpair_join(a, b), c);
+    }
+
+    // a ((b c) d) => ((a b) (c d))
+    siheap_strpair_t *rl = (siheap_strpair_t *) r->left;
+    a = left; b = rl->left; c = rl->right; d = r->right;
+    siheap_ref(b);
+    siheap_ref(c);
+    siheap_ref(d);
+    siheap_deref(right);
+  } else {
+    // short results are stored inline, so string pairs are always longer than
+    // SISTRSHORT_MAX (and so never flatten to a short string)
+    siheap_header_t *pair = sistrobj_length(left) + sistrobj_length(right) <= SISTRSHORT_MAX
+      ? strshort_concat(left, right)
+      : &sistrpair_new(left, right)->header;
+    siheap_deref(left);
+    siheap_deref(right);
+    return pair;
   }
 
-  address_t strsize = sizeof_strobj(&obj->header);
-  siheap_string_t *string = sistring_new(strsize + 1);
+  return strpair_join(strpair_join(a, b), strpair_join(c, d));
+}
 
-  char *to = string->string;
-  write_strobj(&obj->header, &to);
-  *to = '\0';
+siheap_header_t *sistrobj_concat(siheap_header_t *left, siheap_header_t *right) {
+  // if either are empty string, no-op
+  if (!sistrobj_length(right)) {
+    siheap_ref(left);
+    return left;
+  }
+  if (!sistrobj_length(left)) {
+    siheap_ref(right);
+    return right;
+  }
 
-  siheap_deref(obj->left);
-  siheap_deref(obj->right);
+  const unsigned int left_depth = sistrobj_depth(left), right_depth = sistrobj_depth(right);
+
+  // While rebalancing, subtrees are only referenced from C locals, so make sure
+  // no mark-sweep happens by reserving the memory needed up front. Each step
+  // of the spine (at most the difference in depth) and the final join each
+  // create at most 3 pairs.
+  const unsigned int depth_difference = left_depth > right_depth ? left_depth - right_depth : right_depth - left_depth;
+  siheap_reserve(3*(depth_difference + 1), sizeof(siheap_strpair_t));
+
+  siheap_ref(left);
+  siheap_ref(right);
+
+  // the subtrees split off the spine of the deeper side, which are rejoined in reverse
+  siheap_header_t *spine[SISTRPAIR_MAX_DEPTH];
+  unsigned int spine_count = 0;
+
+  if (left_depth > right_depth + 1) {
+    // walk down the right spine of the left tree until we find a subtree that
+    // is shallow enough to be paired with the right tree
+    while (sistrobj_depth(left) > right_depth + 1) {
+      siheap_strpair_t *pair = (siheap_strpair_t *) left;
+      siheap_ref(pair->left);
+      siheap_ref(pair->right);
+      spine[spine_count++] = pair->left;
+      left = pair->right;
+      siheap_deref(pair);
+    }
 
-  obj->left = &string->header;
-  obj->right = NULL;
-  return string;
+    siheap_header_t *result = strpair_join(left, right);
+    while (spine_count) {
+      result = strpair_join(spine[--spine_count], result);
+    }
+    return result;
+  } else if (right_depth > left_depth + 1) {
+    // likewise, down the left spine of the right tree
+    while (sistrobj_depth(right) > left_depth + 1) {
+      siheap_strpair_t *pair = (siheap_strpair_t *) right;
+      siheap_ref(pair->left);
+      siheap_ref(pair->right);
+      spine[spine_count++] = pair->right;
+      right = pair->left;
+      siheap_deref(pair);
+    }
+
+    siheap_header_t *result = strpair_join(left, right);
+    while (spine_count) {
+      result = strpair_join(result, spine[--spine_count]);
+    }
+    return result;
+  }
+
+  return strpair_join(left, right);
+}
+
+/**
+ * Copies the string object obj onto the end of string, which must be large
+ * enough.
+ */
+static void string_append_strobj(siheap_string_t *string, siheap_header_t *obj) {
+  string->size += strobj_copy(string->string + string->size - 1, obj);
+  string->string[string->size - 1] = '\0';
+  string->hash = 0;
+}
+
+siheap_header_t *sistrobj_append(siheap_header_t *left, siheap_header_t *right) {
+  assert(left->refcount == 1);
+
+  const address_t right_length = sistrobj_length(right);
+  if (!right_length) {
+    return left;
+  }
+
+  if (left->type == sitype_string) {
+    siheap_string_t *string = (siheap_string_t *) left;
+    const address_t size = string->size + right_length;
+    if (sizeof(siheap_string_t) + size > left->size) {
+      // grow by half again as much as needed, so appends are amortised O(1)
+      const address_t alloc_size = sizeof(siheap_string_t) + size + size/2;
+      // the stack still refers to the old block, so siheap_mrealloc must not
+      // run a mark-sweep
+      siheap_reserve(1, alloc_size);
+      string = (siheap_string_t *) siheap_mrealloc(left, alloc_size);
+    }
+    string_append_strobj(string, right);
+    return &string->header;
+  }
+
+  const address_t left_length = sistrobj_length(left);
+  if ((left->type != sitype_strpair || left_length <= SISTRING_BUILDER_START_MAX)
+    && right_length <= SISTRING_BUILDER_START_MAX
+    && left_length + right_length > SISTRSHORT_MAX) {
+    const address_t size = left_length + right_length + 1;
+    siheap_string_t *string = sistring_new(size + size/2);
+    string->size = strobj_copy(string->string, left) + 1;
+    string_append_strobj(string, right);
+    siheap_deref(left);
+    return &string->header;
+  }
+
+  siheap_header_t *result = sistrobj_concat(left, right);
+  siheap_deref(left);
+  return result;
 }
 
 siheap_header_t *siheap_mrealloc(siheap_header_t *ent, address_t newsize) {
@@ -286,12 +641,30 @@ siheap_header_t *siheap_mrealloc(siheap_header_t *ent, address_t newsize) {
     return ent;
   }
 
+  // like siheap_malloc, never split off less than a free block header, or the
+  // new free node would overlap the header of the block being split
+  newsize = SIHEAP_ALIGN(newsize);
+  address_t extra_size = newsize - ent->size;
+  if (extra_size < sizeof(siheap_free_t)) {
+    extra_size = SIHEAP_ALIGN(sizeof(siheap_free_t));
+  }
+
   siheap_header_t *next = siheap_next(ent);
-  if (SIHEAP_INRANGE(next) && next->type == sitype_free && ent->size + next->size >= newsize) {
+#ifdef SINTER_ARENA
+  if (next == siarena_rest && next->size >= extra_size + sizeof(siheap_free_t)) {
+    // the block was the last one taken from the arena, so it can grow into the
+    // rest of the arena
+    siarena_malloc(extra_size, ent->type);
+    ent->size += next->size;
+    siheap_fix_next(ent);
+    return ent;
+  }
+#endif
+  if (SIHEAP_INRANGE(next) && next->type == sitype_free && next->size >= extra_size) {
     // the next block is free and large enough
 
     // do the allocation on the block
-    siheap_malloc_split((siheap_free_t *) next, newsize - ent->size, ent->type);
+    siheap_malloc_split((siheap_free_t *) next, extra_size, ent->type);
 
     // now merge our two heap blocks
     ent->size += next->size;
@@ -305,6 +678,7 @@ siheap_header_t *siheap_mrealloc(siheap_header_t *ent, address_t newsize) {
   // store the type, refcount and size of the current block
 #ifdef SINTER_DEBUG_MEMORY_CHECK
   uint16_t orig_internal_refcount = ent->internal_refcount;
+  uint16_t orig_borrow_count = ent->borrow_count;
 #endif
   siheap_type_t orig_type = ent->type;
   uint16_t orig_refcount = ent->refcount;
@@ -314,8 +688,9 @@ siheap_header_t *siheap_mrealloc(siheap_header_t *ent, address_t newsize) {
   // so there is a chance that the new merged free block is large enough
   // we cannot do this all the time as in some cases (if a new free node is
   // constructed in our current memory block) our array data will be overwritten
+  // this also does not apply to blocks in the arena, which are not merged
   const bool free_first = ((unsigned char *) ent->prev_node) >= siheap
-    && ent->prev_node->type == sitype_free;
+    && ent->prev_node->type == sitype_free && !SIHEAP_INARENA(ent);
   ent->refcount = 0;
 
   if (free_first) {
@@ -335,6 +710,7 @@ siheap_header_t *siheap_mrealloc(siheap_header_t *ent, address_t newsize) {
   new_alloc->refcount = orig_refcount;
 #ifdef SINTER_DEBUG_MEMORY_CHECK
   new_alloc->internal_refcount = orig_internal_refcount;
+  new_alloc->borrow_count = orig_borrow_count;
 #endif
 
   return new_alloc;
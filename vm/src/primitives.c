@@ -53,6 +53,17 @@ static void handle_display(unsigned int argc, sinanbox_t *argv, bool is_error) {
   } \
 } while (0)
 
+/**
+ * Dereferences the arguments from the given index on. Used by primitives that
+ * consume their arguments (sivmfn_consumes_args) to drop those they do not
+ * keep.
+ */
+static inline void deref_args_from(uint8_t argc, sinanbox_t *argv, uint8_t from) {
+  for (uint8_t i = from; i < argc; ++i) {
+    siheap_derefbox(argv[i]);
+  }
+}
+
 /******************************************************************************
  * Basic type-checking primitives
  ******************************************************************************/
@@ -107,12 +118,12 @@ static sinanbox_t sivmfn_prim_is_undefined(uint8_t argc, sinanbox_t *argv) {
 
 #define MATH_FN(name) static sinanbox_t sivmfn_prim_math_ ## name(uint8_t argc, sinanbox_t *argv) { \
   CHECK_ARGC(1); \
-  return NANBOX_OFFLOAT(name ## f(NANBOX_TOFLOAT(*argv))); \
+  return NANBOX_OFFLOAT(NANBOX_MATHFN(name)(NANBOX_TOFLOAT(*argv))); \
 }
 
 #define MATH_FN_2(name) static sinanbox_t sivmfn_prim_math_ ## name(uint8_t argc, sinanbox_t *argv) { \
   CHECK_ARGC(2); \
-  return NANBOX_OFFLOAT(name ## f(NANBOX_TOFLOAT(argv[0]), NANBOX_TOFLOAT(argv[1]))); \
+  return NANBOX_OFFLOAT(NANBOX_MATHFN(name)(NANBOX_TOFLOAT(argv[0]), NANBOX_TOFLOAT(argv[1]))); \
 }
 
 MATH_FN(acos)
@@ -132,24 +143,58 @@ MATH_FN(log2)
 MATH_FN(log10)
 MATH_FN(sin)
 MATH_FN(sinh)
+#ifndef SINTER_FIXED_POINT
 MATH_FN(sqrt)
+#endif
 MATH_FN(tan)
 MATH_FN(tanh)
 MATH_FN_2(atan2)
 MATH_FN_2(pow)
 
+#ifdef SINTER_FIXED_POINT
+static sinanbox_t sivmfn_prim_math_sqrt(uint8_t argc, sinanbox_t *argv) {
+  CHECK_ARGC(1);
+  sinanbox_t v = *argv;
+  if (!NANBOX_ISFIXEDNUM(v)) {
+    return NANBOX_OFFLOAT(sqrtf(NANBOX_TOFLOAT(v)));
+  }
+  const int32_t q = NANBOX_TOFIXED(v);
+  if (q < 0) {
+    return NANBOX_CANONICAL_NAN;
+  }
+
+  // sqrt(q / 2^16) * 2^16 = sqrt(q * 2^16); bit-by-bit integer square root
+  uint64_t x = ((uint64_t) q) << NANBOX_FIXED_SHIFT;
+  uint64_t root = 0;
+  uint64_t bit = ((uint64_t) 1) << 46;
+  while (bit > x) {
+    bit >>= 2;
+  }
+  while (bit) {
+    if (x >= root + bit) {
+      x -= root + bit;
+      root = (root >> 1) + bit;
+    } else {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return NANBOX_OFFIXED(root);
+}
+#endif
+
 static sinanbox_t sivmfn_prim_math_hypot(uint8_t argc, sinanbox_t *argv) {
   // Adapted from https://github.com/v8/v8/blob/master/src/builtins/math.tq#L405
   if (argc == 0) {
     return NANBOX_OFINT(0);
   }
 
-  float max = 0;
+  sinanbox_float_t max = 0;
   for (unsigned int i = 0; i < argc; ++i) {
     if (NANBOX_IDENTICAL(argv[i], NANBOX_CANONICAL_NAN)) {
       return NANBOX_CANONICAL_NAN;
     }
-    float v = NANBOX_TOFLOAT(argv[i]);
+    sinanbox_float_t v = NANBOX_TOFLOAT(argv[i]);
     if (v > max) {
       max = v;
     }
@@ -159,17 +204,17 @@ static sinanbox_t sivmfn_prim_math_hypot(uint8_t argc, sinanbox_t *argv) {
     return NANBOX_OFINT(0);
   }
 
-  float sum = 0;
-  float compensation = 0;
+  sinanbox_float_t sum = 0;
+  sinanbox_float_t compensation = 0;
   for (unsigned int i = 0; i < argc; ++i) {
-    float n = NANBOX_TOFLOAT(argv[i]) / max;
-    float summand = n * n - compensation;
-    float preliminary = sum + summand;
+    sinanbox_float_t n = NANBOX_TOFLOAT(argv[i]) / max;
+    sinanbox_float_t summand = n * n - compensation;
+    sinanbox_float_t preliminary = sum + summand;
     compensation = (preliminary - sum) - summand;
     sum = preliminary;
   }
 
-  return NANBOX_OFFLOAT(sqrtf(sum) * max);
+  return NANBOX_OFFLOAT(NANBOX_MATHFN(sqrt)(sum) * max);
 }
 
 static sinanbox_t sivmfn_prim_math_abs(uint8_t argc, sinanbox_t *argv) {
@@ -177,9 +222,13 @@ static sinanbox_t sivmfn_prim_math_abs(uint8_t argc, sinanbox_t *argv) {
   sinanbox_t v = *argv;
 
   if (NANBOX_ISINT(v)) {
-    return NANBOX_WRAP_INT(abs(NANBOX_INT(v)));
+    return NANBOX_WRAP_INT(llabs(NANBOX_INT(v)));
+#ifdef SINTER_FIXED_POINT
+  } else if (NANBOX_ISFIXED(v)) {
+    return nanbox_wrap_fixed(llabs(NANBOX_FIXED(v)));
+#endif
   } else if (NANBOX_ISFLOAT(v)) {
-    return NANBOX_OFFLOAT(fabsf(NANBOX_FLOAT(v)));
+    return NANBOX_OFFLOAT(NANBOX_MATHFN(fabs)(NANBOX_FLOAT(v)));
   }
 
   sifault(sinter_fault_type);
@@ -207,8 +256,13 @@ static sinanbox_t sivmfn_prim_math_clz32(uint8_t argc, sinanbox_t *argv) {
 
 static sinanbox_t sivmfn_prim_math_fround(uint8_t argc, sinanbox_t *argv) {
   CHECK_ARGC(1);
+#ifdef SINTER_NANBOX64
+  sinanbox_float_t f = (float) NANBOX_TOFLOAT(*argv);
+  return NANBOX_ISINT(*argv) && f == NANBOX_INT(*argv) ? *argv : NANBOX_OFFLOAT(f);
+#else
   // no-op: sinter uses floats not doubles
   return *argv;
+#endif
 }
 
 static sinanbox_t sivmfn_prim_math_imul(uint8_t argc, sinanbox_t *argv) {
@@ -244,9 +298,15 @@ static sinanbox_t sivmfn_prim_math_max(uint8_t argc, sinanbox_t *argv) {
       if (contenderi > maxi) {
         max = contender;
       }
+#ifdef SINTER_FIXED_POINT
+    } else if (NANBOX_ISFIXEDNUM(max) && NANBOX_ISFIXEDNUM(contender)) {
+      if (NANBOX_TOFIXED(contender) > NANBOX_TOFIXED(max)) {
+        max = contender;
+      }
+#endif
     } else if (NANBOX_ISFLOAT(contender) || NANBOX_ISINT(contender)) {
-      float maxf = NANBOX_TOFLOAT(max);
-      float contenderf = NANBOX_TOFLOAT(contender);
+      sinanbox_float_t maxf = NANBOX_TOFLOAT(max);
+      sinanbox_float_t contenderf = NANBOX_TOFLOAT(contender);
       if (contenderf > maxf) {
         max = contender;
       }
@@ -282,9 +342,15 @@ static sinanbox_t sivmfn_prim_math_min(uint8_t argc, sinanbox_t *argv) {
       if (contenderi < mini) {
         min = contender;
       }
+#ifdef SINTER_FIXED_POINT
+    } else if (NANBOX_ISFIXEDNUM(min) && NANBOX_ISFIXEDNUM(contender)) {
+      if (NANBOX_TOFIXED(contender) < NANBOX_TOFIXED(min)) {
+        min = contender;
+      }
+#endif
     } else if (NANBOX_ISFLOAT(contender) || NANBOX_ISINT(contender)) {
-      float minf = NANBOX_TOFLOAT(min);
-      float contenderf = NANBOX_TOFLOAT(contender);
+      sinanbox_float_t minf = NANBOX_TOFLOAT(min);
+      sinanbox_float_t contenderf = NANBOX_TOFLOAT(contender);
       if (contenderf < minf) {
         min = contender;
       }
@@ -297,7 +363,11 @@ static sinanbox_t sivmfn_prim_math_min(uint8_t argc, sinanbox_t *argv) {
 }
 static sinanbox_t sivmfn_prim_math_random(uint8_t argc, sinanbox_t *argv) {
   (void) argc; (void) argv;
-  return NANBOX_OFFLOAT((float) rand() / (((float) RAND_MAX) + 1.0f));
+#ifdef SINTER_FIXED_POINT
+  return NANBOX_OFFIXED(((uint64_t) rand() << NANBOX_FIXED_SHIFT) / ((uint64_t) RAND_MAX + 1));
+#else
+  return NANBOX_OFFLOAT((sinanbox_float_t) rand() / (((sinanbox_float_t) RAND_MAX) + 1));
+#endif
 }
 
 static sinanbox_t sivmfn_prim_math_sign(uint8_t argc, sinanbox_t *argv) {
@@ -306,8 +376,13 @@ static sinanbox_t sivmfn_prim_math_sign(uint8_t argc, sinanbox_t *argv) {
   if (NANBOX_ISINT(v)) {
     int32_t intv = NANBOX_INT(v);
     return NANBOX_OFINT(intv ? (intv > 0 ? 1 : -1) : 0);
+#ifdef SINTER_FIXED_POINT
+  } else if (NANBOX_ISFIXED(v)) {
+    int32_t q = NANBOX_FIXED(v);
+    return NANBOX_OFINT(q ? (q > 0 ? 1 : -1) : 0);
+#endif
   } else if (NANBOX_ISFLOAT(v)) {
-    float fv = NANBOX_FLOAT(v);
+    sinanbox_float_t fv = NANBOX_FLOAT(v);
     return NANBOX_OFINT(fv != 0.0f ? (fv > 0.0f ? 1 : -1) : 0);
   } else {
     sifault(sinter_fault_type);
@@ -315,13 +390,24 @@ static sinanbox_t sivmfn_prim_math_sign(uint8_t argc, sinanbox_t *argv) {
   return NANBOX_OFEMPTY();
 }
 
-#define FLOAT_ROUND_FN(name) static sinanbox_t sivmfn_prim_math_## name(uint8_t argc, sinanbox_t *argv) { \
+#ifdef SINTER_FIXED_POINT
+#define FIXED_ROUND(round_q) \
+  if (NANBOX_ISFIXED(v)) { \
+    const int32_t q = NANBOX_FIXED(v); \
+    return NANBOX_OFINT(round_q); \
+  }
+#else
+#define FIXED_ROUND(round_q)
+#endif
+
+#define FLOAT_ROUND_FN(name, round_q) static sinanbox_t sivmfn_prim_math_## name(uint8_t argc, sinanbox_t *argv) { \
   CHECK_ARGC(1); \
   sinanbox_t v = *argv; \
+  FIXED_ROUND(round_q) \
   if (NANBOX_ISINT(v)) { \
     return v; \
   } else if (NANBOX_ISFLOAT(v)) { \
-    float retv = name ## f(NANBOX_FLOAT(v)); \
+    sinanbox_float_t retv = NANBOX_MATHFN(name)(NANBOX_FLOAT(v)); \
     if (retv >= NANBOX_INTMIN && retv <= NANBOX_INTMAX) { \
       return NANBOX_OFINT((int32_t) retv); \
     } \
@@ -332,10 +418,11 @@ static sinanbox_t sivmfn_prim_math_sign(uint8_t argc, sinanbox_t *argv) {
   return NANBOX_OFEMPTY(); \
 }
 
-FLOAT_ROUND_FN(floor)
-FLOAT_ROUND_FN(ceil)
-FLOAT_ROUND_FN(round)
-FLOAT_ROUND_FN(trunc)
+// round_q is the fixed-point value q rounded to an integer
+FLOAT_ROUND_FN(floor, q >> NANBOX_FIXED_SHIFT)
+FLOAT_ROUND_FN(ceil, -(-q >> NANBOX_FIXED_SHIFT))
+FLOAT_ROUND_FN(round, (q + NANBOX_FIXED_ONE/2) >> NANBOX_FIXED_SHIFT)
+FLOAT_ROUND_FN(trunc, q / NANBOX_FIXED_ONE)
 
 /******************************************************************************
  * Pair primitives
@@ -374,8 +461,7 @@ static inline sinanbox_t source_tail(sinanbox_t p) {
 
 static sinanbox_t sivmfn_prim_pair(uint8_t argc, sinanbox_t *argv) {
   CHECK_ARGC(2);
-  siheap_refbox(argv[0]);
-  siheap_refbox(argv[1]);
+  deref_args_from(argc, argv, 2);
   return source_pair(argv[0], argv[1]);
 }
 
@@ -396,16 +482,18 @@ static sinanbox_t sivmfn_prim_tail(uint8_t argc, sinanbox_t *argv) {
 static sinanbox_t sivmfn_prim_set_head(uint8_t argc, sinanbox_t *argv) {
   CHECK_ARGC(2);
   siheap_array_t *a = nanbox_toarray(argv[0]);
-  siheap_refbox(argv[1]);
   siarray_put(a, 0, argv[1]);
+  siheap_deref(a);
+  deref_args_from(argc, argv, 2);
   return NANBOX_OFUNDEF();
 }
 
 static sinanbox_t sivmfn_prim_set_tail(uint8_t argc, sinanbox_t *argv) {
   CHECK_ARGC(2);
   siheap_array_t *a = nanbox_toarray(argv[0]);
-  siheap_refbox(argv[1]);
   siarray_put(a, 1, argv[1]);
+  siheap_deref(a);
+  deref_args_from(argc, argv, 2);
   return NANBOX_OFUNDEF();
 }
 
@@ -445,23 +533,75 @@ static inline size_t source_list_length(sinanbox_t l) {
   return length;
 }
 
-static sinanbox_t sivmfn_prim_accumulate(uint8_t argc, sinanbox_t *argv) {
-  CHECK_ARGC(3);
-
-  // this function is particularly horrible for us
-  // we don't want to have a naive recursive implementation (in case we blow the C stack
-  // the Sinter stack isn't particularly large either
-  // so.. here's a compromise: we allocate an array and flatten the list into it
-  // then we accumulate using the array
-
-  sinanbox_t f = argv[0], acc = argv[1];
-  const size_t list_length = source_list_length(argv[2]);
-  siheap_array_t *flat_list = siarray_new(list_length);
-  siheap_intref(flat_list);
-  // flatten the list into the array
-  {
+/******************************************************************************
+ * Driven primitives (see sivmfn_drive_t), which call functions
+ ******************************************************************************/
+
+// indices into sivmfn_drives
+enum {
+  drive_accumulate,
+  drive_build_list,
+  drive_filter,
+  drive_for_each,
+  drive_map,
+  drive_eval_stream,
+  drive_stream_for_each,
+  drive_stream_length,
+  drive_stream_member,
+  drive_stream_ref,
+  drive_stream_reverse,
+  drive_stream_to_list,
+  drive_is_stream
+};
+
+/**
+ * Appends the value, whose reference it takes, to a list being built on a
+ * driven primitive's frame: builder[0] is the list (null while empty), and
+ * builder[1] holds a reference to its last pair.
+ */
+static void list_builder_append(sinanbox_t *builder, sinanbox_t value) {
+  const sinanbox_t pair = SIHEAP_PTRTONANBOX(source_pair_ptr(value, NANBOX_OFNULL()));
+  siheap_refbox(pair);
+  if (NANBOX_ISNULL(builder[1])) {
+    builder[0] = pair;
+  } else {
+    siarray_put(nanbox_toarray(builder[1]), 1, pair);
+    siheap_derefbox(builder[1]);
+  }
+  builder[1] = pair;
+}
+
+/**
+ * Moves list[0], the rest of a list on a driven primitive's frame, to its tail,
+ * and returns a reference to its head.
+ */
+static sinanbox_t list_advance(sinanbox_t *list) {
+  siheap_array_t *pair = nanbox_toarray(*list);
+  const sinanbox_t head = siarray_get(pair, 0);
+  const sinanbox_t tail = siarray_get(pair, 1);
+  siheap_refbox(head);
+  siheap_refbox(tail);
+  siheap_derefbox(*list);
+  *list = tail;
+  return head;
+}
+
+/**
+ * Steps of accumulate. The state is the function, the accumulated value, the
+ * list, the list flattened into an array, and the number of elements of the
+ * array still to accumulate.
+ *
+ * We don't want a naive recursive implementation, which would need a frame for
+ * each element of the list, so we flatten the list into an array first, then
+ * accumulate from the end of the array.
+ */
+static int step_accumulate(sinanbox_t *state, sinanbox_t result, sinanbox_t *retv) {
+  if (NANBOX_ISEMPTY(result)) {
+    const size_t list_length = source_list_length(state[2]);
+    siheap_array_t *flat_list = siarray_new(list_length);
+    state[3] = SIHEAP_PTRTONANBOX(flat_list);
     size_t idx = 0;
-    sinanbox_t l = argv[2];
+    sinanbox_t l = state[2];
     while (!NANBOX_ISNULL(l)) {
       siheap_array_t *pair = nanbox_toarray(l);
       sinanbox_t head = siarray_get(pair, 0);
@@ -471,23 +611,33 @@ static sinanbox_t sivmfn_prim_accumulate(uint8_t argc, sinanbox_t *argv) {
       idx += 1;
     }
     assert(idx == list_length);
+    state[4] = NANBOX_WRAP_INT((int32_t) list_length);
+  } else {
+    siheap_refbox(result);
+    siheap_derefbox(state[1]);
+    state[1] = result;
   }
 
-  // the initial acc has a ref from the caller's stack (it's not removed until
-  // after we return. if we are passing it to a reentrant call, then there will
-  // be a second ref from our callee's env
-  // ref it
-  siheap_refbox(acc);
-  for (size_t idxp1 = list_length; idxp1 > 0; --idxp1) {
-    sinanbox_t f_args[] = {siarray_get(flat_list, idxp1 - 1), acc};
-    siheap_refbox(f_args[0]);
-    acc = siexec_nanbox(f, 2, f_args);
+  const int32_t remaining = NANBOX_INT(state[4]);
+  if (!remaining) {
+    *retv = state[1];
+    state[1] = NANBOX_OFNULL();
+    return -1;
   }
 
-  siheap_intderef(flat_list);
-  siheap_deref(flat_list);
+  state[4] = NANBOX_WRAP_INT(remaining - 1);
+  const sinanbox_t element = siarray_get(nanbox_toarray(state[3]), (address_t) (remaining - 1));
+  siheap_refbox(state[0]);
+  siheap_refbox(element);
+  siheap_refbox(state[1]);
+  sistack_push(state[0]);
+  sistack_push(element);
+  sistack_push(state[1]);
+  return 2;
+}
 
-  return acc;
+static sinanbox_t sivmfn_prim_accumulate(uint8_t argc, sinanbox_t *argv) {
+  return sivm_drive(sivmfn_drives + drive_accumulate, argc, argv);
 }
 
 static sinanbox_t sivmfn_prim_append(uint8_t argc, sinanbox_t *argv) {
@@ -522,34 +672,34 @@ static sinanbox_t sivmfn_prim_append(uint8_t argc, sinanbox_t *argv) {
   return SIHEAP_PTRTONANBOX(new_list);
 }
 
-static sinanbox_t sivmfn_prim_build_list(uint8_t argc, sinanbox_t *argv) {
-  CHECK_ARGC(2);
-
-  int32_t limit = NANBOX_TOI32(argv[0]);
-
-  if (limit <= 0) {
-    return NANBOX_OFNULL();
+/**
+ * Steps of build_list. The state is the length, the function, the index of the
+ * element the function was called for, and the new list and its last pair (see
+ * list_builder_append).
+ */
+static int step_build_list(sinanbox_t *state, sinanbox_t result, sinanbox_t *retv) {
+  int32_t i = 0;
+  if (!NANBOX_ISEMPTY(result)) {
+    siheap_refbox(result);
+    list_builder_append(state + 3, result);
+    i = NANBOX_INT(state[2]) + 1;
   }
 
-  siheap_array_t *new_list = NULL;
-  siheap_array_t *prev_pair = NULL;
-
-  for (int32_t i = 0; i < limit; ++i) {
-    sinanbox_t arg = NANBOX_WRAP_INT(i);
-    sinanbox_t new_val = siexec_nanbox(argv[1], 1, &arg);
-    siheap_array_t *new_pair = source_pair_ptr(new_val, NANBOX_OFNULL());
-    if (prev_pair) {
-      siarray_put(prev_pair, 1, SIHEAP_PTRTONANBOX(new_pair));
-    }
-    if (!new_list) {
-      new_list = new_pair;
-      siheap_intref(new_list);
-    }
-    prev_pair = new_pair;
+  if (i >= NANBOX_TOI32(state[0])) {
+    *retv = state[3];
+    state[3] = NANBOX_OFNULL();
+    return -1;
   }
 
-  siheap_intderef(new_list);
-  return SIHEAP_PTRTONANBOX(new_list);
+  state[2] = NANBOX_WRAP_INT(i);
+  siheap_refbox(state[1]);
+  sistack_push(state[1]);
+  sistack_push(NANBOX_WRAP_INT(i));
+  return 1;
+}
+
+static sinanbox_t sivmfn_prim_build_list(uint8_t argc, sinanbox_t *argv) {
+  return sivm_drive(sivmfn_drives + drive_build_list, argc, argv);
 }
 
 #define PRIM_ENUM_LIST_FN(type, each) static inline sinanbox_t enum_list_##type(type start, type end) { \
@@ -572,7 +722,7 @@ static sinanbox_t sivmfn_prim_build_list(uint8_t argc, sinanbox_t *argv) {
 }
 
 PRIM_ENUM_LIST_FN(int32_t, NANBOX_WRAP_INT(i))
-PRIM_ENUM_LIST_FN(float, NANBOX_OFFLOAT(i))
+PRIM_ENUM_LIST_FN(sinanbox_float_t, NANBOX_OFFLOAT(i))
 
 static sinanbox_t sivmfn_prim_enum_list(uint8_t argc, sinanbox_t *argv) {
   CHECK_ARGC(2);
@@ -581,82 +731,76 @@ static sinanbox_t sivmfn_prim_enum_list(uint8_t argc, sinanbox_t *argv) {
       if (NANBOX_ISINT(argv[1])) {
         return enum_list_int32_t(NANBOX_INT(argv[0]), NANBOX_INT(argv[1]));
       } else if (NANBOX_ISFLOAT(argv[1])) {
-        float end = NANBOX_FLOAT(argv[1]);
-        if (end > INT32_MIN && end < (float) INT32_MAX) {
+        sinanbox_float_t end = NANBOX_FLOAT(argv[1]);
+        if (end > INT32_MIN && end < (sinanbox_float_t) INT32_MAX) {
           return enum_list_int32_t(NANBOX_TOI32(argv[0]), (int32_t) end);
         } else {
-          return enum_list_float(NANBOX_INT(argv[0]), end);
+          return enum_list_sinanbox_float_t(NANBOX_INT(argv[0]), end);
         }
       }
   } else if (NANBOX_ISFLOAT(argv[0])) {
-    return enum_list_float(NANBOX_FLOAT(argv[0]), NANBOX_TOFLOAT(argv[1]));
+    return enum_list_sinanbox_float_t(NANBOX_FLOAT(argv[0]), NANBOX_TOFLOAT(argv[1]));
   }
   sifault(sinter_fault_type);
   return NANBOX_OFEMPTY();
 }
 
-static sinanbox_t sivmfn_prim_filter(uint8_t argc, sinanbox_t *argv) {
-  CHECK_ARGC(2);
-  if (NANBOX_ISNULL(argv[1])) {
-    return NANBOX_OFNULL();
-  }
-
-  const sinanbox_t filter_fn = argv[0];
-
-  sinanbox_t old_list = argv[1];
-  siheap_array_t *new_list = NULL;
-  siheap_array_t *prev_pair = NULL;
-  while (!NANBOX_ISNULL(old_list)) {
-    siheap_array_t *pair = nanbox_toarray(old_list);
-    sinanbox_t cur = siarray_get(pair, 0);
-    old_list = siarray_get(pair, 1);
-    siheap_refbox(cur);
-    sinanbox_t pred_result = siexec_nanbox(filter_fn, 1, &cur);
-    if (NANBOX_ISBOOL(pred_result)) {
-      if (!NANBOX_BOOL(pred_result)) {
-        continue;
-      }
-    } else {
+/**
+ * Steps of filter. The state is the predicate, the rest of the list, the new
+ * list and its last pair (see list_builder_append), and the element the
+ * predicate was called for.
+ */
+static int step_filter(sinanbox_t *state, sinanbox_t result, sinanbox_t *retv) {
+  if (!NANBOX_ISEMPTY(result)) {
+    if (!NANBOX_ISBOOL(result)) {
       sifault(sinter_fault_type);
+      return -1;
     }
-    siheap_refbox(cur);
-    siheap_array_t *new_pair = source_pair_ptr(cur, NANBOX_OFNULL());
-    if (prev_pair) {
-      siarray_put(prev_pair, 1, SIHEAP_PTRTONANBOX(new_pair));
-    }
-    if (!new_list) {
-      new_list = new_pair;
-      siheap_intref(new_list);
+    if (NANBOX_BOOL(result)) {
+      siheap_refbox(state[4]);
+      list_builder_append(state + 2, state[4]);
     }
-    prev_pair = new_pair;
   }
 
-  if (new_list) {
-    siheap_intderef(new_list);
-    return SIHEAP_PTRTONANBOX(new_list);
+  if (NANBOX_ISNULL(state[1])) {
+    *retv = state[2];
+    state[2] = NANBOX_OFNULL();
+    return -1;
   }
 
-  return NANBOX_OFNULL();
+  const sinanbox_t cur = list_advance(state + 1);
+  siheap_derefbox(state[4]);
+  state[4] = cur;
+  siheap_refbox(state[0]);
+  siheap_refbox(cur);
+  sistack_push(state[0]);
+  sistack_push(cur);
+  return 1;
 }
 
-static sinanbox_t sivmfn_prim_for_each(uint8_t argc, sinanbox_t *argv) {
-  CHECK_ARGC(2);
-  if (NANBOX_ISNULL(argv[1])) {
-    return NANBOX_OFNULL();
-  }
-
-  const sinanbox_t for_each_fn = argv[0];
+static sinanbox_t sivmfn_prim_filter(uint8_t argc, sinanbox_t *argv) {
+  return sivm_drive(sivmfn_drives + drive_filter, argc, argv);
+}
 
-  sinanbox_t list = argv[1];
-  while (!NANBOX_ISNULL(list)) {
-    siheap_array_t *pair = nanbox_toarray(list);
-    sinanbox_t cur = siarray_get(pair, 0);
-    list = siarray_get(pair, 1);
-    siheap_refbox(cur);
-    siheap_derefbox(siexec_nanbox(for_each_fn, 1, &cur));
+/**
+ * Steps of for_each. The state is the function, and the rest of the list.
+ */
+static int step_for_each(sinanbox_t *state, sinanbox_t result, sinanbox_t *retv) {
+  if (NANBOX_ISNULL(state[1])) {
+    // null for an empty list, as nothing was called
+    *retv = NANBOX_ISEMPTY(result) ? NANBOX_OFNULL() : NANBOX_OFUNDEF();
+    return -1;
   }
 
-  return NANBOX_OFUNDEF();
+  const sinanbox_t cur = list_advance(state + 1);
+  siheap_refbox(state[0]);
+  sistack_push(state[0]);
+  sistack_push(cur);
+  return 1;
+}
+
+static sinanbox_t sivmfn_prim_for_each(uint8_t argc, sinanbox_t *argv) {
+  return sivm_drive(sivmfn_drives + drive_for_each, argc, argv);
 }
 
 static sinanbox_t sivmfn_prim_length(uint8_t argc, sinanbox_t *argv) {
@@ -673,7 +817,6 @@ static sinanbox_t sivmfn_prim_list(uint8_t argc, sinanbox_t *argv) {
   siheap_array_t *prev_pair = NULL;
 
   for (size_t i = 0; i < argc; ++i) {
-    siheap_refbox(argv[i]);
     siheap_array_t *new_pair = source_pair_ptr(argv[i], NANBOX_OFNULL());
     if (prev_pair) {
       siarray_put(prev_pair, 1, SIHEAP_PTRTONANBOX(new_pair));
@@ -701,36 +844,31 @@ static sinanbox_t sivmfn_prim_list_ref(uint8_t argc, sinanbox_t *argv) {
   return retv;
 }
 
-static sinanbox_t sivmfn_prim_map(uint8_t argc, sinanbox_t *argv) {
-  CHECK_ARGC(2);
-  if (NANBOX_ISNULL(argv[1])) {
-    return NANBOX_OFNULL();
+/**
+ * Steps of map. The state is the function, the rest of the list, and the new
+ * list and its last pair (see list_builder_append).
+ */
+static int step_map(sinanbox_t *state, sinanbox_t result, sinanbox_t *retv) {
+  if (!NANBOX_ISEMPTY(result)) {
+    siheap_refbox(result);
+    list_builder_append(state + 2, result);
   }
 
-  const sinanbox_t map_fn = argv[0];
-
-  sinanbox_t old_list = argv[1];
-  siheap_array_t *new_list = NULL;
-  siheap_array_t *prev_pair = NULL;
-  while (!NANBOX_ISNULL(old_list)) {
-    siheap_array_t *pair = nanbox_toarray(old_list);
-    sinanbox_t cur = siarray_get(pair, 0);
-    old_list = siarray_get(pair, 1);
-    siheap_refbox(cur);
-    sinanbox_t newval = siexec_nanbox(map_fn, 1, &cur);
-    siheap_array_t *new_pair = source_pair_ptr(newval, NANBOX_OFNULL());
-    if (prev_pair) {
-      siarray_put(prev_pair, 1, SIHEAP_PTRTONANBOX(new_pair));
-    }
-    if (!new_list) {
-      new_list = new_pair;
-      siheap_intref(new_list);
-    }
-    prev_pair = new_pair;
+  if (NANBOX_ISNULL(state[1])) {
+    *retv = state[2];
+    state[2] = NANBOX_OFNULL();
+    return -1;
   }
 
-  siheap_intderef(new_list);
-  return SIHEAP_PTRTONANBOX(new_list);
+  const sinanbox_t cur = list_advance(state + 1);
+  siheap_refbox(state[0]);
+  sistack_push(state[0]);
+  sistack_push(cur);
+  return 1;
+}
+
+static sinanbox_t sivmfn_prim_map(uint8_t argc, sinanbox_t *argv) {
+  return sivm_drive(sivmfn_drives + drive_map, argc, argv);
 }
 
 static sinanbox_t sivmfn_prim_member(uint8_t argc, sinanbox_t *argv) {
@@ -887,6 +1025,28 @@ static inline sinanbox_t source_stream_tail(sinanbox_t stream) {
   return siexec_nanbox(tail, 0, NULL);
 }
 
+/**
+ * Calls the tail of *stream, a stream on a driven primitive's frame, which
+ * stays there until stream_advance replaces it with the result. Returns the
+ * number of arguments, for the step to return.
+ */
+static int stream_call_tail(const sinanbox_t *stream) {
+  const sinanbox_t tail = source_tail(*stream);
+  siheap_refbox(tail);
+  sistack_push(tail);
+  return 0;
+}
+
+/**
+ * Replaces *stream, a stream on a driven primitive's frame, with the result of
+ * calling its tail (see stream_call_tail).
+ */
+static void stream_advance(sinanbox_t *stream, sinanbox_t rest) {
+  siheap_refbox(rest);
+  siheap_derefbox(*stream);
+  *stream = rest;
+}
+
 static sinanbox_t sivmfn_prim_list_to_stream(uint8_t argc, sinanbox_t *argv) {
   CHECK_ARGC(1);
 
@@ -959,45 +1119,35 @@ static sinanbox_t sivmfn_prim_enum_stream(uint8_t argc, sinanbox_t *argv) {
   return source_pair(start, SIHEAP_PTRTONANBOX(ic));
 }
 
-static sinanbox_t sivmfn_prim_eval_stream(uint8_t argc, sinanbox_t *argv) {
-  CHECK_ARGC(2);
-
-  int32_t limit = NANBOX_TOI32(argv[1]);
-
-  if (limit <= 0) {
-    return NANBOX_OFNULL();
+/**
+ * Steps of eval_stream. The state is the rest of the stream, the number of
+ * elements, the number still to evaluate, and the new list and its last pair
+ * (see list_builder_append).
+ */
+static int step_eval_stream(sinanbox_t *state, sinanbox_t result, sinanbox_t *retv) {
+  if (NANBOX_ISEMPTY(result)) {
+    state[2] = NANBOX_WRAP_INT(NANBOX_TOI32(state[1]));
+  } else {
+    stream_advance(state, result);
   }
 
-  siheap_array_t *new_list = NULL;
-  siheap_array_t *prev_pair = NULL;
-  sinanbox_t stream = argv[0];
-  siheap_refbox(stream);
-
-  for (int32_t i = 0; i < limit; ++i) {
-    siheap_array_t *stream_pair = nanbox_toarray(stream);
-    sinanbox_t new_val = siarray_get(stream_pair, 0);
-    sinanbox_t stream_tail = siarray_get(stream_pair, 1);
-    siheap_intref(stream_pair);
-    stream = siexec_nanbox(stream_tail, 0, NULL);
-    siheap_intderef(stream_pair);
-
-    siheap_refbox(new_val);
-    siheap_deref(stream_pair);
-
-    siheap_array_t *new_pair = source_pair_ptr(new_val, NANBOX_OFNULL());
-    if (prev_pair) {
-      siarray_put(prev_pair, 1, SIHEAP_PTRTONANBOX(new_pair));
-    }
-    if (!new_list) {
-      new_list = new_pair;
-      siheap_intref(new_list);
-    }
-    prev_pair = new_pair;
+  const int32_t remaining = NANBOX_TOI32(state[2]);
+  if (remaining <= 0) {
+    *retv = state[3];
+    state[3] = NANBOX_OFNULL();
+    return -1;
   }
 
-  siheap_derefbox(stream);
-  siheap_intderef(new_list);
-  return SIHEAP_PTRTONANBOX(new_list);
+  // like Source's eval_stream, this evaluates the tail after the last element
+  state[2] = NANBOX_WRAP_INT(remaining - 1);
+  const sinanbox_t head = source_head(state[0]);
+  siheap_refbox(head);
+  list_builder_append(state + 3, head);
+  return stream_call_tail(state);
+}
+
+static sinanbox_t sivmfn_prim_eval_stream(uint8_t argc, sinanbox_t *argv) {
+  return sivm_drive(sivmfn_drives + drive_eval_stream, argc, argv);
 }
 
 static sinanbox_t sivmfn_prim_integers_from(uint8_t argc, sinanbox_t *argv) {
@@ -1054,14 +1204,9 @@ static sinanbox_t sivmfn_prim_stream(uint8_t argc, sinanbox_t *argv) {
   } else if (argc == 1) {
     siheap_intcont_t *ic = siintcont_new(prim_stream_cont, 1);
     ic->argv[0] = NANBOX_OFNULL();
-    siheap_refbox(argv[0]);
     return source_pair(argv[0], SIHEAP_PTRTONANBOX(ic));
   }
 
-  for (size_t i = 0; i < argc; ++i) {
-    siheap_refbox(argv[i]);
-  }
-
   siheap_array_t *arr = siarray_new(argc - 1);
   memcpy(arr->data->data, argv + 1, (argc - 1)*sizeof(sinanbox_t));
   arr->count = argc - 1;
@@ -1163,54 +1308,60 @@ static sinanbox_t sivmfn_prim_stream_filter(uint8_t argc, sinanbox_t *argv) {
   return NANBOX_OFNULL();
 }
 
-static sinanbox_t sivmfn_prim_stream_for_each(uint8_t argc, sinanbox_t *argv) {
-  CHECK_ARGC(2);
-
-  sinanbox_t stream = argv[1];
-  if (NANBOX_ISNULL(stream)) {
-    return NANBOX_OFUNDEF();
+/**
+ * Steps of stream_for_each. The state is the function, the rest of the stream,
+ * and whether the function (true) or the tail (false) was called last.
+ */
+static int step_stream_for_each(sinanbox_t *state, sinanbox_t result, sinanbox_t *retv) {
+  const bool called_fn = NANBOX_ISBOOL(state[2]) && NANBOX_BOOL(state[2]);
+  if (NANBOX_ISBOOL(state[2]) && !called_fn) {
+    stream_advance(state + 1, result);
   }
 
-  sinanbox_t fn = argv[0];
+  if (NANBOX_ISNULL(state[1])) {
+    *retv = NANBOX_OFUNDEF();
+    return -1;
+  }
 
-  siheap_refbox(stream);
-  while (!NANBOX_ISNULL(stream)) {
-    siheap_array_t *stream_pair = nanbox_toarray(stream);
-    sinanbox_t head = siarray_get(stream_pair, 0);
-    sinanbox_t stream_tail = siarray_get(stream_pair, 1);
-    siheap_intref(stream_pair);
-    siheap_refbox(head);
-    siheap_derefbox(siexec_nanbox(fn, 1, &head));
-    stream = siexec_nanbox(stream_tail, 0, NULL);
-    siheap_intderef(stream_pair);
-    siheap_deref(stream_pair);
+  state[2] = NANBOX_OFBOOL(!called_fn);
+  if (called_fn) {
+    return stream_call_tail(state + 1);
   }
-  siheap_derefbox(stream);
 
-  return NANBOX_OFUNDEF();
+  const sinanbox_t head = source_head(state[1]);
+  siheap_refbox(state[0]);
+  siheap_refbox(head);
+  sistack_push(state[0]);
+  sistack_push(head);
+  return 1;
 }
 
-static sinanbox_t sivmfn_prim_stream_length(uint8_t argc, sinanbox_t *argv) {
-  CHECK_ARGC(1);
+static sinanbox_t sivmfn_prim_stream_for_each(uint8_t argc, sinanbox_t *argv) {
+  return sivm_drive(sivmfn_drives + drive_stream_for_each, argc, argv);
+}
 
-  sinanbox_t stream = argv[0];
-  if (NANBOX_ISNULL(stream)) {
-    return NANBOX_OFINT(0);
+/**
+ * Steps of stream_length. The state is the rest of the stream, and the number
+ * of elements before it.
+ */
+static int step_stream_length(sinanbox_t *state, sinanbox_t result, sinanbox_t *retv) {
+  if (NANBOX_ISEMPTY(result)) {
+    state[1] = NANBOX_OFINT(0);
+  } else {
+    stream_advance(state, result);
   }
 
-  size_t length = 0;
-  siheap_refbox(stream);
-  while (!NANBOX_ISNULL(stream)) {
-    ++length;
-    sinanbox_t last_stream = stream;
-    siheap_intrefbox(last_stream);
-    stream = source_stream_tail(last_stream);
-    siheap_intderefbox(last_stream);
-    siheap_derefbox(last_stream);
+  if (NANBOX_ISNULL(state[0])) {
+    *retv = state[1];
+    return -1;
   }
-  siheap_derefbox(stream);
 
-  return NANBOX_WRAP_UINT(length);
+  state[1] = NANBOX_WRAP_UINT(NANBOX_TOU32(state[1]) + 1);
+  return stream_call_tail(state);
+}
+
+static sinanbox_t sivmfn_prim_stream_length(uint8_t argc, sinanbox_t *argv) {
+  return sivm_drive(sivmfn_drives + drive_stream_length, argc, argv);
 }
 
 static sinanbox_t sivmfn_prim_stream_map(uint8_t argc, sinanbox_t *argv);
@@ -1249,52 +1400,52 @@ static sinanbox_t sivmfn_prim_stream_map(uint8_t argc, sinanbox_t *argv) {
   return source_pair(fn_res, SIHEAP_PTRTONANBOX(ic));
 }
 
-static sinanbox_t sivmfn_prim_stream_member(uint8_t argc, sinanbox_t *argv) {
-  CHECK_ARGC(2);
-  sinanbox_t needle = argv[0], xs = argv[1];
+/**
+ * Steps of stream_member. The state is the value to find, and the rest of the
+ * stream.
+ */
+static int step_stream_member(sinanbox_t *state, sinanbox_t result, sinanbox_t *retv) {
+  if (!NANBOX_ISEMPTY(result)) {
+    stream_advance(state + 1, result);
+  }
 
-  if (NANBOX_ISNULL(xs)) {
-    return NANBOX_OFNULL();
+  if (NANBOX_ISNULL(state[1]) || sivm_equal(source_head(state[1]), state[0])) {
+    *retv = state[1];
+    state[1] = NANBOX_OFNULL();
+    return -1;
   }
 
-  siheap_refbox(xs);
-  while (!NANBOX_ISNULL(xs)) {
-    siheap_array_t *stream_pair = nanbox_toarray(xs);
-    sinanbox_t head = siarray_get(stream_pair, 0);
-    sinanbox_t tail = siarray_get(stream_pair, 1);
+  return stream_call_tail(state + 1);
+}
 
-    if (sivm_equal(head, needle)) {
-      return xs;
-    }
+static sinanbox_t sivmfn_prim_stream_member(uint8_t argc, sinanbox_t *argv) {
+  return sivm_drive(sivmfn_drives + drive_stream_member, argc, argv);
+}
 
-    siheap_intref(stream_pair);
-    xs = siexec_nanbox(tail, 0, NULL);
-    siheap_intderef(stream_pair);
-    siheap_deref(stream_pair);
+/**
+ * Steps of stream_ref. The state is the rest of the stream, the index, and the
+ * number of elements still to skip.
+ */
+static int step_stream_ref(sinanbox_t *state, sinanbox_t result, sinanbox_t *retv) {
+  if (NANBOX_ISEMPTY(result)) {
+    state[2] = NANBOX_WRAP_INT(NANBOX_TOI32(state[1]));
+  } else {
+    stream_advance(state, result);
   }
 
-  siheap_derefbox(xs);
-  return NANBOX_OFNULL();
+  const int32_t remaining = NANBOX_TOI32(state[2]);
+  if (remaining <= 0) {
+    *retv = source_head(state[0]);
+    siheap_refbox(*retv);
+    return -1;
+  }
+
+  state[2] = NANBOX_WRAP_INT(remaining - 1);
+  return stream_call_tail(state);
 }
 
 static sinanbox_t sivmfn_prim_stream_ref(uint8_t argc, sinanbox_t *argv) {
-  CHECK_ARGC(2);
-  sinanbox_t xs = argv[0];
-  int32_t count = NANBOX_TOI32(argv[1]);
-
-  siheap_refbox(xs);
-  for (int32_t i = 0; i < count; ++i) {
-    sinanbox_t old_xs = xs;
-    siheap_intrefbox(old_xs);
-    xs = source_stream_tail(old_xs);
-    siheap_intderefbox(old_xs);
-    siheap_derefbox(old_xs);
-  }
-
-  sinanbox_t head = source_head(xs);
-  siheap_refbox(head);
-  siheap_derefbox(xs);
-  return head;
+  return sivm_drive(sivmfn_drives + drive_stream_ref, argc, argv);
 }
 
 static sinanbox_t sivmfn_prim_stream_remove(uint8_t argc, sinanbox_t *argv);
@@ -1413,47 +1564,51 @@ static sinanbox_t prim_stream_reverse_cont(uint8_t argc, sinanbox_t *argv) {
   return source_pair(arr->data->data[idx - 1], SIHEAP_PTRTONANBOX(ic));
 }
 
-static sinanbox_t sivmfn_prim_stream_reverse(uint8_t argc, sinanbox_t *argv) {
-  CHECK_ARGC(1);
-
-  sinanbox_t xs = argv[0];
-  if (NANBOX_ISNULL(xs)) {
-    return NANBOX_OFNULL();
+/**
+ * Steps of stream_reverse. The state is the rest of the stream, an array of the
+ * elements before it, and their number.
+ */
+static int step_stream_reverse(sinanbox_t *state, sinanbox_t result, sinanbox_t *retv) {
+  if (NANBOX_ISEMPTY(result)) {
+    if (NANBOX_ISNULL(state[0])) {
+      *retv = NANBOX_OFNULL();
+      return -1;
+    }
+    state[1] = SIHEAP_PTRTONANBOX(siarray_new(4));
+    state[2] = NANBOX_OFINT(0);
+  } else {
+    stream_advance(state, result);
   }
 
-  siheap_array_t *stream_array = siarray_new(4);
-  siheap_intref(stream_array);
-
-  address_t index = 0;
-  siheap_refbox(xs);
-  while (!NANBOX_ISNULL(xs)) {
-    siheap_array_t *stream_pair = nanbox_toarray(xs);
-    sinanbox_t head = siarray_get(stream_pair, 0);
-    sinanbox_t tail = siarray_get(stream_pair, 1);
-
+  const uint32_t count = NANBOX_TOU32(state[2]);
+  siheap_array_t *stream_array = nanbox_toarray(state[1]);
+  if (!NANBOX_ISNULL(state[0])) {
+    const sinanbox_t head = source_head(state[0]);
     siheap_refbox(head);
-    siarray_put(stream_array, index++, head);
-
-    siheap_intref(stream_pair);
-    xs = siexec_nanbox(tail, 0, NULL);
-    siheap_intderef(stream_pair);
-    siheap_deref(stream_pair);
+    siarray_put(stream_array, count, head);
+    state[2] = NANBOX_WRAP_UINT(count + 1);
+    return stream_call_tail(state);
   }
-  siheap_derefbox(xs);
 
-  if (index - 1 > NANBOX_INTMAX) {
+  if (count - 1 > NANBOX_INTMAX) {
     // i guess streams of 0x100000 are big enough, right?
     sifault(sinter_fault_internal_error);
-    return NANBOX_OFEMPTY();
+    return -1;
   }
 
-  sinanbox_t new_head = siarray_get(stream_array, index - 1);
+  sinanbox_t new_head = siarray_get(stream_array, count - 1);
   siheap_refbox(new_head);
   siheap_intcont_t *ic = siintcont_new(prim_stream_reverse_cont, 2);
-  siheap_intderef(stream_array);
-  ic->argv[0] = SIHEAP_PTRTONANBOX(stream_array);
-  ic->argv[1] = NANBOX_OFINT(index - 1);
-  return source_pair(new_head, SIHEAP_PTRTONANBOX(ic));
+  // the continuation takes the frame's reference to the array
+  ic->argv[0] = state[1];
+  ic->argv[1] = NANBOX_OFINT(count - 1);
+  state[1] = NANBOX_OFNULL();
+  *retv = source_pair(new_head, SIHEAP_PTRTONANBOX(ic));
+  return -1;
+}
+
+static sinanbox_t sivmfn_prim_stream_reverse(uint8_t argc, sinanbox_t *argv) {
+  return sivm_drive(sivmfn_drives + drive_stream_reverse, argc, argv);
 }
 
 static sinanbox_t sivmfn_prim_stream_tail(uint8_t argc, sinanbox_t *argv) {
@@ -1461,74 +1616,65 @@ static sinanbox_t sivmfn_prim_stream_tail(uint8_t argc, sinanbox_t *argv) {
   return source_stream_tail(argv[0]);
 }
 
-static sinanbox_t sivmfn_prim_stream_to_list(uint8_t argc, sinanbox_t *argv) {
-  CHECK_ARGC(1);
-
-  sinanbox_t stream = argv[0];
-
-  if (NANBOX_ISNULL(stream)) {
-    return NANBOX_OFNULL();
+/**
+ * Steps of stream_to_list. The state is the rest of the stream, and the new
+ * list and its last pair (see list_builder_append).
+ */
+static int step_stream_to_list(sinanbox_t *state, sinanbox_t result, sinanbox_t *retv) {
+  if (!NANBOX_ISEMPTY(result)) {
+    stream_advance(state, result);
   }
 
-  siheap_array_t *new_list = NULL;
-  siheap_array_t *prev_pair = NULL;
-  siheap_refbox(stream);
-  while (!NANBOX_ISNULL(stream)) {
-    siheap_array_t *stream_pair = nanbox_toarray(stream);
-    sinanbox_t new_val = siarray_get(stream_pair, 0);
-    sinanbox_t stream_tail = siarray_get(stream_pair, 1);
-    siheap_intref(stream_pair);
-    stream = siexec_nanbox(stream_tail, 0, NULL);
-    siheap_intderef(stream_pair);
-
-    siheap_refbox(new_val);
-    siheap_deref(stream_pair);
-
-    siheap_array_t *new_pair = source_pair_ptr(new_val, NANBOX_OFNULL());
-    if (prev_pair) {
-      siarray_put(prev_pair, 1, SIHEAP_PTRTONANBOX(new_pair));
-    }
-    if (!new_list) {
-      new_list = new_pair;
-      siheap_intref(new_list);
-    }
-    prev_pair = new_pair;
+  if (NANBOX_ISNULL(state[0])) {
+    *retv = state[1];
+    state[1] = NANBOX_OFNULL();
+    return -1;
   }
 
-  siheap_derefbox(stream);
-  siheap_intderef(new_list);
-  return SIHEAP_PTRTONANBOX(new_list);
+  const sinanbox_t head = source_head(state[0]);
+  siheap_refbox(head);
+  list_builder_append(state + 1, head);
+  return stream_call_tail(state);
 }
 
-static sinanbox_t sivmfn_prim_is_stream(uint8_t argc, sinanbox_t *argv) {
-  CHECK_ARGC(1);
-  sinanbox_t xs = argv[0];
+static sinanbox_t sivmfn_prim_stream_to_list(uint8_t argc, sinanbox_t *argv) {
+  return sivm_drive(sivmfn_drives + drive_stream_to_list, argc, argv);
+}
 
-  siheap_refbox(xs);
-  while (!NANBOX_ISNULL(xs)) {
-    siheap_header_t *obj = SIHEAP_NANBOXTOPTR(xs);
-    siheap_array_t *pair = (siheap_array_t *) obj;
-    if (!NANBOX_ISPTR(xs) || obj->type != sitype_array || pair->count != 2) {
-      siheap_derefbox(xs);
-      return NANBOX_OFBOOL(false);
-    }
+/**
+ * Steps of is_stream. The state is the rest of the stream.
+ */
+static int step_is_stream(sinanbox_t *state, sinanbox_t result, sinanbox_t *retv) {
+  if (!NANBOX_ISEMPTY(result)) {
+    stream_advance(state, result);
+  }
 
-    sinanbox_t tail = siarray_get(pair, 1);
-    siheap_header_t *tailobj = SIHEAP_NANBOXTOPTR(tail);
+  const sinanbox_t xs = state[0];
+  if (NANBOX_ISNULL(xs)) {
+    *retv = NANBOX_OFBOOL(true);
+    return -1;
+  }
 
-    if (!NANBOX_ISIFN(tail)
-        && !(NANBOX_ISPTR(tail) && (tailobj->type == sitype_function || tailobj->type == sitype_intcont))) {
-      siheap_deref(pair);
-      return NANBOX_OFBOOL(false);
-    }
+  siheap_header_t *obj = SIHEAP_NANBOXTOPTR(xs);
+  siheap_array_t *pair = (siheap_array_t *) obj;
+  if (!NANBOX_ISPTR(xs) || obj->type != sitype_array || pair->count != 2) {
+    *retv = NANBOX_OFBOOL(false);
+    return -1;
+  }
 
-    siheap_intref(pair);
-    xs = siexec_nanbox(tail, 0, NULL);
-    siheap_intderef(pair);
-    siheap_deref(pair);
+  sinanbox_t tail = siarray_get(pair, 1);
+  siheap_header_t *tailobj = SIHEAP_NANBOXTOPTR(tail);
+  if (!NANBOX_ISIFN(tail)
+      && !(NANBOX_ISPTR(tail) && (tailobj->type == sitype_function || tailobj->type == sitype_intcont))) {
+    *retv = NANBOX_OFBOOL(false);
+    return -1;
   }
 
-  return NANBOX_OFBOOL(true);
+  return stream_call_tail(state);
+}
+
+static sinanbox_t sivmfn_prim_is_stream(uint8_t argc, sinanbox_t *argv) {
+  return sivm_drive(sivmfn_drives + drive_is_stream, argc, argv);
 }
 
 /******************************************************************************
@@ -1596,97 +1742,144 @@ static sinanbox_t sivmfn_prim_noop(uint8_t argc, sinanbox_t *argv) {
   return NANBOX_OFUNDEF();
 }
 
-sivmfnptr_t sivmfn_primitives[] = {
-  sivmfn_prim_accumulate,
-  sivmfn_prim_append,
-  sivmfn_prim_array_length,
-  sivmfn_prim_build_list,
-  sivmfn_prim_build_stream,
-  sivmfn_prim_display,
-  /* draw_data */ sivmfn_prim_noop, // not supported, obviously
-  sivmfn_prim_enum_list,
+#define BORROWS(fn) { (fn), sivmfn_borrows_args }
+#define CONSUMES(fn) { (fn), sivmfn_consumes_args }
+#define DRIVEN(fn) { (fn), sivmfn_driven }
+
+const sivmfn_t sivmfn_primitives[] = {
+  DRIVEN(sivmfn_prim_accumulate),
+  BORROWS(sivmfn_prim_append),
+  BORROWS(sivmfn_prim_array_length),
+  DRIVEN(sivmfn_prim_build_list),
+  BORROWS(sivmfn_prim_build_stream),
+  BORROWS(sivmfn_prim_display),
+  /* draw_data */ BORROWS(sivmfn_prim_noop), // not supported, obviously
+  BORROWS(sivmfn_prim_enum_list),
+  BORROWS(sivmfn_prim_enum_stream),
+  BORROWS(sivmfn_prim_equal),
+  BORROWS(sivmfn_prim_error),
+  DRIVEN(sivmfn_prim_eval_stream),
+  DRIVEN(sivmfn_prim_filter),
+  DRIVEN(sivmfn_prim_for_each),
+  BORROWS(sivmfn_prim_head),
+  BORROWS(sivmfn_prim_integers_from),
+  BORROWS(sivmfn_prim_is_array),
+  BORROWS(sivmfn_prim_is_boolean),
+  BORROWS(sivmfn_prim_is_function),
+  BORROWS(sivmfn_prim_is_list),
+  BORROWS(sivmfn_prim_is_null),
+  BORROWS(sivmfn_prim_is_number),
+  BORROWS(sivmfn_prim_is_pair),
+  DRIVEN(sivmfn_prim_is_stream),
+  BORROWS(sivmfn_prim_is_string),
+  BORROWS(sivmfn_prim_is_undefined),
+  BORROWS(sivmfn_prim_length),
+  CONSUMES(sivmfn_prim_list),
+  BORROWS(sivmfn_prim_list_ref),
+  BORROWS(sivmfn_prim_list_to_stream),
+  /* list_to_string */ BORROWS(sivmfn_prim_unimpl), // do we want to implement this?
+  DRIVEN(sivmfn_prim_map),
+  BORROWS(sivmfn_prim_math_abs),
+  BORROWS(sivmfn_prim_math_acos),
+  BORROWS(sivmfn_prim_math_acosh),
+  BORROWS(sivmfn_prim_math_asin),
+  BORROWS(sivmfn_prim_math_asinh),
+  BORROWS(sivmfn_prim_math_atan),
+  BORROWS(sivmfn_prim_math_atan2),
+  BORROWS(sivmfn_prim_math_atanh),
+  BORROWS(sivmfn_prim_math_cbrt),
+  BORROWS(sivmfn_prim_math_ceil),
+  BORROWS(sivmfn_prim_math_clz32),
+  BORROWS(sivmfn_prim_math_cos),
+  BORROWS(sivmfn_prim_math_cosh),
+  BORROWS(sivmfn_prim_math_exp),
+  BORROWS(sivmfn_prim_math_expm1),
+  BORROWS(sivmfn_prim_math_floor),
+  BORROWS(sivmfn_prim_math_fround),
+  BORROWS(sivmfn_prim_math_hypot),
+  BORROWS(sivmfn_prim_math_imul),
+  BORROWS(sivmfn_prim_math_log),
+  BORROWS(sivmfn_prim_math_log1p),
+  BORROWS(sivmfn_prim_math_log2),
+  BORROWS(sivmfn_prim_math_log10),
+  BORROWS(sivmfn_prim_math_max),
+  BORROWS(sivmfn_prim_math_min),
+  BORROWS(sivmfn_prim_math_pow),
+  BORROWS(sivmfn_prim_math_random),
+  BORROWS(sivmfn_prim_math_round),
+  BORROWS(sivmfn_prim_math_sign),
+  BORROWS(sivmfn_prim_math_sin),
+  BORROWS(sivmfn_prim_math_sinh),
+  BORROWS(sivmfn_prim_math_sqrt),
+  BORROWS(sivmfn_prim_math_tan),
+  BORROWS(sivmfn_prim_math_tanh),
+  BORROWS(sivmfn_prim_math_trunc),
+  BORROWS(sivmfn_prim_member),
+  CONSUMES(sivmfn_prim_pair),
+  /* parse_int */ BORROWS(sivmfn_prim_unimpl), // TODO: doesn't make sense without the ability to take input (prompt)
+  BORROWS(sivmfn_prim_remove),
+  BORROWS(sivmfn_prim_remove_all),
+  BORROWS(sivmfn_prim_reverse),
+  /* runtime */ BORROWS(sivmfn_prim_unimpl), // TODO: need to get time from host
+  CONSUMES(sivmfn_prim_set_head),
+  CONSUMES(sivmfn_prim_set_tail),
+  CONSUMES(sivmfn_prim_stream),
+  BORROWS(sivmfn_prim_stream_append),
+  BORROWS(sivmfn_prim_stream_filter),
+  DRIVEN(sivmfn_prim_stream_for_each),
+  DRIVEN(sivmfn_prim_stream_length),
+  BORROWS(sivmfn_prim_stream_map),
+  DRIVEN(sivmfn_prim_stream_member),
+  DRIVEN(sivmfn_prim_stream_ref),
+  BORROWS(sivmfn_prim_stream_remove),
+  BORROWS(sivmfn_prim_stream_remove_all),
+  DRIVEN(sivmfn_prim_stream_reverse),
+  BORROWS(sivmfn_prim_stream_tail),
+  DRIVEN(sivmfn_prim_stream_to_list),
+  BORROWS(sivmfn_prim_tail),
+  /* stringify */ BORROWS(sivmfn_prim_unimpl), // TODO: do we want this?
+  /* prompt */ BORROWS(sivmfn_prim_unimpl) // TODO: need to call out to host
+};
+
+#undef BORROWS
+#undef CONSUMES
+
+_Static_assert(sizeof(sivmfn_primitives) / sizeof(*sivmfn_primitives) == SIVMFN_PRIMITIVE_COUNT,
+  "sivmfn_primitives has wrong number of entries");
+
+// in the order of the drive_ indices
+const sivmfn_drive_t sivmfn_drives[] = {
+  { sivmfn_prim_accumulate, step_accumulate, 3, 5 },
+  { sivmfn_prim_build_list, step_build_list, 2, 5 },
+  { sivmfn_prim_filter, step_filter, 2, 5 },
+  { sivmfn_prim_for_each, step_for_each, 2, 2 },
+  { sivmfn_prim_map, step_map, 2, 4 },
+  { sivmfn_prim_eval_stream, step_eval_stream, 2, 5 },
+  { sivmfn_prim_stream_for_each, step_stream_for_each, 2, 3 },
+  { sivmfn_prim_stream_length, step_stream_length, 1, 2 },
+  { sivmfn_prim_stream_member, step_stream_member, 2, 2 },
+  { sivmfn_prim_stream_ref, step_stream_ref, 2, 3 },
+  { sivmfn_prim_stream_reverse, step_stream_reverse, 1, 3 },
+  { sivmfn_prim_stream_to_list, step_stream_to_list, 1, 3 },
+  { sivmfn_prim_is_stream, step_is_stream, 1, 1 }
+};
+
+const size_t sivmfn_drive_count = sizeof(sivmfn_drives) / sizeof(*sivmfn_drives);
+
+// The functions of internal continuations (siheap_intcont_t), so that they can
+// be saved in a snapshot as indices rather than addresses.
+
+const sivmfnptr_t sivmfn_continuations[] = {
+  sivmfn_prim_list_to_stream,
+  prim_build_stream_cont,
   sivmfn_prim_enum_stream,
-  sivmfn_prim_equal,
-  sivmfn_prim_error,
-  sivmfn_prim_eval_stream,
-  sivmfn_prim_filter,
-  sivmfn_prim_for_each,
-  sivmfn_prim_head,
   sivmfn_prim_integers_from,
-  sivmfn_prim_is_array,
-  sivmfn_prim_is_boolean,
-  sivmfn_prim_is_function,
-  sivmfn_prim_is_list,
-  sivmfn_prim_is_null,
-  sivmfn_prim_is_number,
-  sivmfn_prim_is_pair,
-  sivmfn_prim_is_stream,
-  sivmfn_prim_is_string,
-  sivmfn_prim_is_undefined,
-  sivmfn_prim_length,
-  sivmfn_prim_list,
-  sivmfn_prim_list_ref,
-  sivmfn_prim_list_to_stream,
-  /* list_to_string */ sivmfn_prim_unimpl, // do we want to implement this?
-  sivmfn_prim_map,
-  sivmfn_prim_math_abs,
-  sivmfn_prim_math_acos,
-  sivmfn_prim_math_acosh,
-  sivmfn_prim_math_asin,
-  sivmfn_prim_math_asinh,
-  sivmfn_prim_math_atan,
-  sivmfn_prim_math_atan2,
-  sivmfn_prim_math_atanh,
-  sivmfn_prim_math_cbrt,
-  sivmfn_prim_math_ceil,
-  sivmfn_prim_math_clz32,
-  sivmfn_prim_math_cos,
-  sivmfn_prim_math_cosh,
-  sivmfn_prim_math_exp,
-  sivmfn_prim_math_expm1,
-  sivmfn_prim_math_floor,
-  sivmfn_prim_math_fround,
-  sivmfn_prim_math_hypot,
-  sivmfn_prim_math_imul,
-  sivmfn_prim_math_log,
-  sivmfn_prim_math_log1p,
-  sivmfn_prim_math_log2,
-  sivmfn_prim_math_log10,
-  sivmfn_prim_math_max,
-  sivmfn_prim_math_min,
-  sivmfn_prim_math_pow,
-  sivmfn_prim_math_random,
-  sivmfn_prim_math_round,
-  sivmfn_prim_math_sign,
-  sivmfn_prim_math_sin,
-  sivmfn_prim_math_sinh,
-  sivmfn_prim_math_sqrt,
-  sivmfn_prim_math_tan,
-  sivmfn_prim_math_tanh,
-  sivmfn_prim_math_trunc,
-  sivmfn_prim_member,
-  sivmfn_prim_pair,
-  /* parse_int */ sivmfn_prim_unimpl, // TODO: doesn't make sense without the ability to take input (prompt)
-  sivmfn_prim_remove,
-  sivmfn_prim_remove_all,
-  sivmfn_prim_reverse,
-  /* runtime */ sivmfn_prim_unimpl, // TODO: need to get time from host
-  sivmfn_prim_set_head,
-  sivmfn_prim_set_tail,
-  sivmfn_prim_stream,
-  sivmfn_prim_stream_append,
-  sivmfn_prim_stream_filter,
-  sivmfn_prim_stream_for_each,
-  sivmfn_prim_stream_length,
-  sivmfn_prim_stream_map,
-  sivmfn_prim_stream_member,
-  sivmfn_prim_stream_ref,
-  sivmfn_prim_stream_remove,
-  sivmfn_prim_stream_remove_all,
-  sivmfn_prim_stream_reverse,
-  sivmfn_prim_stream_tail,
-  sivmfn_prim_stream_to_list,
-  sivmfn_prim_tail,
-  /* stringify */ sivmfn_prim_unimpl, // TODO: do we want this?
-  /* prompt */ sivmfn_prim_unimpl // TODO: need to call out to host
+  prim_stream_cont,
+  prim_stream_append_cont,
+  prim_stream_filter_cont,
+  prim_stream_map_cont,
+  prim_stream_remove_cont,
+  prim_stream_remove_all_cont,
+  prim_stream_reverse_cont
 };
+const size_t sivmfn_continuation_count = sizeof(sivmfn_continuations) / sizeof(*sivmfn_continuations);
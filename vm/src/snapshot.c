@@ -0,0 +1,334 @@
+#include <sinter/config.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <sinter/heap.h>
+#include <sinter/heap_obj.h>
+#include <sinter/stack.h>
+#include <sinter/vm.h>
+#include <sinter/internal_fn.h>
+#include <sinter/snapshot.h>
+
+/*
+ * Snapshots of a loaded program.
+ *
+ * A snapshot is a header, followed by the used part of the heap. Heap objects
+ * hold raw pointers (to other objects, into the program, and into the stack),
+ * so these are saved as offsets from the start of the heap, program or stack
+ * respectively, plus one (so that zero is NULL), and relocated when the
+ * snapshot is restored. Internal continuations are saved as indices into
+ * sivmfn_continuations. NaN-boxes are already offsets, and are copied as is.
+ */
+
+#define SNAPSHOT_MAGIC 0x4e534953u // "SISN"
+#define SNAPSHOT_VERSION 1u
+
+#ifdef SINTER_DEBUG_MEMORY_CHECK
+#define SNAPSHOT_MEMORY_CHECK 1u
+#else
+#define SNAPSHOT_MEMORY_CHECK 0u
+#endif
+#ifdef SINTER_FIXED_POINT
+#define SNAPSHOT_FIXED_POINT 1u
+#else
+#define SNAPSHOT_FIXED_POINT 0u
+#endif
+
+// The options of the build that change the layout of the heap, or the meaning
+// of a NaN-box. A snapshot can only be restored by a build with the same
+// options.
+#define SNAPSHOT_CONFIG ((uint32_t) (sizeof(void *) | sizeof(sinanbox_t) << 8 | \
+  SNAPSHOT_MEMORY_CHECK << 16 | SNAPSHOT_FIXED_POINT << 17))
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t config;
+  /**
+   * The size of the program the snapshot was saved from.
+   */
+  uint32_t program_size;
+  /**
+   * The number of bytes of the heap in the snapshot.
+   */
+  uint32_t heap_used;
+  /**
+   * The offset of the last block of the heap. If it is free, only its header is
+   * in the snapshot, and it is resized to the end of the heap when the
+   * snapshot is restored.
+   */
+  uint32_t last_block;
+  /**
+   * The offset of the first free block, plus one, or zero if there is none.
+   */
+  uint32_t first_free;
+  /**
+   * The stack of the loaded program: the frame that keeps the global
+   * environment, and the result of the last call.
+   */
+  sinanbox_t stack[2];
+} snapshot_header_t;
+
+#define SNAPSHOT_HEAP_OFFSET SIHEAP_ALIGN(sizeof(snapshot_header_t))
+
+typedef struct {
+  bool save;
+  /**
+   * Where relocated fields are written: the heap in the snapshot when saving,
+   * or the heap itself when restoring.
+   */
+  unsigned char *out;
+  size_t heap_used;
+  size_t program_size;
+} relocation_t;
+
+/**
+ * Relocates a pointer field of a heap object, which points into the region
+ * that starts at base and is limit bytes long.
+ */
+static void relocate_field(const relocation_t *r, siheap_header_t *obj, size_t field_offset, const void *base, size_t limit) {
+  unsigned char *field = (unsigned char *) obj + field_offset;
+  unsigned char *out = r->out + (field - siheap);
+  if (r->save) {
+    const unsigned char *ptr;
+    memcpy(&ptr, field, sizeof(ptr));
+    const uintptr_t offset = ptr ? (uintptr_t) (ptr - (const unsigned char *) base) + 1 : 0;
+    memcpy(out, &offset, sizeof(offset));
+  } else {
+    uintptr_t offset;
+    memcpy(&offset, field, sizeof(offset));
+    if (offset > limit) {
+      SIDEBUG("Snapshot pointer out of range\n");
+      sifault(sinter_fault_invalid_snapshot);
+    }
+    const unsigned char *ptr = offset ? (const unsigned char *) base + offset - 1 : NULL;
+    memcpy(out, &ptr, sizeof(ptr));
+  }
+}
+
+static void relocate_intcont(const relocation_t *r, siheap_intcont_t *obj) {
+  if (r->save) {
+    size_t index = 0;
+    while (index < sivmfn_continuation_count && sivmfn_continuations[index] != obj->fn) {
+      ++index;
+    }
+    if (index == sivmfn_continuation_count) {
+      SIBUGM("Unknown internal continuation\n");
+      sifault(sinter_fault_internal_error);
+    }
+    const sivmfnptr_t fn = (sivmfnptr_t) (uintptr_t) (index + 1);
+    memcpy(r->out + ((unsigned char *) &obj->fn - siheap), &fn, sizeof(fn));
+  } else {
+    const uintptr_t index = (uintptr_t) obj->fn;
+    if (!index || index > sivmfn_continuation_count) {
+      SIDEBUG("Snapshot continuation out of range\n");
+      sifault(sinter_fault_invalid_snapshot);
+    }
+    obj->fn = sivmfn_continuations[index - 1];
+  }
+}
+
+#define RELOCATE_HEAP(type, field) relocate_field(r, obj, offsetof(type, field), siheap, r->heap_used)
+#define RELOCATE_PROGRAM(type, field) relocate_field(r, obj, offsetof(type, field), sistate.program, r->program_size)
+#define RELOCATE_STACK(type, field) relocate_field(r, obj, offsetof(type, field), sistack, sizeof(sistack) + 1)
+
+static void relocate_block(const relocation_t *r, siheap_header_t *obj) {
+  RELOCATE_HEAP(siheap_header_t, prev_node);
+
+  switch (obj->type) {
+  case sitype_free:
+    RELOCATE_HEAP(siheap_free_t, prev_free);
+    RELOCATE_HEAP(siheap_free_t, next_free);
+    break;
+  case sitype_env:
+    RELOCATE_HEAP(siheap_env_t, parent);
+    break;
+  case sitype_function:
+    RELOCATE_PROGRAM(siheap_function_t, code);
+    RELOCATE_HEAP(siheap_function_t, env);
+    break;
+  case sitype_frame:
+    RELOCATE_PROGRAM(siheap_frame_t, return_address);
+    RELOCATE_STACK(siheap_frame_t, saved_stack_bottom);
+    RELOCATE_STACK(siheap_frame_t, saved_stack_limit);
+    RELOCATE_STACK(siheap_frame_t, saved_stack_top);
+    RELOCATE_HEAP(siheap_frame_t, saved_env);
+    break;
+  case sitype_strconst:
+    RELOCATE_PROGRAM(siheap_strconst_t, string);
+    break;
+  case sitype_strpair:
+    RELOCATE_HEAP(siheap_strpair_t, left);
+    RELOCATE_HEAP(siheap_strpair_t, right);
+    break;
+  case sitype_array:
+    RELOCATE_HEAP(siheap_array_t, data);
+    break;
+  case sitype_intcont:
+    relocate_intcont(r, (siheap_intcont_t *) obj);
+    break;
+  case sitype_string:
+  case sitype_strshort:
+  case sitype_array_data:
+  case sitype_empty:
+    break;
+  case sitype_arena_free:
+  default:
+    SIDEBUG("Snapshot heap object of unknown type %d\n", obj->type);
+    sifault(r->save ? sinter_fault_internal_error : sinter_fault_invalid_snapshot);
+  }
+}
+
+#undef RELOCATE_HEAP
+#undef RELOCATE_PROGRAM
+#undef RELOCATE_STACK
+
+/**
+ * Finds the last block of the heap, and returns the number of bytes of the
+ * heap to save.
+ */
+static size_t heap_used(siheap_header_t **last_block) {
+  siheap_header_t *cur = (siheap_header_t *) siheap;
+  siheap_header_t *last = cur;
+  while (SIHEAP_INRANGE(cur)) {
+    last = cur;
+    cur = siheap_next(cur);
+  }
+  *last_block = last;
+  return last->type == sitype_free
+    ? (size_t) ((unsigned char *) last - siheap) + sizeof(siheap_free_t)
+    : (size_t) SINTER_HEAP_SIZE;
+}
+
+size_t sisnapshot_heap_used(void) {
+  siheap_header_t *last_block;
+  return heap_used(&last_block);
+}
+
+size_t sisnapshot_size(void) {
+  siheap_header_t *last_block;
+  return SNAPSHOT_HEAP_OFFSET + heap_used(&last_block);
+}
+
+void sisnapshot_save(unsigned char *buffer) {
+  assert(sistack_top == sistack + 2);
+
+  siheap_header_t *last_block;
+  const size_t used = heap_used(&last_block);
+  const snapshot_header_t header = {
+    .magic = SNAPSHOT_MAGIC,
+    .version = SNAPSHOT_VERSION,
+    .config = SNAPSHOT_CONFIG,
+    .program_size = (uint32_t) (sistate.program_end - sistate.program),
+    .heap_used = (uint32_t) used,
+    .last_block = (uint32_t) ((unsigned char *) last_block - siheap),
+    .first_free = siheap_first_free ? (uint32_t) ((unsigned char *) siheap_first_free - siheap) + 1 : 0,
+    .stack = { sistack[0], sistack[1] }
+  };
+  memcpy(buffer, &header, sizeof(header));
+
+  const relocation_t r = {
+    .save = true,
+    .out = buffer + SNAPSHOT_HEAP_OFFSET
+  };
+  memcpy(r.out, siheap, used);
+  siheap_header_t *obj = (siheap_header_t *) siheap;
+  while (SIHEAP_INRANGE(obj)) {
+    relocate_block(&r, obj);
+    obj = siheap_next(obj);
+  }
+}
+
+void sisnapshot_restore(const unsigned char *snapshot, size_t snapshot_size) {
+  snapshot_header_t header;
+  if (snapshot_size < SNAPSHOT_HEAP_OFFSET) {
+    sifault(sinter_fault_invalid_snapshot);
+  }
+  memcpy(&header, snapshot, sizeof(header));
+
+  if (header.magic != SNAPSHOT_MAGIC || header.version != SNAPSHOT_VERSION || header.config != SNAPSHOT_CONFIG) {
+    SIDEBUG("Snapshot is from a different build\n");
+    sifault(sinter_fault_invalid_snapshot);
+  }
+  if (header.program_size != (size_t) (sistate.program_end - sistate.program)) {
+    SIDEBUG("Snapshot is of a different program\n");
+    sifault(sinter_fault_invalid_snapshot);
+  }
+  if (header.heap_used > snapshot_size - SNAPSHOT_HEAP_OFFSET
+    || header.last_block % SIHEAP_ALIGNMENT
+    || (size_t) header.last_block + sizeof(siheap_free_t) > header.heap_used) {
+    sifault(sinter_fault_invalid_snapshot);
+  }
+  if (header.heap_used > SINTER_HEAP_SIZE) {
+    sifault(sinter_fault_out_of_memory);
+  }
+
+  memcpy(siheap, snapshot + SNAPSHOT_HEAP_OFFSET, header.heap_used);
+
+  const relocation_t r = {
+    .save = false,
+    .out = siheap,
+    .heap_used = header.heap_used,
+    .program_size = header.program_size
+  };
+  siheap_header_t *const last = (siheap_header_t *) (siheap + header.last_block);
+  siheap_header_t *obj = (siheap_header_t *) siheap;
+  while (1) {
+    if (obj->size < sizeof(siheap_header_t) || obj->size % SIHEAP_ALIGNMENT
+      || (obj != last && (size_t) ((unsigned char *) obj - siheap) + obj->size > header.last_block)) {
+      SIDEBUG("Snapshot heap block has invalid size\n");
+      sifault(sinter_fault_invalid_snapshot);
+    }
+    relocate_block(&r, obj);
+    if (obj == last) {
+      break;
+    }
+    obj = siheap_next(obj);
+  }
+
+  if (header.first_free > header.heap_used) {
+    sifault(sinter_fault_invalid_snapshot);
+  }
+
+  // the heap may be larger than the one the snapshot was saved from
+  const size_t end = header.last_block + (size_t) last->size;
+  if (last->type == sitype_free) {
+    last->size = SINTER_HEAP_SIZE - header.last_block;
+  } else if (end != header.heap_used) {
+    sifault(sinter_fault_invalid_snapshot);
+  } else if (SINTER_HEAP_SIZE - end < sizeof(siheap_free_t)) {
+    // too small for a free block; leave it at the end of the last block
+    last->size = SINTER_HEAP_SIZE - header.last_block;
+  } else {
+    siheap_free_t *tail = (siheap_free_t *) (siheap + end);
+    *tail = (siheap_free_t) {
+      .header = {
+        .type = sitype_free,
+        .prev_node = last,
+        .size = SINTER_HEAP_SIZE - end
+      },
+      .next_free = header.first_free ? (siheap_free_t *) (siheap + header.first_free - 1) : NULL
+    };
+    if (tail->next_free) {
+      tail->next_free->prev_free = tail;
+    }
+    header.first_free = end + 1;
+  }
+  siheap_first_free = header.first_free ? (siheap_free_t *) (siheap + header.first_free - 1) : NULL;
+
+  sistack_init();
+  sistack[0] = header.stack[0];
+  sistack[1] = header.stack[1];
+  sistack_bottom = sistack + 1;
+  sistack_limit = sistack + 2;
+  sistack_top = sistack + 2;
+
+  if (!NANBOX_ISPTR(sistack[0]) || NANBOX_PTR(sistack[0]) << SIHEAP_ALIGN_SHIFT >= header.heap_used
+    || ((siheap_header_t *) SIHEAP_NANBOXTOPTR(sistack[0]))->type != sitype_frame) {
+    SIDEBUG("Snapshot stack is invalid\n");
+    sifault(sinter_fault_invalid_snapshot);
+  }
+}
@@ -0,0 +1,2010 @@
+#include <sinter/config.h>
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <sinter/opcode.h>
+#include <sinter/program.h>
+#include <sinter/heap.h>
+#include <sinter/debug.h>
+#include <sinter/specialise.h>
+
+#ifdef SINTER_SPECIALISE
+
+/*
+ * Load-time analysis of programs run with sinter_run_mutable.
+ *
+ * Every function reachable from the entry point is abstractly interpreted to
+ * find the operand stack entries, and entries of the function's own
+ * environment, that always hold numbers, or at least never hold heap objects.
+ * Instructions that only touch such values are then rewritten to the internal
+ * unchecked instructions (op_ldl_n, op_add_nn etc.).
+ *
+ * Block environments (op_newenv) are not tracked. An entry of a function's
+ * environment can be changed by another function only with an op_stp whose
+ * envindex reaches past that function's own environment; entries at an index
+ * that any such op_stp stores to are never assumed to hold anything.
+ *
+ * The last load of each entry of a function's own environment that no other
+ * function loads or stores to is then rewritten to move the value out of the
+ * environment (see move_last_loads), and each basic block is scanned for
+ * borrowed references (see borrow_block).
+ */
+
+// An abstract value is a combination of these flags; 0 means any value.
+// The entry does not hold a heap object, so it needs no reference counting.
+#define AV_NONPTR 1u
+// The entry holds a number (which is also AV_NONPTR).
+#define AV_NUMBER 3u
+
+/**
+ * The abstract state at the start of a basic block.
+ */
+typedef struct {
+  bool visited;
+  uint8_t stack_height;
+  uint8_t env_depth;
+  // the function's stack entries, and then its environment entries
+  uint8_t values[];
+} state_t;
+
+typedef struct {
+  address_t *items;
+  unsigned int count;
+  unsigned int capacity;
+} addrlist_t;
+
+typedef struct {
+  unsigned char *program;
+  address_t program_size;
+  const svm_function_t *fn;
+  // the index of the function in the function list
+  unsigned int fn_index;
+  // the first instructions of the basic blocks of the function, sorted
+  addrlist_t leaders;
+  unsigned char *states;
+  size_t state_size;
+  // a state to work on
+  state_t *state;
+  bool changed;
+} function_t;
+
+static SINTER_THREAD_LOCAL unsigned int scratch_used;
+
+// the indices of environment entries that are stored to by an op_stp outside
+// of the function that the environment belongs to
+static SINTER_THREAD_LOCAL uint8_t tainted[32];
+
+#define NO_FUNCTION UINT_MAX
+
+typedef struct {
+  address_t address;
+  // the function that creates this function with op_new_c, and the depth of
+  // the environment it is created in (see state_t), or NO_FUNCTION for the
+  // entry point, or if it is created in more than one place
+  unsigned int parent;
+  uint8_t parent_depth;
+  // the indices of the entries of its own environment that are loaded or
+  // stored to by the functions nested within it
+  uint8_t captured[32];
+  // the indices of the entries of its own environment that are stored to by
+  // the functions nested within it
+  uint8_t stored[32];
+#ifdef SINTER_INLINE_CALLS
+  // whether the function is stored to an entry of the program's environment
+  // that is never stored to again, and if so, the entry
+  bool has_global_slot;
+  uint8_t global_slot;
+  // whether calls to the function may be inlined
+  bool inlinable;
+  // the address, stack size and environment size of the function in the
+  // inlined program
+  address_t new_address;
+  uint8_t new_stack_size;
+  uint8_t new_env_size;
+#endif
+} fninfo_t;
+
+// the functions in the program, found through op_new_c
+static SINTER_THREAD_LOCAL fninfo_t *functions;
+static SINTER_THREAD_LOCAL unsigned int function_count;
+static SINTER_THREAD_LOCAL unsigned int function_capacity;
+
+// the indices of environment entries that are loaded or stored to by a
+// function whose environment could not be traced to the function it belongs to
+static SINTER_THREAD_LOCAL uint8_t captured_any[32];
+static SINTER_THREAD_LOCAL uint8_t stored_any[32];
+
+// set when a function that was already analysed turns out to be created in
+// more than one place
+static SINTER_THREAD_LOCAL bool parent_changed;
+
+/**
+ * Allocates scratch memory on the heap, or returns NULL if that would use up
+ * too much of the heap.
+ *
+ * This never lets siheap_malloc run out of memory, as that would mark and
+ * sweep (and so free) the other scratch blocks.
+ */
+static void *scratch_alloc(size_t size) {
+  size += sizeof(siheap_header_t);
+  if (size + SIHEAP_ALIGNMENT + scratch_used > SINTER_HEAP_SIZE / 2) {
+    return NULL;
+  }
+
+  const address_t block_size = SIHEAP_ALIGN((address_t) size);
+  siheap_free_t *cur = siheap_first_free;
+  while (cur && cur->header.size < block_size) {
+    cur = cur->next_free;
+  }
+  if (!cur) {
+    return NULL;
+  }
+
+  siheap_header_t *block = siheap_malloc(block_size, sitype_array_data);
+  scratch_used += block->size;
+  return block + 1;
+}
+
+static void scratch_free(void *data) {
+  if (!data) {
+    return;
+  }
+  siheap_header_t *block = ((siheap_header_t *) data) - 1;
+  scratch_used -= block->size;
+  siheap_deref(block);
+}
+
+/**
+ * Adds the address to the list if it is not already in it. Returns false if
+ * there is not enough scratch memory.
+ */
+static bool addrlist_add(addrlist_t *list, address_t address) {
+  for (unsigned int i = 0; i < list->count; ++i) {
+    if (list->items[i] == address) {
+      return true;
+    }
+  }
+
+  if (list->count == list->capacity) {
+    const unsigned int new_capacity = list->capacity ? list->capacity * 2 : 16;
+    address_t *new_items = scratch_alloc(new_capacity * sizeof(address_t));
+    if (!new_items) {
+      return false;
+    }
+    if (list->count) {
+      memcpy(new_items, list->items, list->count * sizeof(address_t));
+    }
+    scratch_free(list->items);
+    list->items = new_items;
+    list->capacity = new_capacity;
+  }
+
+  list->items[list->count++] = address;
+  return true;
+}
+
+static void addrlist_free(addrlist_t *list) {
+  scratch_free(list->items);
+  *list = (addrlist_t) { 0 };
+}
+
+/**
+ * Returns the index of the address in the sorted list, or -1 if it is not in
+ * the list.
+ */
+static int addrlist_find(const addrlist_t *list, address_t address) {
+  unsigned int lo = 0, hi = list->count;
+  while (lo < hi) {
+    const unsigned int mid = lo + (hi - lo) / 2;
+    if (list->items[mid] < address) {
+      lo = mid + 1;
+    } else if (list->items[mid] > address) {
+      hi = mid;
+    } else {
+      return (int) mid;
+    }
+  }
+  return -1;
+}
+
+/**
+ * Adds the function created by an op_new_c in the given function to the
+ * function list. Returns false if there is not enough scratch memory.
+ */
+static bool add_function(address_t address, unsigned int parent, uint8_t parent_depth) {
+  for (unsigned int i = 0; i < function_count; ++i) {
+    if (functions[i].address == address) {
+      if (functions[i].parent != NO_FUNCTION &&
+          (functions[i].parent != parent || functions[i].parent_depth != parent_depth)) {
+        functions[i].parent = NO_FUNCTION;
+        parent_changed = true;
+      }
+      return true;
+    }
+  }
+
+  if (function_count == function_capacity) {
+    const unsigned int new_capacity = function_capacity ? function_capacity * 2 : 16;
+    fninfo_t *new_functions = scratch_alloc(new_capacity * sizeof(fninfo_t));
+    if (!new_functions) {
+      return false;
+    }
+    if (function_count) {
+      memcpy(new_functions, functions, function_count * sizeof(fninfo_t));
+    }
+    scratch_free(functions);
+    functions = new_functions;
+    function_capacity = new_capacity;
+  }
+
+  functions[function_count++] = (fninfo_t) {
+    .address = address,
+    .parent = parent,
+    .parent_depth = parent_depth
+  };
+  return true;
+}
+
+/**
+ * Notes that the given function loads or stores to the entry at index of the
+ * environment levels above its own (block) environments, i.e. an op_ldp or
+ * op_stp with an envindex of the function's environment depth plus levels
+ * plus one.
+ */
+static void add_capture(unsigned int fn_index, unsigned int levels, uint8_t index, bool store) {
+  const uint8_t bit = 1u << (index % 8);
+  const fninfo_t *fn = functions + fn_index;
+  while (fn->parent != NO_FUNCTION) {
+    fninfo_t *parent = functions + fn->parent;
+    if (levels < fn->parent_depth) {
+      // a block environment of the parent, which is not tracked
+      return;
+    }
+    if (levels == fn->parent_depth) {
+      parent->captured[index / 8] |= bit;
+      if (store) {
+        parent->stored[index / 8] |= bit;
+      }
+      return;
+    }
+    levels -= fn->parent_depth + 1u;
+    fn = parent;
+  }
+  captured_any[index / 8] |= bit;
+  if (store) {
+    stored_any[index / 8] |= bit;
+  }
+}
+
+static void addrlist_sort(addrlist_t *list) {
+  for (unsigned int i = 1; i < list->count; ++i) {
+    const address_t v = list->items[i];
+    unsigned int j = i;
+    for (; j > 0 && list->items[j - 1] > v; --j) {
+      list->items[j] = list->items[j - 1];
+    }
+    list->items[j] = v;
+  }
+}
+
+/**
+ * Finds the basic blocks of the function, i.e. the instructions reachable from
+ * its entry that are branched to, or follow a conditional branch.
+ */
+static bool find_leaders(function_t *f) {
+  if (!addrlist_add(&f->leaders, (address_t) (&f->fn->code - f->program))) {
+    return false;
+  }
+
+  for (unsigned int i = 0; i < f->leaders.count; ++i) {
+    address_t pc = f->leaders.items[i];
+    while (true) {
+      const unsigned int size = pc < f->program_size ? siinstr_size(f->program[pc]) : 0;
+      if (!size || f->program_size - pc < size) {
+        return false;
+      }
+      const opcode_t *instr = f->program + pc;
+      const address_t next = pc + size;
+      bool ok = true;
+
+      switch (*instr) {
+      case op_br_t:
+      case op_br_f:
+        ok = addrlist_add(&f->leaders, next);
+        // fallthrough
+      case op_br:
+        ok = ok && addrlist_add(&f->leaders, next + ((const struct op_offset *) instr)->offset);
+        break;
+      case op_jmp:
+        ok = addrlist_add(&f->leaders, ((const struct op_address *) instr)->address);
+        break;
+      case op_ret_g:
+      case op_ret_f:
+      case op_ret_b:
+      case op_ret_u:
+      case op_ret_n:
+      case op_call_t:
+      case op_call_t_p:
+      case op_call_t_v:
+        break;
+      default:
+        pc = next;
+        for (unsigned int j = 0; j < f->leaders.count; ++j) {
+          if (f->leaders.items[j] == pc) {
+            goto next_leader;
+          }
+        }
+        continue;
+      }
+
+      if (!ok) {
+        return false;
+      }
+      break;
+    }
+next_leader:
+    ;
+  }
+
+  addrlist_sort(&f->leaders);
+  return true;
+}
+
+static inline state_t *get_state(function_t *f, unsigned int index) {
+  return (state_t *) (f->states + index * f->state_size);
+}
+
+/**
+ * Merges the state into the state at the start of the block at address.
+ */
+static bool merge(function_t *f, const state_t *state, address_t address) {
+  const int index = addrlist_find(&f->leaders, address);
+  if (index < 0) {
+    SIBUG();
+    return false;
+  }
+
+  state_t *target = get_state(f, (unsigned int) index);
+  if (!target->visited) {
+    memcpy(target, state, f->state_size);
+    f->changed = true;
+    return true;
+  }
+
+  if (target->stack_height != state->stack_height || target->env_depth != state->env_depth) {
+    return false;
+  }
+
+  const unsigned int stack_size = f->fn->stack_size;
+  for (unsigned int i = 0; i < f->fn->stack_size + f->fn->env_size; ++i) {
+    if (i >= target->stack_height && i < stack_size) {
+      continue;
+    }
+    const uint8_t merged = target->values[i] & state->values[i];
+    if (merged != target->values[i]) {
+      target->values[i] = merged;
+      f->changed = true;
+    }
+  }
+
+  return true;
+}
+
+#define PUSH(v) do { \
+  if (state->stack_height >= stack_size) { \
+    return false; \
+  } \
+  state->values[state->stack_height++] = (v); \
+} while (0)
+
+#define POP(v) do { \
+  if (!state->stack_height) { \
+    return false; \
+  } \
+  v = state->values[--state->stack_height]; \
+} while (0)
+
+#define DROP(n) do { \
+  if (state->stack_height < (n)) { \
+    return false; \
+  } \
+  state->stack_height -= (n); \
+} while (0)
+
+#define REWRITE(new_op) do { \
+  if (rewrite) { \
+    f->program[pc] = (new_op); \
+  } \
+} while (0)
+
+// the ops quickening produces are left alone
+#define IS_QUICKENED(op) ((op) >= op_add_ii && (op) <= op_neq_ff)
+
+/**
+ * Runs the block starting at the given leader from the given state, and merges
+ * the resulting state into the blocks that follow it.
+ *
+ * If rewrite is set, rewrites instructions according to the state. If
+ * discover is set, adds the functions the block creates to the function list,
+ * and notes the environment entries it stores to outside its function.
+ */
+static bool run_block(function_t *f, unsigned int leader, state_t *state, bool rewrite, bool discover) {
+  const unsigned int stack_size = f->fn->stack_size;
+  const unsigned int env_size = f->fn->env_size;
+  uint8_t *const env = state->values + stack_size;
+  address_t pc = f->leaders.items[leader];
+
+  while (true) {
+    const opcode_t *instr = f->program + pc;
+    const opcode_t op = *instr;
+    const address_t next = pc + siinstr_size(op);
+    uint8_t v0, v1;
+
+    switch (op) {
+    case op_nop:
+      break;
+
+    case op_ldc_i:
+    case op_lgc_i:
+    case op_ldc_f32:
+    case op_lgc_f32:
+    case op_ldc_f64:
+    case op_lgc_f64:
+      PUSH(AV_NUMBER);
+      break;
+
+    case op_ldc_b_0:
+    case op_ldc_b_1:
+    case op_lgc_b_0:
+    case op_lgc_b_1:
+    case op_lgc_u:
+    case op_lgc_n:
+    case op_new_c_p:
+    case op_new_c_v:
+      PUSH(AV_NONPTR);
+      break;
+
+    case op_lgc_s:
+    case op_new_a:
+      PUSH(0);
+      break;
+
+    case op_new_c:
+      if (discover && !add_function(((const struct op_address *) instr)->address, f->fn_index, state->env_depth)) {
+        return false;
+      }
+      PUSH(0);
+      break;
+
+    case op_pop_g:
+    case op_pop_b:
+    case op_pop_f:
+    case op_pop_bw:
+      DROP(1);
+      break;
+
+    case op_add_g:
+    case op_add_f:
+    case op_add_nn:
+    case op_add_ii:
+    case op_add_ff:
+      POP(v1);
+      POP(v0);
+      if (!IS_QUICKENED(op)) {
+        REWRITE(v0 == AV_NUMBER && v1 == AV_NUMBER ? op_add_nn : op_add_g);
+      }
+      // adding a number to anything else faults
+      PUSH(v0 == AV_NUMBER || v1 == AV_NUMBER ? AV_NUMBER : 0);
+      break;
+
+#define ARITHMETIC_CASES(name) \
+    case op_ ## name ## _g: \
+    case op_ ## name ## _f: \
+    case op_ ## name ## _nn: \
+      POP(v1); \
+      POP(v0); \
+      REWRITE(v0 == AV_NUMBER && v1 == AV_NUMBER ? op_ ## name ## _nn : op_ ## name ## _g); \
+      PUSH(AV_NUMBER); \
+      break;
+
+    ARITHMETIC_CASES(sub)
+    ARITHMETIC_CASES(mul)
+    ARITHMETIC_CASES(div)
+    ARITHMETIC_CASES(mod)
+#undef ARITHMETIC_CASES
+
+    case op_sub_ii:
+    case op_sub_ff:
+    case op_mul_ii:
+    case op_mul_ff:
+      DROP(2);
+      PUSH(AV_NUMBER);
+      break;
+
+    case op_neg_g:
+    case op_neg_f:
+      DROP(1);
+      PUSH(AV_NUMBER);
+      break;
+
+    case op_not_g:
+    case op_not_b:
+      DROP(1);
+      PUSH(AV_NONPTR);
+      break;
+
+#define COMPARISON_CASES(name) \
+    case op_ ## name ## _g: \
+    case op_ ## name ## _f: \
+    case op_ ## name ## _nn: \
+      POP(v1); \
+      POP(v0); \
+      REWRITE(v0 == AV_NUMBER && v1 == AV_NUMBER ? op_ ## name ## _nn : op_ ## name ## _g); \
+      PUSH(AV_NONPTR); \
+      break;
+
+    COMPARISON_CASES(lt)
+    COMPARISON_CASES(gt)
+    COMPARISON_CASES(le)
+    COMPARISON_CASES(ge)
+#undef COMPARISON_CASES
+
+    case op_lt_ii:
+    case op_lt_ff:
+    case op_gt_ii:
+    case op_gt_ff:
+    case op_le_ii:
+    case op_le_ff:
+    case op_ge_ii:
+    case op_ge_ff:
+    case op_eq_g:
+    case op_eq_f:
+    case op_eq_b:
+    case op_eq_ii:
+    case op_eq_ff:
+    case op_neq_g:
+    case op_neq_f:
+    case op_neq_b:
+    case op_neq_ii:
+    case op_neq_ff:
+      DROP(2);
+      PUSH(AV_NONPTR);
+      break;
+
+    case op_ldl_g:
+    case op_ldl_f:
+    case op_ldl_b:
+    case op_ldl_n:
+    case op_ldl_bw:
+    case op_ldl_mv:
+    case op_ldp_g:
+    case op_ldp_f:
+    case op_ldp_b:
+    case op_ldp_n:
+    case op_ldp_bw:
+    case op_ldp_mv: {
+      const bool is_ldl = op == op_ldl_g || op == op_ldl_f || op == op_ldl_b || op == op_ldl_n ||
+        op == op_ldl_bw || op == op_ldl_mv;
+      const uint8_t index = ((const struct op_oneindex *) instr)->index;
+      if (discover && !is_ldl && ((const struct op_twoindex *) instr)->envindex > state->env_depth) {
+        add_capture(f->fn_index, ((const struct op_twoindex *) instr)->envindex - state->env_depth - 1u, index, false);
+      }
+      // whether this loads from the function's own environment
+      const bool own_env = index < env_size &&
+        (is_ldl ? !state->env_depth : ((const struct op_twoindex *) instr)->envindex == state->env_depth);
+      const uint8_t v = own_env ? env[index] : 0;
+      if (v == AV_NUMBER) {
+        REWRITE(is_ldl ? op_ldl_n : op_ldp_n);
+      } else if (op == op_ldl_n || op == op_ldp_n) {
+        REWRITE(is_ldl ? op_ldl_g : op_ldp_g);
+      }
+      PUSH(v);
+      break;
+    }
+
+    case op_stl_g:
+    case op_stl_b:
+    case op_stl_f:
+    case op_stl_n:
+    case op_stp_g:
+    case op_stp_b:
+    case op_stp_f:
+    case op_stp_n: {
+      const bool is_stl = op == op_stl_g || op == op_stl_b || op == op_stl_f || op == op_stl_n;
+      const uint8_t index = ((const struct op_oneindex *) instr)->index;
+      const uint8_t envindex = is_stl ? 0 : ((const struct op_twoindex *) instr)->envindex;
+      const bool own_env = index < env_size && (is_stl ? !state->env_depth : envindex == state->env_depth);
+      if (discover && !is_stl && envindex > state->env_depth) {
+        tainted[index / 8] |= 1u << (index % 8);
+        add_capture(f->fn_index, envindex - state->env_depth - 1u, index, true);
+      }
+
+      POP(v0);
+      if (own_env && (env[index] & AV_NONPTR)) {
+        // the entry does not hold a heap object, so it need not be dereferenced
+        REWRITE(is_stl ? op_stl_n : op_stp_n);
+      } else if (op == op_stl_n || op == op_stp_n) {
+        REWRITE(is_stl ? op_stl_g : op_stp_g);
+      }
+      if (own_env) {
+        env[index] = (tainted[index / 8] & (1u << (index % 8))) ? 0 : v0;
+      }
+      break;
+    }
+
+    case op_lda_g:
+    case op_lda_b:
+    case op_lda_f:
+    case op_lda_bw:
+      DROP(2);
+      PUSH(0);
+      break;
+
+    case op_sta_g:
+    case op_sta_b:
+    case op_sta_f:
+    case op_sta_bw:
+      DROP(3);
+      break;
+
+    case op_dup:
+    case op_dup_bw:
+      if (!state->stack_height) {
+        return false;
+      }
+      v0 = state->values[state->stack_height - 1];
+      PUSH(v0);
+      break;
+
+    case op_newenv:
+      if (state->env_depth == UINT8_MAX) {
+        return false;
+      }
+      ++state->env_depth;
+      break;
+
+    case op_popenv:
+      if (!state->env_depth) {
+        return false;
+      }
+      --state->env_depth;
+      break;
+
+    case op_call:
+      DROP(((const struct op_call *) instr)->num_args + 1u);
+      PUSH(0);
+      break;
+
+    case op_call_p:
+    case op_call_v:
+      DROP(((const struct op_call_internal *) instr)->num_args);
+      PUSH(0);
+      break;
+
+    case op_br_t:
+    case op_br_f:
+      DROP(1);
+      return merge(f, state, next) &&
+        merge(f, state, next + ((const struct op_offset *) instr)->offset);
+
+    case op_br:
+      return merge(f, state, next + ((const struct op_offset *) instr)->offset);
+
+    case op_jmp:
+      return merge(f, state, ((const struct op_address *) instr)->address);
+
+    case op_ret_g:
+    case op_ret_f:
+    case op_ret_b:
+    case op_ret_u:
+    case op_ret_n:
+    case op_call_t:
+    case op_call_t_p:
+    case op_call_t_v:
+      return true;
+
+    default:
+      return false;
+    }
+
+    pc = next;
+    if (addrlist_find(&f->leaders, pc) >= 0) {
+      return merge(f, state, pc);
+    }
+  }
+}
+
+#undef PUSH
+#undef POP
+#undef DROP
+#undef REWRITE
+
+/**
+ * Gets the number of stack entries the instruction pops and pushes. Returns
+ * false if the instruction ends a basic block.
+ *
+ * op_dup is taken to push its copy without popping the original.
+ */
+static bool stack_effect(const opcode_t *instr, unsigned int *pops, unsigned int *pushes) {
+  *pops = 0;
+  *pushes = 0;
+  switch (*instr) {
+  case op_nop:
+  case op_newenv:
+  case op_popenv:
+    return true;
+
+  case op_pop_g:
+  case op_pop_b:
+  case op_pop_f:
+  case op_pop_bw:
+  case op_stl_g:
+  case op_stl_b:
+  case op_stl_f:
+  case op_stl_n:
+  case op_stp_g:
+  case op_stp_b:
+  case op_stp_f:
+  case op_stp_n:
+    *pops = 1;
+    return true;
+
+  case op_not_g:
+  case op_not_b:
+  case op_neg_g:
+  case op_neg_f:
+    *pops = 1;
+    *pushes = 1;
+    return true;
+
+  case op_lda_g:
+  case op_lda_b:
+  case op_lda_f:
+  case op_lda_bw:
+    *pops = 2;
+    *pushes = 1;
+    return true;
+
+  case op_sta_g:
+  case op_sta_b:
+  case op_sta_f:
+  case op_sta_bw:
+    *pops = 3;
+    return true;
+
+  case op_call:
+    *pops = ((const struct op_call *) instr)->num_args + 1u;
+    *pushes = 1;
+    return true;
+
+  case op_call_p:
+  case op_call_v:
+    *pops = ((const struct op_call_internal *) instr)->num_args;
+    *pushes = 1;
+    return true;
+
+  case op_br_t:
+  case op_br_f:
+  case op_br:
+  case op_jmp:
+  case op_ret_g:
+  case op_ret_f:
+  case op_ret_b:
+  case op_ret_u:
+  case op_ret_n:
+  case op_call_t:
+  case op_call_t_p:
+  case op_call_t_v:
+    return false;
+
+  case op_ldc_i:
+  case op_lgc_i:
+  case op_ldc_f32:
+  case op_lgc_f32:
+  case op_ldc_f64:
+  case op_lgc_f64:
+  case op_ldc_b_0:
+  case op_ldc_b_1:
+  case op_lgc_b_0:
+  case op_lgc_b_1:
+  case op_lgc_u:
+  case op_lgc_n:
+  case op_lgc_s:
+  case op_new_c:
+  case op_new_a:
+  case op_new_c_p:
+  case op_new_c_v:
+  case op_ldl_g:
+  case op_ldl_f:
+  case op_ldl_b:
+  case op_ldl_n:
+  case op_ldl_bw:
+  case op_ldl_mv:
+  case op_ldp_g:
+  case op_ldp_f:
+  case op_ldp_b:
+  case op_ldp_n:
+  case op_ldp_bw:
+  case op_ldp_mv:
+  case op_dup:
+  case op_dup_bw:
+    *pushes = 1;
+    return true;
+
+  default:
+    // the remaining instructions are binary operators
+    *pops = 2;
+    *pushes = 1;
+    return true;
+  }
+}
+
+static bool is_env_store(opcode_t op) {
+  switch (op) {
+  case op_stl_g:
+  case op_stl_b:
+  case op_stl_f:
+  case op_stl_n:
+  case op_stp_g:
+  case op_stp_b:
+  case op_stp_f:
+  case op_stp_n:
+    return true;
+  default:
+    return false;
+  }
+}
+
+/**
+ * Returns whether the instruction may store to, or pop, an environment.
+ */
+static bool may_store_env(opcode_t op) {
+  return is_env_store(op) || op == op_newenv || op == op_popenv ||
+    op == op_call || op == op_call_p || op == op_call_v;
+}
+
+/**
+ * Returns the generic instruction for a borrowing instruction.
+ */
+static opcode_t unborrowed_opcode(opcode_t op) {
+  switch (op) {
+  case op_ldl_bw:
+    return op_ldl_g;
+  case op_ldp_bw:
+    return op_ldp_g;
+  case op_dup_bw:
+    return op_dup;
+  case op_lda_bw:
+    return op_lda_g;
+  case op_sta_bw:
+    return op_sta_g;
+  case op_pop_bw:
+    return op_pop_g;
+  default:
+    return op;
+  }
+}
+
+/**
+ * Finds loads whose value is consumed within the basic block while another
+ * reference keeps it alive, and rewrites them and the instruction that
+ * consumes the value to not count the reference.
+ *
+ * A value loaded from an environment is kept alive by the environment entry,
+ * as long as nothing can store to an environment (or pop one) before the
+ * value is consumed, so only an op_lda or op_sta that consumes it as its array
+ * operand may borrow it. A value copied with op_dup is kept alive by the
+ * original entry below it, which cannot be popped first; it may be borrowed
+ * by an op_lda or op_sta in the same way, or by an op_pop that drops it, or by
+ * an op_pop right after a store of it (which drops the original instead).
+ */
+static void borrow_block(function_t *f, unsigned int leader) {
+  const address_t start = f->leaders.items[leader];
+  const address_t end = leader + 1 < f->leaders.count ? f->leaders.items[leader + 1] : f->program_size;
+  unsigned int pops, pushes;
+
+  // undo any earlier borrowing; it is redone below
+  for (address_t pc = start; pc < end; pc += siinstr_size(f->program[pc])) {
+    f->program[pc] = unborrowed_opcode(f->program[pc]);
+    if (!stack_effect(f->program + pc, &pops, &pushes)) {
+      break;
+    }
+  }
+
+  for (address_t pc = start; pc < end; pc += siinstr_size(f->program[pc])) {
+    const opcode_t op = f->program[pc];
+    if (!stack_effect(f->program + pc, &pops, &pushes)) {
+      break;
+    }
+
+    const bool is_load = op == op_ldl_g || op == op_ldl_f || op == op_ldl_b ||
+      op == op_ldp_g || op == op_ldp_f || op == op_ldp_b;
+    if (!is_load && op != op_dup) {
+      continue;
+    }
+
+    address_t cpc = pc + siinstr_size(op);
+    if (op == op_dup && cpc < end) {
+      const opcode_t store_op = f->program[cpc];
+      const address_t pop_pc = cpc + siinstr_size(store_op);
+      const opcode_t pop_op = pop_pc < end ? f->program[pop_pc] : op_nop;
+      if (is_env_store(store_op) &&
+          (pop_op == op_pop_g || pop_op == op_pop_b || pop_op == op_pop_f)) {
+        f->program[pc] = op_dup_bw;
+        f->program[pop_pc] = op_pop_bw;
+        continue;
+      }
+    }
+
+    // the number of entries above the loaded value
+    unsigned int depth = 0;
+    for (; cpc < end; cpc += siinstr_size(f->program[cpc])) {
+      const opcode_t *consumer = f->program + cpc;
+      if (!stack_effect(consumer, &pops, &pushes)) {
+        break;
+      }
+      if (is_load && may_store_env(*consumer)) {
+        break;
+      }
+      if (pops <= depth) {
+        depth = depth - pops + pushes;
+        continue;
+      }
+
+      // this instruction consumes the loaded value
+      if ((depth == 1 && (*consumer == op_lda_g || *consumer == op_lda_b || *consumer == op_lda_f)) ||
+          (depth == 2 && (*consumer == op_sta_g || *consumer == op_sta_b || *consumer == op_sta_f)) ||
+          (depth == 0 && !is_load && (*consumer == op_pop_g || *consumer == op_pop_b || *consumer == op_pop_f))) {
+        f->program[pc] = op == op_dup ? op_dup_bw : op == op_ldl_g || op == op_ldl_f || op == op_ldl_b ? op_ldl_bw : op_ldp_bw;
+        f->program[cpc] = *consumer == op_pop_g || *consumer == op_pop_b || *consumer == op_pop_f ? op_pop_bw :
+          depth == 1 ? op_lda_bw : op_sta_bw;
+      }
+      break;
+    }
+  }
+}
+
+enum {
+  ACCESS_NONE,
+  ACCESS_LOAD,
+  ACCESS_STORE
+};
+
+/**
+ * Returns whether the instruction loads or stores an entry of the function's
+ * own environment, and sets *index to the entry if so. Tracks the environment
+ * depth (see state_t) in *depth.
+ */
+static int own_env_access(const function_t *f, const opcode_t *instr, uint8_t *depth, uint8_t *index) {
+  int access;
+  bool is_local;
+  switch (*instr) {
+  case op_newenv:
+    ++*depth;
+    return ACCESS_NONE;
+  case op_popenv:
+    --*depth;
+    return ACCESS_NONE;
+
+  case op_ldl_g:
+  case op_ldl_f:
+  case op_ldl_b:
+  case op_ldl_n:
+  case op_ldl_bw:
+  case op_ldl_mv:
+    access = ACCESS_LOAD;
+    is_local = true;
+    break;
+  case op_ldp_g:
+  case op_ldp_f:
+  case op_ldp_b:
+  case op_ldp_n:
+  case op_ldp_bw:
+  case op_ldp_mv:
+    access = ACCESS_LOAD;
+    is_local = false;
+    break;
+  case op_stl_g:
+  case op_stl_b:
+  case op_stl_f:
+  case op_stl_n:
+    access = ACCESS_STORE;
+    is_local = true;
+    break;
+  case op_stp_g:
+  case op_stp_b:
+  case op_stp_f:
+  case op_stp_n:
+    access = ACCESS_STORE;
+    is_local = false;
+    break;
+  default:
+    return ACCESS_NONE;
+  }
+
+  *index = ((const struct op_oneindex *) instr)->index;
+  const uint8_t envindex = is_local ? 0 : ((const struct op_twoindex *) instr)->envindex;
+  return *index < f->fn->env_size && envindex == *depth ? access : ACCESS_NONE;
+}
+
+static inline address_t block_end(const function_t *f, unsigned int leader) {
+  return leader + 1 < f->leaders.count ? f->leaders.items[leader + 1] : f->program_size;
+}
+
+static void add_live_in(function_t *f, const uint8_t *live_ins, address_t address, uint8_t *live) {
+  const int index = addrlist_find(&f->leaders, address);
+  if (index < 0) {
+    return;
+  }
+  for (unsigned int i = 0; i < 32; ++i) {
+    live[i] |= live_ins[(unsigned int) index * 32 + i];
+  }
+}
+
+/**
+ * Gets the environment entries that are live at the end of the block, i.e.
+ * those that are live at the start of any block that may follow it.
+ */
+static void block_live_out(function_t *f, unsigned int leader, const uint8_t *live_ins, uint8_t *live) {
+  const address_t end = block_end(f, leader);
+  memset(live, 0, 32);
+
+  address_t pc = f->leaders.items[leader];
+  while (pc < end) {
+    const opcode_t *instr = f->program + pc;
+    const address_t next = pc + siinstr_size(*instr);
+    switch (*instr) {
+    case op_br_t:
+    case op_br_f:
+      add_live_in(f, live_ins, next, live);
+      // fallthrough
+    case op_br:
+      add_live_in(f, live_ins, next + ((const struct op_offset *) instr)->offset, live);
+      return;
+    case op_jmp:
+      add_live_in(f, live_ins, ((const struct op_address *) instr)->address, live);
+      return;
+    case op_ret_g:
+    case op_ret_f:
+    case op_ret_b:
+    case op_ret_u:
+    case op_ret_n:
+    case op_call_t:
+    case op_call_t_p:
+    case op_call_t_v:
+      return;
+    default:
+      pc = next;
+      break;
+    }
+  }
+  add_live_in(f, live_ins, pc, live);
+}
+
+/**
+ * Recomputes the environment entries that are live at the start of the block,
+ * i.e. that may be loaded before they are stored to. Returns whether they
+ * changed.
+ */
+static bool update_live_in(function_t *f, unsigned int leader, uint8_t *live_ins) {
+  uint8_t live_out[32], gen[32] = { 0 }, kill[32] = { 0 };
+  block_live_out(f, leader, live_ins, live_out);
+
+  const address_t end = block_end(f, leader);
+  uint8_t depth = get_state(f, leader)->env_depth;
+  unsigned int pops, pushes;
+  for (address_t pc = f->leaders.items[leader]; pc < end; pc += siinstr_size(f->program[pc])) {
+    uint8_t index = 0;
+    const int access = own_env_access(f, f->program + pc, &depth, &index);
+    const uint8_t bit = 1u << (index % 8);
+    if (access == ACCESS_LOAD && !(kill[index / 8] & bit)) {
+      gen[index / 8] |= bit;
+    } else if (access == ACCESS_STORE) {
+      kill[index / 8] |= bit;
+    }
+    if (!stack_effect(f->program + pc, &pops, &pushes)) {
+      break;
+    }
+  }
+
+  bool changed = false;
+  uint8_t *const live_in = live_ins + leader * 32;
+  for (unsigned int i = 0; i < 32; ++i) {
+    const uint8_t v = gen[i] | (live_out[i] & ~kill[i]);
+    if (v != live_in[i]) {
+      live_in[i] = v;
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+/**
+ * Returns whether the environment entry may be loaded after the instruction at
+ * pc, before it is stored to.
+ */
+static bool is_live_after(function_t *f, unsigned int leader, address_t pc, uint8_t depth, uint8_t index,
+  const uint8_t *live_out) {
+  const address_t end = block_end(f, leader);
+  unsigned int pops, pushes;
+  for (pc += siinstr_size(f->program[pc]); pc < end; pc += siinstr_size(f->program[pc])) {
+    uint8_t cindex = 0;
+    const int access = own_env_access(f, f->program + pc, &depth, &cindex);
+    if (access != ACCESS_NONE && cindex == index) {
+      return access == ACCESS_LOAD;
+    }
+    if (!stack_effect(f->program + pc, &pops, &pushes)) {
+      break;
+    }
+  }
+  return live_out[index / 8] & (1u << (index % 8));
+}
+
+/**
+ * Rewrites the last load of each entry of the function's own environment
+ * before it is stored to (or the function returns) to op_ldl_mv or op_ldp_mv,
+ * which move the value out of the environment. The environment then no longer
+ * keeps the value alive, e.g. while the function goes on to build another
+ * large structure.
+ *
+ * Entries that other functions load or store to are left alone, as are
+ * numbers, which need not be freed. So is the entry point's environment, as
+ * it holds the program's globals, which sinter_call, sinter_get_global and
+ * later chunks read after the entry point returns.
+ */
+static void move_last_loads(function_t *f) {
+  uint8_t captured[32];
+  for (unsigned int i = 0; i < 32; ++i) {
+    captured[i] = functions[f->fn_index].captured[i] | captured_any[i];
+  }
+
+  uint8_t *live_ins = scratch_alloc(f->leaders.count * 32);
+  if (live_ins) {
+    memset(live_ins, 0, f->leaders.count * 32);
+    bool changed = true;
+    while (changed) {
+      changed = false;
+      for (unsigned int i = f->leaders.count; i-- > 0;) {
+        if (get_state(f, i)->visited && update_live_in(f, i, live_ins)) {
+          changed = true;
+        }
+      }
+    }
+  }
+
+  for (unsigned int i = 0; i < f->leaders.count; ++i) {
+    if (!get_state(f, i)->visited) {
+      continue;
+    }
+
+    uint8_t live_out[32] = { 0 };
+    if (live_ins) {
+      block_live_out(f, i, live_ins, live_out);
+    }
+    const address_t end = block_end(f, i);
+    uint8_t depth = get_state(f, i)->env_depth;
+    unsigned int pops, pushes;
+    for (address_t pc = f->leaders.items[i]; pc < end; pc += siinstr_size(f->program[pc])) {
+      const opcode_t op = f->program[pc];
+      const uint8_t load_depth = depth;
+      uint8_t index = 0;
+      const bool is_load = own_env_access(f, f->program + pc, &depth, &index) == ACCESS_LOAD &&
+        op != op_ldl_n && op != op_ldp_n;
+      if (is_load) {
+        const bool is_ldl = op == op_ldl_g || op == op_ldl_f || op == op_ldl_b ||
+          op == op_ldl_bw || op == op_ldl_mv;
+        const uint8_t bit = 1u << (index % 8);
+        const bool move = live_ins && !(captured[index / 8] & bit) &&
+          !is_live_after(f, i, pc, load_depth, index, live_out);
+        if (move) {
+          f->program[pc] = is_ldl ? op_ldl_mv : op_ldp_mv;
+        } else if (op == op_ldl_mv || op == op_ldp_mv) {
+          f->program[pc] = is_ldl ? op_ldl_g : op_ldp_g;
+        }
+      }
+      if (!stack_effect(f->program + pc, &pops, &pushes)) {
+        break;
+      }
+    }
+  }
+
+  scratch_free(live_ins);
+}
+
+/**
+ * Finds the basic blocks of the function at the given index. The function must
+ * be freed with free_function even if this fails.
+ */
+static bool init_leaders(function_t *f, unsigned char *program, address_t program_size, unsigned int fn_index) {
+  *f = (function_t) {
+    .program = program,
+    .program_size = program_size,
+    .fn_index = fn_index
+  };
+
+  const address_t fn_address = functions[fn_index].address;
+  if (program_size < sizeof(svm_function_t) || fn_address > program_size - sizeof(svm_function_t)) {
+    return false;
+  }
+
+  f->fn = (const svm_function_t *) (program + fn_address);
+  return find_leaders(f);
+}
+
+/**
+ * Finds the basic blocks of the function at the given index, and the abstract
+ * state at the start of each. The function must be freed with free_function
+ * even if this fails.
+ */
+static bool init_function(function_t *f, unsigned char *program, address_t program_size, unsigned int fn_index) {
+  if (!init_leaders(f, program, program_size, fn_index)) {
+    return false;
+  }
+
+  f->state_size = sizeof(state_t) + f->fn->stack_size + f->fn->env_size;
+  f->state = scratch_alloc(f->state_size);
+  if (!f->state) {
+    return false;
+  }
+  f->states = scratch_alloc(f->leaders.count * f->state_size);
+  if (!f->states) {
+    return false;
+  }
+
+  memset(f->states, 0, f->leaders.count * f->state_size);
+  // all entries start off unknown (including the arguments)
+  memset(f->state, 0, f->state_size);
+  f->state->visited = true;
+  bool ok = merge(f, f->state, (address_t) (&f->fn->code - program));
+
+  // find the fixed point
+  while (ok && f->changed) {
+    f->changed = false;
+    for (unsigned int i = 0; ok && i < f->leaders.count; ++i) {
+      if (get_state(f, i)->visited) {
+        memcpy(f->state, get_state(f, i), f->state_size);
+        ok = run_block(f, i, f->state, false, false);
+      }
+    }
+  }
+  return ok;
+}
+
+static void free_function(function_t *f) {
+  scratch_free(f->states);
+  addrlist_free(&f->leaders);
+  scratch_free(f->state);
+}
+
+/**
+ * Analyses the function at the given index, and rewrites its instructions if
+ * rewrite is set.
+ */
+static bool analyse_function(unsigned char *program, address_t program_size, unsigned int fn_index, bool rewrite) {
+  function_t f;
+  bool ok = init_function(&f, program, program_size, fn_index);
+
+  for (unsigned int i = 0; ok && i < f.leaders.count; ++i) {
+    if (get_state(&f, i)->visited) {
+      memcpy(f.state, get_state(&f, i), f.state_size);
+      ok = run_block(&f, i, f.state, rewrite, !rewrite);
+    }
+  }
+
+  if (ok && rewrite) {
+    // the entry point is the first function
+    if (fn_index) {
+      move_last_loads(&f);
+    }
+    for (unsigned int i = 0; i < f.leaders.count; ++i) {
+      if (get_state(&f, i)->visited) {
+        borrow_block(&f, i);
+      }
+    }
+  }
+
+  free_function(&f);
+  return ok;
+}
+
+/**
+ * Finds all the functions in the program, and the environment entries that
+ * functions other than their owner load or store to.
+ */
+static bool discover_functions(unsigned char *program, address_t program_size) {
+  functions = NULL;
+  function_count = 0;
+  function_capacity = 0;
+
+  // this is redone if it turns out that the environment of a function already
+  // analysed was traced wrongly
+  bool ok = add_function(((const svm_header_t *) program)->entry, NO_FUNCTION, 0);
+  do {
+    parent_changed = false;
+    memset(tainted, 0, sizeof(tainted));
+    memset(captured_any, 0, sizeof(captured_any));
+    memset(stored_any, 0, sizeof(stored_any));
+    for (unsigned int i = 0; i < function_count; ++i) {
+      memset(functions[i].captured, 0, sizeof(functions[i].captured));
+      memset(functions[i].stored, 0, sizeof(functions[i].stored));
+    }
+    for (unsigned int i = 0; ok && i < function_count; ++i) {
+      ok = analyse_function(program, program_size, i, false);
+    }
+  } while (ok && parent_changed);
+
+  return ok;
+}
+
+void sispecialise_program(unsigned char *program, size_t program_size) {
+  if (program_size < sizeof(svm_header_t) || program_size > UINT32_MAX) {
+    return;
+  }
+
+  scratch_used = 0;
+  if (discover_functions(program, (address_t) program_size)) {
+    for (unsigned int i = 0; i < function_count; ++i) {
+      if (!analyse_function(program, (address_t) program_size, i, true)) {
+        SIDEBUG("Could not specialise function at address 0x%x\n", functions[i].address);
+      }
+    }
+  } else {
+    SIDEBUG("Could not analyse program; not specialising it\n");
+  }
+
+  scratch_free(functions);
+}
+
+#ifdef SINTER_INLINE_CALLS
+
+/*
+ * Inlining of calls to small functions (siinline_program).
+ *
+ * A call is inlined if it calls a function loaded from an entry of the
+ * program's environment that the entry point stores the function to, and
+ * nothing stores to again, and the function is defined at the top level of
+ * the program, creates no closures or block environments, and has at most
+ * SINTER_INLINE_MAX_SIZE bytes of code.
+ *
+ * SVML has no way to insert instructions in place, so the program is
+ * rewritten into the same buffer, relocating every function, and may grow up
+ * to the size of the buffer.
+ *
+ * The inlined body runs without allocating: the caller's environment is
+ * extended with entries that the body uses in place of its own environment
+ * (these are shared by all the calls inlined into the caller, which cannot
+ * overlap), the arguments are stored to them, and the body's returns become
+ * branches to the end of the body.
+ */
+
+typedef struct {
+  // the caller and the callee, as indices into functions
+  unsigned int caller;
+  unsigned int callee;
+  // the instruction that loads the callee, and the op_call
+  address_t load;
+  address_t call;
+  // the environment depth at the call (see state_t)
+  uint8_t depth;
+  // the envindex of the program's environment at the call
+  uint8_t program_envindex;
+  // the first of the entries of the caller's environment the callee's
+  // environment is moved to
+  uint8_t base;
+} site_t;
+
+static SINTER_THREAD_LOCAL site_t *sites;
+static SINTER_THREAD_LOCAL unsigned int site_count;
+static SINTER_THREAD_LOCAL unsigned int site_capacity;
+
+typedef struct {
+  // the buffer to write to, or NULL to only compute addresses
+  unsigned char *out;
+  address_t pos;
+} writer_t;
+
+static void emit(writer_t *w, const void *data, size_t size) {
+  if (w->out) {
+    memcpy(w->out + w->pos, data, size);
+  }
+  w->pos += (address_t) size;
+}
+
+static bool add_site(const site_t *site) {
+  if (site_count == site_capacity) {
+    const unsigned int new_capacity = site_capacity ? site_capacity * 2 : 8;
+    site_t *new_sites = scratch_alloc(new_capacity * sizeof(site_t));
+    if (!new_sites) {
+      return false;
+    }
+    if (site_count) {
+      memcpy(new_sites, sites, site_count * sizeof(site_t));
+    }
+    scratch_free(sites);
+    sites = new_sites;
+    site_capacity = new_capacity;
+  }
+
+  sites[site_count++] = *site;
+  return true;
+}
+
+/**
+ * Returns the site in the function whose load or op_call is at pc, or NULL.
+ */
+static const site_t *find_site(unsigned int fn_index, address_t pc, bool call) {
+  for (unsigned int i = 0; i < site_count; ++i) {
+    if (sites[i].caller == fn_index && (call ? sites[i].call : sites[i].load) == pc) {
+      return sites + i;
+    }
+  }
+  return NULL;
+}
+
+/**
+ * Returns the envindex of the program's environment from the environment at
+ * the given depth in the function, or -1 if it is not known.
+ */
+static int program_envindex(unsigned int fn_index, uint8_t depth) {
+  unsigned int levels = depth;
+  const fninfo_t *fn = functions + fn_index;
+  // the entry point is the first function
+  while (fn != functions) {
+    if (fn->parent == NO_FUNCTION) {
+      return -1;
+    }
+    levels += fn->parent_depth + 1u;
+    fn = functions + fn->parent;
+  }
+  return levels <= UINT8_MAX ? (int) levels : -1;
+}
+
+/**
+ * Finds the functions that the entry point stores to an entry of the program's
+ * environment that nothing stores to again.
+ *
+ * The store must also come before the first call in the entry point's first
+ * basic block. No other function can run before that call, and the entry
+ * point cannot get past it without running the store, so every call that is
+ * inlined runs after it, as dropping the load of the function would otherwise
+ * lose the uninitialised load fault.
+ */
+static bool find_global_functions(unsigned char *program, address_t program_size) {
+  function_t f;
+  bool ok = init_function(&f, program, program_size, 0);
+  // the number of stores to each entry, up to 2
+  uint8_t *stores = ok ? scratch_alloc(f.fn->env_size + 1u) : NULL;
+  ok = ok && stores;
+
+  if (ok) {
+    memset(stores, 0, f.fn->env_size + 1u);
+    for (unsigned int pass = 0; pass < 2; ++pass) {
+      for (unsigned int i = 0; i < f.leaders.count; ++i) {
+        if (!get_state(&f, i)->visited) {
+          continue;
+        }
+
+        const address_t end = block_end(&f, i);
+        uint8_t depth = get_state(&f, i)->env_depth;
+        address_t prev = 0;
+        // whether no call has been made yet
+        bool before_calls = f.leaders.items[i] == (address_t) (&f.fn->code - program);
+        unsigned int pops, pushes;
+        for (address_t pc = f.leaders.items[i]; pc < end; prev = pc, pc += siinstr_size(program[pc])) {
+          uint8_t index = 0;
+          if (program[pc] >= op_call && program[pc] <= op_call_t_v) {
+            before_calls = false;
+          } else if (own_env_access(&f, program + pc, &depth, &index) != ACCESS_STORE) {
+            // fallthrough to the end of the loop
+          } else if (!pass) {
+            stores[index] += stores[index] < 2;
+          } else if (stores[index] == 1 && before_calls && prev && program[prev] == op_new_c &&
+              !((functions[0].stored[index / 8] | stored_any[index / 8]) & (1u << (index % 8)))) {
+            const address_t address = ((const struct op_address *) (program + prev))->address;
+            for (unsigned int j = 1; j < function_count; ++j) {
+              if (functions[j].address == address) {
+                functions[j].has_global_slot = true;
+                functions[j].global_slot = index;
+              }
+            }
+          }
+          if (!stack_effect(program + pc, &pops, &pushes)) {
+            break;
+          }
+        }
+      }
+    }
+  }
+
+  scratch_free(stores);
+  free_function(&f);
+  return ok;
+}
+
+/**
+ * Decides whether calls to the function may be inlined.
+ */
+static void check_callee(unsigned char *program, address_t program_size, unsigned int fn_index) {
+  fninfo_t *const info = functions + fn_index;
+  info->inlinable = false;
+  if (!fn_index || !info->has_global_slot || info->parent || info->parent_depth) {
+    return;
+  }
+
+  function_t f;
+  bool ok = init_function(&f, program, program_size, fn_index);
+  address_t size = 0;
+  for (unsigned int i = 0; ok && i < f.leaders.count; ++i) {
+    if (!get_state(&f, i)->visited) {
+      ok = false;
+      break;
+    }
+
+    const address_t end = block_end(&f, i);
+    unsigned int height = get_state(&f, i)->stack_height;
+    unsigned int pops, pushes;
+    for (address_t pc = f.leaders.items[i]; ok && pc < end; pc += siinstr_size(program[pc])) {
+      const opcode_t *instr = program + pc;
+      size += siinstr_size(*instr);
+      switch (*instr) {
+      case op_new_c:
+      case op_newenv:
+      case op_popenv:
+        ok = false;
+        break;
+      case op_ldp_g:
+      case op_ldp_f:
+      case op_ldp_b:
+      case op_stp_g:
+      case op_stp_b:
+      case op_stp_f: {
+        const struct op_twoindex *ti = (const struct op_twoindex *) instr;
+        // only the function's own environment and the program's can be
+        // accessed; loading itself means the function is recursive
+        ok = ti->envindex == 0 || (ti->envindex == 1 &&
+          !(ti->index == info->global_slot && (*instr == op_ldp_g || *instr == op_ldp_f || *instr == op_ldp_b)));
+        break;
+      }
+      case op_ret_g:
+      case op_ret_f:
+      case op_ret_b:
+        ok = height == 1;
+        break;
+      case op_ret_u:
+      case op_ret_n:
+        ok = height == 0;
+        break;
+      case op_call_t:
+        ok = height == ((const struct op_call *) instr)->num_args + 1u;
+        break;
+      case op_call_t_p:
+      case op_call_t_v:
+        ok = height == ((const struct op_call_internal *) instr)->num_args;
+        break;
+      default:
+        // leave the program alone if it has already been specialised
+        ok = *instr <= op_neq_b;
+        break;
+      }
+
+      if (!stack_effect(instr, &pops, &pushes)) {
+        break;
+      }
+      height = height - pops + pushes;
+    }
+  }
+
+  info->inlinable = ok && size <= SINTER_INLINE_MAX_SIZE;
+  free_function(&f);
+}
+
+// the op_ldp and op_stp opcodes are the op_ldl and op_stl ones shifted by 6
+#define PARENT_OPCODE(op) ((opcode_t) ((op) + (op_ldp_g - op_ldl_g)))
+_Static_assert(op_ldp_f - op_ldl_f == op_ldp_g - op_ldl_g && op_ldp_b - op_ldl_b == op_ldp_g - op_ldl_g &&
+  op_stp_g - op_stl_g == op_ldp_g - op_ldl_g && op_stp_b - op_stl_b == op_ldp_g - op_ldl_g &&
+  op_stp_f - op_stl_f == op_ldp_g - op_ldl_g, "op_ldp/op_stp do not follow op_ldl/op_stl");
+
+/**
+ * Emits an op_ldl or op_stl of the entry of the caller's environment, from the
+ * environment at the given depth.
+ */
+static void emit_local(writer_t *w, opcode_t op, uint8_t index, uint8_t depth) {
+  if (depth) {
+    const struct op_twoindex instr = { .opcode = PARENT_OPCODE(op), .index = index, .envindex = depth };
+    emit(w, &instr, sizeof(instr));
+  } else {
+    const struct op_oneindex instr = { .opcode = op, .index = index };
+    emit(w, &instr, sizeof(instr));
+  }
+}
+
+static void emit_branch(writer_t *w, opcode_t op, const struct op_offset *original, address_t target) {
+  struct op_offset instr = *original;
+  instr.opcode = op;
+  instr.offset = (offset_t) (target - (w->pos + sizeof(instr)));
+  emit(w, &instr, sizeof(instr));
+}
+
+/**
+ * Emits the body of the callee of the site, with its environment moved to the
+ * caller's, and with its returns branching to end.
+ */
+static void emit_body(writer_t *w, const function_t *f, const site_t *site, address_t *leader_new, address_t end) {
+  for (unsigned int i = 0; i < f->leaders.count; ++i) {
+    leader_new[i] = w->pos;
+    const address_t block_end_pc = block_end(f, i);
+    unsigned int pops, pushes;
+    for (address_t pc = f->leaders.items[i]; pc < block_end_pc; pc += siinstr_size(f->program[pc])) {
+      const opcode_t *instr = f->program + pc;
+      const unsigned int size = siinstr_size(*instr);
+      bool returns = false;
+      switch (*instr) {
+      case op_ldl_g:
+      case op_ldl_f:
+      case op_ldl_b:
+      case op_stl_g:
+      case op_stl_b:
+      case op_stl_f:
+        emit_local(w, *instr, (uint8_t) (site->base + ((const struct op_oneindex *) instr)->index), site->depth);
+        break;
+      case op_ldp_g:
+      case op_ldp_f:
+      case op_ldp_b:
+      case op_stp_g:
+      case op_stp_b:
+      case op_stp_f: {
+        struct op_twoindex ti = *(const struct op_twoindex *) instr;
+        if (ti.envindex) {
+          ti.envindex = site->program_envindex;
+          emit(w, &ti, sizeof(ti));
+        } else {
+          emit_local(w, (opcode_t) (*instr - (op_ldp_g - op_ldl_g)), (uint8_t) (site->base + ti.index), site->depth);
+        }
+        break;
+      }
+      case op_br_t:
+      case op_br_f:
+      case op_br: {
+        const struct op_offset *br = (const struct op_offset *) instr;
+        const int target = addrlist_find(&f->leaders, pc + size + br->offset);
+        emit_branch(w, *instr, br, target < 0 ? 0 : leader_new[target]);
+        break;
+      }
+      case op_jmp: {
+        struct op_address jmp = *(const struct op_address *) instr;
+        const int target = addrlist_find(&f->leaders, jmp.address);
+        jmp.address = target < 0 ? 0 : leader_new[target];
+        emit(w, &jmp, sizeof(jmp));
+        break;
+      }
+      case op_ret_u:
+      case op_ret_n: {
+        const opcode_t op = *instr == op_ret_u ? op_lgc_u : op_lgc_n;
+        emit(w, &op, sizeof(op));
+        returns = true;
+        break;
+      }
+      case op_ret_g:
+      case op_ret_f:
+      case op_ret_b:
+        returns = true;
+        break;
+      case op_call_t: {
+        struct op_call call = *(const struct op_call *) instr;
+        call.opcode = op_call;
+        emit(w, &call, sizeof(call));
+        returns = true;
+        break;
+      }
+      case op_call_t_p:
+      case op_call_t_v: {
+        struct op_call_internal call = *(const struct op_call_internal *) instr;
+        call.opcode = *instr == op_call_t_p ? op_call_p : op_call_v;
+        emit(w, &call, sizeof(call));
+        returns = true;
+        break;
+      }
+      default:
+        emit(w, instr, size);
+        break;
+      }
+
+      if (returns) {
+        // the last block falls through to the end
+        if (i + 1 < f->leaders.count) {
+          const struct op_offset br = { .opcode = op_br };
+          emit_branch(w, op_br, &br, end);
+        }
+        break;
+      }
+      if (!stack_effect(instr, &pops, &pushes)) {
+        break;
+      }
+    }
+  }
+}
+
+/**
+ * Emits the inlined call at the site, in place of its op_call.
+ */
+static bool emit_inline(writer_t *w, const site_t *site, unsigned char *program, address_t program_size) {
+  function_t f;
+  bool ok = init_leaders(&f, program, program_size, site->callee);
+  address_t *leader_new = ok ? scratch_alloc(f.leaders.count * sizeof(address_t)) : NULL;
+  ok = ok && leader_new;
+
+  if (ok) {
+    memset(leader_new, 0, f.leaders.count * sizeof(address_t));
+    // store the arguments
+    for (unsigned int i = f.fn->num_args; i-- > 0;) {
+      emit_local(w, op_stl_g, (uint8_t) (site->base + i), site->depth);
+    }
+
+    writer_t layout = { .out = NULL, .pos = w->pos };
+    emit_body(&layout, &f, site, leader_new, 0);
+    emit_body(w, &f, site, leader_new, layout.pos);
+  }
+
+  scratch_free(leader_new);
+  free_function(&f);
+  return ok;
+}
+
+/**
+ * Finds the calls in the function that can be inlined, as long as the program
+ * stays within capacity.
+ */
+static bool find_sites(unsigned char *program, address_t program_size, unsigned int fn_index,
+  address_t *size, address_t capacity) {
+  fninfo_t *const info = functions + fn_index;
+  const int envindex = program_envindex(fn_index, 0);
+  if (envindex < 0) {
+    return true;
+  }
+
+  function_t f;
+  bool ok = init_function(&f, program, program_size, fn_index);
+  // the instruction that pushed each stack entry, or 0 if not known
+  address_t *producers = ok ? scratch_alloc((f.fn->stack_size + 1u) * sizeof(address_t)) : NULL;
+  ok = ok && producers;
+
+  for (unsigned int i = 0; ok && i < f.leaders.count; ++i) {
+    if (!get_state(&f, i)->visited) {
+      continue;
+    }
+
+    const address_t end = block_end(&f, i);
+    unsigned int height = get_state(&f, i)->stack_height;
+    uint8_t depth = get_state(&f, i)->env_depth;
+    memset(producers, 0, height * sizeof(address_t));
+    unsigned int pops, pushes;
+    for (address_t pc = f.leaders.items[i]; ok && pc < end; pc += siinstr_size(program[pc])) {
+      const opcode_t *instr = program + pc;
+      if (*instr == op_newenv) {
+        ++depth;
+      } else if (*instr == op_popenv) {
+        --depth;
+      } else if (*instr == op_dup && height) {
+        // the entry is used twice, so its load cannot be removed
+        producers[height - 1] = 0;
+      } else if (*instr == op_call && height > ((const struct op_call *) instr)->num_args) {
+        const unsigned int num_args = ((const struct op_call *) instr)->num_args;
+        const address_t load = producers[height - num_args - 1];
+        const opcode_t *load_instr = program + load;
+        // whether the function is loaded from the program's environment
+        const bool is_global_load = load && envindex + depth <= UINT8_MAX &&
+          (((*load_instr == op_ldl_g || *load_instr == op_ldl_f || *load_instr == op_ldl_b) && envindex + depth == 0) ||
+          ((*load_instr == op_ldp_g || *load_instr == op_ldp_f || *load_instr == op_ldp_b) &&
+            ((const struct op_twoindex *) load_instr)->envindex == envindex + depth));
+
+        for (unsigned int callee = 1; is_global_load && callee < function_count; ++callee) {
+          const fninfo_t *callee_info = functions + callee;
+          const svm_function_t *callee_fn = (const svm_function_t *) (program + callee_info->address);
+          if (callee == fn_index || !callee_info->inlinable || callee_info->global_slot != ((const struct op_oneindex *) load_instr)->index ||
+              callee_fn->num_args != num_args) {
+            continue;
+          }
+
+          const site_t site = {
+            .caller = fn_index,
+            .callee = callee,
+            .load = load,
+            .call = pc,
+            .depth = depth,
+            .program_envindex = (uint8_t) (envindex + depth),
+            .base = f.fn->env_size
+          };
+          writer_t layout = { .out = NULL, .pos = 0 };
+          ok = emit_inline(&layout, &site, program, program_size);
+          const address_t new_size = *size + layout.pos - siinstr_size(*load_instr) - (address_t) sizeof(struct op_call);
+          const unsigned int stack_size = f.fn->stack_size - num_args - 1u + callee_fn->stack_size;
+          const unsigned int env_size = f.fn->env_size + callee_fn->env_size;
+          if (ok && new_size <= capacity && stack_size <= UINT8_MAX && env_size <= UINT8_MAX) {
+            ok = add_site(&site);
+            *size = new_size;
+            if (stack_size > info->new_stack_size) {
+              info->new_stack_size = (uint8_t) stack_size;
+            }
+            if (env_size > info->new_env_size) {
+              info->new_env_size = (uint8_t) env_size;
+            }
+          }
+          break;
+        }
+      }
+
+      if (!stack_effect(instr, &pops, &pushes)) {
+        break;
+      }
+      if (pops > height || height - pops + pushes > f.fn->stack_size) {
+        ok = false;
+        break;
+      }
+      height -= pops;
+      for (unsigned int j = 0; j < pushes; ++j) {
+        producers[height++] = *instr == op_dup ? 0 : pc;
+      }
+    }
+  }
+
+  scratch_free(producers);
+  free_function(&f);
+  return ok;
+}
+
+/**
+ * Emits the function, with the calls at its sites inlined.
+ */
+static bool emit_function(writer_t *w, unsigned char *program, address_t program_size, unsigned int fn_index) {
+  function_t f;
+  bool ok = init_leaders(&f, program, program_size, fn_index);
+  address_t *leader_new = ok ? scratch_alloc(f.leaders.count * sizeof(address_t)) : NULL;
+  ok = ok && leader_new;
+
+  if (ok) {
+    memset(leader_new, 0, f.leaders.count * sizeof(address_t));
+    // functions are aligned to 4 bytes, as in the original program
+    static const opcode_t padding[3] = { op_nop, op_nop, op_nop };
+    emit(w, padding, (4 - w->pos % 4) % 4);
+
+    fninfo_t *const info = functions + fn_index;
+    info->new_address = w->pos;
+    const svm_function_t header = {
+      .stack_size = info->new_stack_size,
+      .env_size = info->new_env_size,
+      .num_args = f.fn->num_args
+    };
+    emit(w, &header, offsetof(svm_function_t, code));
+  }
+
+  // the first pass finds the new addresses of the basic blocks
+  const writer_t start = *w;
+  for (unsigned int pass = 0; ok && pass < 2; ++pass) {
+    writer_t layout = { .out = NULL, .pos = start.pos };
+    writer_t *const cur = pass ? w : &layout;
+    for (unsigned int i = 0; ok && i < f.leaders.count; ++i) {
+      leader_new[i] = cur->pos;
+      const address_t end = block_end(&f, i);
+      unsigned int pops, pushes;
+      for (address_t pc = f.leaders.items[i]; ok && pc < end; pc += siinstr_size(program[pc])) {
+        const opcode_t *instr = program + pc;
+        const unsigned int size = siinstr_size(*instr);
+        const site_t *site;
+        if (find_site(fn_index, pc, false)) {
+          // the load of an inlined function is dropped
+        } else if ((site = find_site(fn_index, pc, true))) {
+          ok = emit_inline(cur, site, program, program_size);
+        } else if (*instr == op_br_t || *instr == op_br_f || *instr == op_br) {
+          const struct op_offset *br = (const struct op_offset *) instr;
+          const int target = addrlist_find(&f.leaders, pc + size + br->offset);
+          emit_branch(cur, *instr, br, target < 0 ? 0 : leader_new[target]);
+        } else if (*instr == op_jmp || *instr == op_new_c) {
+          struct op_address ia = *(const struct op_address *) instr;
+          if (*instr == op_jmp) {
+            const int target = addrlist_find(&f.leaders, ia.address);
+            ia.address = target < 0 ? 0 : leader_new[target];
+          } else {
+            for (unsigned int j = 0; j < function_count; ++j) {
+              if (functions[j].address == ia.address) {
+                ia.address = functions[j].new_address;
+                break;
+              }
+            }
+          }
+          emit(cur, &ia, sizeof(ia));
+        } else {
+          emit(cur, instr, size);
+        }
+
+        if (!stack_effect(instr, &pops, &pushes)) {
+          break;
+        }
+      }
+    }
+  }
+
+  scratch_free(leader_new);
+  free_function(&f);
+  return ok;
+}
+
+size_t siinline_program(unsigned char *program, size_t program_size, size_t buffer_size) {
+  if (program_size < sizeof(svm_header_t) || buffer_size < program_size || buffer_size > UINT32_MAX) {
+    return program_size;
+  }
+
+  scratch_used = 0;
+  sites = NULL;
+  site_count = 0;
+  site_capacity = 0;
+
+  // the program is analysed in a copy, and rewritten into the buffer
+  unsigned char *original = scratch_alloc(program_size);
+  if (!original) {
+    SIDEBUG("Not enough memory to inline calls\n");
+    return program_size;
+  }
+  memcpy(original, program, program_size);
+
+  const address_t size = (address_t) program_size;
+  address_t new_size = size;
+  bool ok = discover_functions(original, size);
+  for (unsigned int i = 0; ok && i < function_count; ++i) {
+    const svm_function_t *fn = (const svm_function_t *) (original + functions[i].address);
+    functions[i].has_global_slot = false;
+    functions[i].new_stack_size = fn->stack_size;
+    functions[i].new_env_size = fn->env_size;
+  }
+  ok = ok && find_global_functions(original, size);
+  for (unsigned int i = 0; ok && i < function_count; ++i) {
+    check_callee(original, size, i);
+  }
+  // leave room for the padding before each function, which may change
+  const size_t slack = 3 * (size_t) function_count;
+  for (unsigned int i = 0; ok && buffer_size > slack && i < function_count; ++i) {
+    ok = find_sites(original, size, i, &new_size, (address_t) (buffer_size - slack));
+  }
+
+  // the header and constants before the first function are kept as they are
+  address_t code_start = size;
+  for (unsigned int i = 0; ok && i < function_count; ++i) {
+    if (functions[i].address < code_start) {
+      code_start = functions[i].address;
+    }
+  }
+
+  if (ok && site_count) {
+    // the first pass finds the new addresses of the functions
+    writer_t layout = { .out = NULL, .pos = code_start };
+    for (unsigned int i = 0; ok && i < function_count; ++i) {
+      ok = emit_function(&layout, original, size, i);
+    }
+    ok = ok && layout.pos <= buffer_size;
+
+    if (ok) {
+      writer_t w = { .out = program, .pos = code_start };
+      for (unsigned int i = 0; ok && i < function_count; ++i) {
+        ok = emit_function(&w, original, size, i);
+      }
+      ((svm_header_t *) program)->entry = functions[0].new_address;
+      new_size = w.pos;
+      if (!ok) {
+        memcpy(program, original, program_size);
+      }
+    }
+  }
+
+  SIDEBUG("Inlined %u calls; program size %zu -> %zu\n", ok ? site_count : 0, program_size, ok && site_count ? (size_t) new_size : program_size);
+  scratch_free(sites);
+  scratch_free(functions);
+  scratch_free(original);
+  return ok && site_count ? new_size : program_size;
+}
+
+#endif
+
+#endif
@@ -17,15 +17,15 @@
 #include <sinter/debug.h>
 #include <sinter/program.h>
 
-struct sistate sistate;
+SINTER_THREAD_LOCAL struct sistate sistate;
 
-const sivmfnptr_t *sivmfn_vminternals = NULL;
-size_t sivmfn_vminternal_count = 0;
+SINTER_THREAD_LOCAL const sivmfn_t *sivmfn_vminternals = NULL;
+SINTER_THREAD_LOCAL size_t sivmfn_vminternal_count = 0;
 
-sinter_printfn_string sinter_printer_string = NULL;
-sinter_printfn_integer sinter_printer_integer = NULL;
-sinter_printfn_float sinter_printer_float = NULL;
-sinter_printfn_flush sinter_printer_flush = NULL;
+SINTER_THREAD_LOCAL sinter_printfn_string sinter_printer_string = NULL;
+SINTER_THREAD_LOCAL sinter_printfn_integer sinter_printer_integer = NULL;
+SINTER_THREAD_LOCAL sinter_printfn_float sinter_printer_float = NULL;
+SINTER_THREAD_LOCAL sinter_printfn_flush sinter_printer_flush = NULL;
 
 #if 0
 static inline void unimpl_instr() {
@@ -39,6 +39,11 @@ bool sivm_equal(sinanbox_t l, sinanbox_t r) {
     // if they are *identical* then they are equal provided they are not NaN
     return !NANBOX_IDENTICAL(l, NANBOX_CANONICAL_NAN);
   } else if (NANBOX_ISNUMERIC(l) && NANBOX_ISNUMERIC(r)) {
+#ifdef SINTER_FIXED_POINT
+    if (NANBOX_ISFIXEDNUM(l) && NANBOX_ISFIXEDNUM(r)) {
+      return NANBOX_TOFIXED(l) == NANBOX_TOFIXED(r);
+    }
+#endif
     switch (NANBOX_ISFLOAT(r) << 1 | NANBOX_ISFLOAT(l)) {
       case 0: /* neither are floats */
         return NANBOX_INT(l) == NANBOX_INT(r);
@@ -57,7 +62,7 @@ bool sivm_equal(sinanbox_t l, sinanbox_t r) {
     siheap_header_t *hv0 = SIHEAP_NANBOXTOPTR(l);
     siheap_header_t *hv1 = SIHEAP_NANBOXTOPTR(r);
     if (siheap_is_string(hv0) && siheap_is_string(hv1)) {
-      return strcmp(sistrobj_tocharptr(hv0), sistrobj_tocharptr(hv1)) == 0;
+      return sistrobj_equal(hv0, hv1);
     } else {
       // for arrays and functions, identical only if they are the SAME object
       return hv0 == hv1;
@@ -96,6 +101,88 @@ static inline void pop_array_args(siheap_array_t **array, address_t *index) {
   }
 }
 
+/**
+ * The code that a driven primitive's frame runs: each step that calls a
+ * function jumps to the op_call for its number of arguments, and the op_drive
+ * that follows continues the primitive with the result.
+ */
+static const opcode_t drive_code[] = {
+  op_call, 0, op_drive,
+  op_call, 1, op_drive,
+  op_call, 2, op_drive
+};
+#define DRIVE_CODE_STRIDE (sizeof(struct op_call) + 1)
+_Static_assert(sizeof(drive_code) == DRIVE_CODE_STRIDE * (SIVMFN_DRIVE_MAX_CALL_ARGC + 1), "drive_code does not match SIVMFN_DRIVE_MAX_CALL_ARGC");
+
+static const sivmfn_drive_t *drive_of(const sivmfnptr_t fn) {
+  for (size_t i = 0; i < sivmfn_drive_count; ++i) {
+    if (sivmfn_drives[i].fn == fn) {
+      return sivmfn_drives + i;
+    }
+  }
+  SIBUGM("Driven function is not in sivmfn_drives\n");
+  sifault(sinter_fault_internal_error);
+  return NULL;
+}
+
+/**
+ * Runs the next step of the driven primitive whose frame is installed: jumps
+ * to the function it calls, or returns from the frame.
+ */
+static void drive_step(void) {
+  const sivmfn_drive_t *drive = sivmfn_drives + NANBOX_INT(sistack_bottom[0]);
+  sinanbox_t *const state = sistack_bottom + 1;
+  sinanbox_t retv;
+  const int argc = drive->step(state, state[drive->state_size], &retv);
+  if (argc >= 0) {
+    sistate.pc = drive_code + argc * DRIVE_CODE_STRIDE;
+    return;
+  }
+
+  if (sistate.env) {
+    siheap_deref(sistate.env);
+  }
+  sistack_destroy(&sistate.pc, &sistate.env);
+  sistack_push(retv);
+}
+
+/**
+ * Creates the frame of a driven primitive, given its arguments (the first
+ * drive->argc of them, whose references it takes) and a frame allocated for
+ * it, and runs its first step.
+ *
+ * The frame holds the index of the primitive, its state, the last result, and
+ * room to call a function. The primitive runs in the caller's environment,
+ * which the frame also saves, and so takes a reference to.
+ */
+static void drive_start(const sivmfn_drive_t *drive, siheap_frame_t *frame, const sinanbox_t *args, const opcode_t *return_address) {
+  const unsigned int size = 1 + drive->state_size + 1 + 1 + SIVMFN_DRIVE_MAX_CALL_ARGC;
+  sistack_check_room(size);
+  sistack_new_frame(frame, size, return_address, sistate.env);
+  // there is none if e.g. sinter_call calls the primitive directly
+  if (sistate.env) {
+    siheap_ref(sistate.env);
+  }
+  sistack_push_force(NANBOX_WRAP_INT((int32_t) (drive - sivmfn_drives)));
+  for (unsigned int i = 0; i < drive->state_size; ++i) {
+    sistack_push_force(i < drive->argc ? args[i] : NANBOX_OFNULL());
+  }
+  sistack_push_force(NANBOX_OFEMPTY());
+  drive_step();
+}
+
+/**
+ * Continues the driven primitive whose frame is installed with the result of
+ * the function it called.
+ */
+static void drive_resume(const sinanbox_t result) {
+  const sivmfn_drive_t *drive = sivmfn_drives + NANBOX_INT(sistack_bottom[0]);
+  sinanbox_t *const slot = sistack_bottom + 1 + drive->state_size;
+  siheap_derefbox(*slot);
+  *slot = result;
+  drive_step();
+}
+
 static inline bool do_internal_function(
   const uint8_t id,
   const uint8_t num_args,
@@ -114,12 +201,51 @@ static inline bool do_internal_function(
     sistack_peek(num_args - 1);
   }
 
+  const sivmfn_t *fn = (is_primitive ? sivmfn_primitives : sivmfn_vminternals) + id;
+  if (fn->convention == sivmfn_driven) {
+    const sivmfn_drive_t *drive = drive_of(fn->fn);
+    if (num_args < drive->argc) {
+      sifault(sinter_fault_function_arity);
+      return false;
+    }
+
+    // allocate the frame while the arguments are still on the stack, then take
+    // the stack's references to them
+    siheap_frame_t *frame = siframe_new();
+    for (unsigned int i = drive->argc; i < num_args; ++i) {
+      siheap_derefbox(sistack_pop());
+    }
+    sinanbox_t args[SIVMFN_DRIVE_MAX_ARGC];
+    sistack_top -= drive->argc;
+    memcpy(args, sistack_top, drive->argc*sizeof(sinanbox_t));
+
+    if (pop_fn) {
+      siheap_derefbox(sistack_pop());
+    }
+
+    if (is_tailcall) {
+      siheap_deref(sistate.env);
+      sistack_destroy(&sistate.pc, &sistate.env);
+    } else {
+      sistate.pc += sizeof_instr;
+    }
+
+    // the primitive returns to the return address (or from the main loop, if
+    // it is NULL), either now, or from op_drive
+    drive_start(drive, frame, args, sistate.pc);
+    return !sistate.pc;
+  }
+
   // call the function
-  sinanbox_t retv = (is_primitive ? sivmfn_primitives : sivmfn_vminternals)[id](num_args, sistack_top - num_args);
+  sinanbox_t retv = fn->fn(num_args, sistack_top - num_args);
 
   // pop the arguments off the stack
-  for (unsigned int i = 0; i < num_args; ++i) {
-    siheap_derefbox(sistack_pop());
+  if (fn->convention == sivmfn_consumes_args) {
+    sistack_top -= num_args;
+  } else {
+    for (unsigned int i = 0; i < num_args; ++i) {
+      siheap_derefbox(sistack_pop());
+    }
   }
 
   // pop the function off the stack, if needed
@@ -146,6 +272,230 @@ static inline bool do_internal_function(
   return false;
 }
 
+#ifdef SINTER_QUICKEN
+SINTER_THREAD_LOCAL sinter_quicken_stats_t sinter_quicken_stats;
+
+// the number of times in a row a generic instruction must see the same operand
+// types before it is quickened
+#define QUICKEN_THRESHOLD 4
+// the number of instructions whose operand types are tracked at once
+#define QUICKEN_SITES 64
+
+/**
+ * Tracks the operand types seen by the generic instruction at address.
+ * Instructions whose addresses collide share an entry.
+ */
+static SINTER_THREAD_LOCAL struct quicken_site {
+  address_t address;
+  opcode_t specialised;
+  uint8_t count;
+} quicken_sites[QUICKEN_SITES];
+
+void sivm_quicken_reset(void) {
+  sinter_quicken_stats = (sinter_quicken_stats_t) { 0 };
+  memset(quicken_sites, 0, sizeof(quicken_sites));
+}
+
+/**
+ * Records that the generic instruction at the PC has been executed with
+ * operands the given specialised instruction handles. Once that happens
+ * QUICKEN_THRESHOLD times in a row, the instruction is rewritten to the
+ * specialised instruction.
+ */
+static inline void quicken_observe(opcode_t specialised) {
+  // nothing is quickened, or counted, unless the program may be rewritten
+  if (!sistate.program_mutable) {
+    return;
+  }
+  ++sinter_quicken_stats.generic;
+
+  const address_t address = SISTATE_CURADDR;
+  _Static_assert((QUICKEN_SITES & (QUICKEN_SITES - 1)) == 0, "QUICKEN_SITES is not a power of 2");
+  struct quicken_site *site = &quicken_sites[address & (QUICKEN_SITES - 1)];
+  if (site->address != address || site->specialised != specialised) {
+    site->address = address;
+    site->specialised = specialised;
+    site->count = 1;
+  } else if (++site->count >= QUICKEN_THRESHOLD) {
+    *(opcode_t *) sistate.pc = specialised;
+    site->count = 0;
+    ++sinter_quicken_stats.quickened;
+  }
+}
+
+/**
+ * Reverts the specialised instruction at the PC, whose operands are not of
+ * the types it handles, to the generic instruction, and returns the latter.
+ */
+static inline opcode_t quicken_deopt(void) {
+  static const opcode_t generic_opcodes[] = {
+    op_add_g, op_sub_g, op_mul_g, op_lt_g, op_gt_g, op_le_g, op_ge_g, op_eq_g, op_neq_g
+  };
+  const opcode_t generic = generic_opcodes[(*sistate.pc - op_add_ii) >> 1];
+
+  ++sinter_quicken_stats.deopts;
+  if (sistate.program_mutable) {
+    *(opcode_t *) sistate.pc = generic;
+  }
+  return generic;
+}
+
+#define QUICKEN_OBSERVE(specialised) quicken_observe(specialised)
+#else
+#define QUICKEN_OBSERVE(specialised) ((void) 0)
+#endif
+
+// in fixed-point mode, almost all non-integers are not floats, so there are no
+// float-specialised instructions
+#ifndef SINTER_FIXED_POINT
+#define QUICKEN_OBSERVE_FLOAT(specialised) QUICKEN_OBSERVE(specialised)
+#else
+#define QUICKEN_OBSERVE_FLOAT(specialised) ((void) 0)
+#endif
+
+#ifdef SINTER_FIXED_POINT
+/**
+ * Fixed-point fast path for v0 and v1: if cond holds and both are fixed-point
+ * (or small enough integers), returns result, computed from f0 and f1, the
+ * operands as fixed-point values. Otherwise, falls through to the float path.
+ */
+#define FIXED_ARITHMETIC(cond, result) \
+  if ((cond) && NANBOX_ISFIXEDNUM(v0) && NANBOX_ISFIXEDNUM(v1)) { \
+    const int64_t f0 = NANBOX_TOFIXED(v0); \
+    const int64_t f1 = NANBOX_TOFIXED(v1); \
+    return result; \
+  }
+#define NOT_BOTH_INT (!NANBOX_ISINT(v0) || !NANBOX_ISINT(v1))
+#else
+#define FIXED_ARITHMETIC(cond, result)
+#endif
+
+// The following functions implement the arithmetic and comparison operators
+// for two numbers; the caller must check that v0 and v1 are numbers. They are
+// forced inline, as otherwise the compiler does not always inline them into
+// the (very large) main loop.
+
+static inline __attribute__((always_inline)) sinanbox_t numeric_add(sinanbox_t v0, sinanbox_t v1) {
+  FIXED_ARITHMETIC(NOT_BOTH_INT, nanbox_wrap_fixed(f0 + f1));
+  switch (NANBOX_ISFLOAT(v1) << 1 | NANBOX_ISFLOAT(v0)) {
+  case 0: /* neither are floats */
+    QUICKEN_OBSERVE(op_add_ii);
+    return NANBOX_WRAP_INT((sinanbox_wideint_t) NANBOX_INT(v0) + NANBOX_INT(v1));
+  case 1: /* v0 is float */
+    return NANBOX_OFFLOAT(NANBOX_FLOAT(v0) + NANBOX_INT(v1));
+  case 2: /* v1 is float */
+    return NANBOX_OFFLOAT(NANBOX_INT(v0) + NANBOX_FLOAT(v1));
+  case 3: /* both are float */
+    QUICKEN_OBSERVE_FLOAT(op_add_ff);
+    return NANBOX_OFFLOAT(NANBOX_FLOAT(v0) + NANBOX_FLOAT(v1));
+  default:
+    SIBUG();
+    sifault(sinter_fault_internal_error);
+  }
+}
+
+static inline __attribute__((always_inline)) sinanbox_t numeric_sub(sinanbox_t v0, sinanbox_t v1) {
+  FIXED_ARITHMETIC(NOT_BOTH_INT, nanbox_wrap_fixed(f0 - f1));
+  switch (NANBOX_ISFLOAT(v1) << 1 | NANBOX_ISFLOAT(v0)) {
+  case 0: /* neither are floats */
+    QUICKEN_OBSERVE(op_sub_ii);
+    return NANBOX_WRAP_INT((sinanbox_wideint_t) NANBOX_INT(v0) - NANBOX_INT(v1));
+  case 1: /* v0 is float */
+    return NANBOX_OFFLOAT(NANBOX_FLOAT(v0) - NANBOX_INT(v1));
+  case 2: /* v1 is float */
+    return NANBOX_OFFLOAT(NANBOX_INT(v0) - NANBOX_FLOAT(v1));
+  case 3: /* both are float */
+    QUICKEN_OBSERVE_FLOAT(op_sub_ff);
+    return NANBOX_OFFLOAT(NANBOX_FLOAT(v0) - NANBOX_FLOAT(v1));
+  default:
+    SIBUG();
+    sifault(sinter_fault_internal_error);
+  }
+}
+
+static inline __attribute__((always_inline)) sinanbox_t numeric_mul(sinanbox_t v0, sinanbox_t v1) {
+  FIXED_ARITHMETIC(NOT_BOTH_INT, nanbox_fixed_mul(f0, f1));
+  switch (NANBOX_ISFLOAT(v1) << 1 | NANBOX_ISFLOAT(v0)) {
+  case 0: /* neither are floats */
+    QUICKEN_OBSERVE(op_mul_ii);
+    /* this can overflow, use int64 instead */
+    return NANBOX_WRAP_INT(((int64_t) NANBOX_INT(v0)) * ((int64_t) NANBOX_INT(v1)));
+  case 1: /* v0 is float */
+    return NANBOX_OFFLOAT(NANBOX_FLOAT(v0) *  NANBOX_INT(v1));
+  case 2: /* v1 is float */
+    return NANBOX_OFFLOAT(NANBOX_INT(v0) * NANBOX_FLOAT(v1));
+  case 3: /* both are float */
+    QUICKEN_OBSERVE_FLOAT(op_mul_ff);
+    return NANBOX_OFFLOAT(NANBOX_FLOAT(v0) * NANBOX_FLOAT(v1));
+  default:
+    SIBUG();
+    sifault(sinter_fault_internal_error);
+  }
+}
+
+static inline __attribute__((always_inline)) sinanbox_t numeric_div(sinanbox_t v0, sinanbox_t v1) {
+  FIXED_ARITHMETIC(true, nanbox_fixed_div(f0, f1));
+  switch (NANBOX_ISFLOAT(v1) << 1 | NANBOX_ISFLOAT(v0)) {
+  case 0: /* neither are floats */
+    return NANBOX_OFFLOAT(((sinanbox_float_t) NANBOX_INT(v0)) / NANBOX_INT(v1));
+  case 1: /* v0 is float */
+    return NANBOX_OFFLOAT(NANBOX_FLOAT(v0) / NANBOX_INT(v1));
+  case 2: /* v1 is float */
+    return NANBOX_OFFLOAT(NANBOX_INT(v0) / NANBOX_FLOAT(v1));
+  case 3: /* both are float */
+    return NANBOX_OFFLOAT(NANBOX_FLOAT(v0) / NANBOX_FLOAT(v1));
+  default:
+    SIBUG();
+    sifault(sinter_fault_internal_error);
+  }
+}
+
+static inline __attribute__((always_inline)) sinanbox_t numeric_mod(sinanbox_t v0, sinanbox_t v1) {
+  FIXED_ARITHMETIC(true, nanbox_fixed_mod(f0, f1));
+  switch (NANBOX_ISFLOAT(v1) << 1 | NANBOX_ISFLOAT(v0)) {
+  case 0: /* neither are floats */
+    return NANBOX_OFFLOAT(NANBOX_MATHFN(fmod)(NANBOX_INT(v0),  NANBOX_INT(v1)));
+  case 1: /* v0 is float */
+    return NANBOX_OFFLOAT(NANBOX_MATHFN(fmod)(NANBOX_FLOAT(v0), NANBOX_INT(v1)));
+  case 2: /* v1 is float */
+    return NANBOX_OFFLOAT(NANBOX_MATHFN(fmod)(NANBOX_INT(v0), NANBOX_FLOAT(v1)));
+  case 3: /* both are float */
+    return NANBOX_OFFLOAT(NANBOX_MATHFN(fmod)(NANBOX_FLOAT(v0), NANBOX_FLOAT(v1)));
+  default:
+    SIBUG();
+    sifault(sinter_fault_internal_error);
+  }
+}
+
+#define NUMERIC_COMPARISON(op, name) \
+static inline __attribute__((always_inline)) sinanbox_t numeric_ ## name(sinanbox_t v0, sinanbox_t v1) { \
+  FIXED_ARITHMETIC(NOT_BOTH_INT, NANBOX_OFBOOL(f0 op f1)); \
+  switch (NANBOX_ISFLOAT(v1) << 1 | NANBOX_ISFLOAT(v0)) { \
+  case 0: /* neither are floats */ \
+    QUICKEN_OBSERVE(op_ ## name ## _ii); \
+    return NANBOX_OFBOOL(NANBOX_INT(v0) op NANBOX_INT(v1)); \
+  case 1: /* v0 is float */ \
+    return NANBOX_OFBOOL(NANBOX_FLOAT(v0) op NANBOX_INT(v1)); \
+  case 2: /* v1 is float */ \
+    return NANBOX_OFBOOL(NANBOX_INT(v0) op NANBOX_FLOAT(v1)); \
+  case 3: /* both are float */ \
+    QUICKEN_OBSERVE_FLOAT(op_ ## name ## _ff); \
+    return NANBOX_OFBOOL(NANBOX_FLOAT(v0) op NANBOX_FLOAT(v1)); \
+  default: \
+    SIBUG(); \
+    sifault(sinter_fault_internal_error); \
+  } \
+}
+
+NUMERIC_COMPARISON(<, lt)
+NUMERIC_COMPARISON(>, gt)
+NUMERIC_COMPARISON(<=, le)
+NUMERIC_COMPARISON(>=, ge)
+
+#undef NUMERIC_COMPARISON
+#undef FIXED_ARITHMETIC
+#undef NOT_BOTH_INT
+
 #define DECLOPSTRUCT(type) const struct type *instr = (const struct type *) sistate.pc
 #define ADVANCE_PCONE() sistate.pc += sizeof(opcode_t); continue
 #define ADVANCE_PCI() sistate.pc += sizeof(*instr); continue
@@ -159,17 +509,27 @@ static void main_loop(void) {
   (void) previous_pc;
 #endif
   while (1) {
-    if (!sistate.running) {
+    if (!__atomic_load_n(&sistate.running, __ATOMIC_RELAXED) || SISTATE_STOP_REQUESTED()) {
       SIDEBUG("The program has been stopped by the user.\n");
       sifault(sinter_fault_stopped);
       return;
     }
 
+#ifdef SINTER_TASKS
+    if (sistate.budget) {
+      --sistate.budget;
+    } else if (!sistate.exec_depth) {
+      // the task has used up its budget, or yielded; sivm_resume continues
+      // from here
+      return;
+    }
+#endif
+
 #ifdef SINTER_DEBUG_MEMORY_CHECK
     debug_memorycheck();
 #endif
 #ifdef SINTER_DEBUG
-    if (sistate.pc >= sistate.program_end) {
+    if (sistate.pc >= sistate.program_end && (sistate.pc < drive_code || sistate.pc >= drive_code + sizeof(drive_code))) {
       SIBUGV("Jumped out of bounds to 0x%tx after instruction at address 0x%tx\n", SISTATE_CURADDR, previous_pc - sistate.program);
       sifault(sinter_fault_internal_error);
       return;
@@ -178,7 +538,10 @@ static void main_loop(void) {
 
     SITRACE("PC: 0x%tx; opcode: %02x (%s)\n", SISTATE_CURADDR, *sistate.pc, get_opcode_name(*sistate.pc));
 #endif
-    const opcode_t this_opcode = *sistate.pc;
+    opcode_t this_opcode = *sistate.pc;
+#ifdef SINTER_QUICKEN
+dispatch:
+#endif
     switch (this_opcode) {
     case op_nop:
       ADVANCE_PCONE();
@@ -238,7 +601,7 @@ static void main_loop(void) {
       }
       sistack_push(NANBOX_OFFLOAT(float_value.value));
 #else
-      sistack_push(NANBOX_OFFLOAT((float)instr->operand));
+      sistack_push(NANBOX_OFFLOAT((sinanbox_float_t) instr->operand));
 #endif
       ADVANCE_PCI();
     }
@@ -274,6 +637,20 @@ static void main_loop(void) {
   return; \
 } } while (0)
 
+/**
+ * A generic arithmetic instruction, which pushes numeric_name of the operands
+ * if both are numbers, and faults otherwise.
+ */
+#define ARITHMETIC_OP(name) { \
+      sinanbox_t v1 = sistack_pop(); \
+      sinanbox_t v0 = sistack_pop(); \
+      ARITHMETIC_TYPECHECK(); \
+      sistack_push(numeric_ ## name(v0, v1)); \
+      /* No need to deref v0 and v1; they are either numbers (which are not on the heap) */ \
+      /* or they are not (in which case we would have faulted) */ \
+      ADVANCE_PCONE(); \
+    }
+
     // TODO: optimised _f variants
     case op_add_g:
     case op_add_f: {
@@ -282,41 +659,22 @@ static void main_loop(void) {
       sinanbox_t r;
 
       if (NANBOX_ISNUMERIC(v0) && NANBOX_ISNUMERIC(v1)) {
-        switch (NANBOX_ISFLOAT(v1) << 1 | NANBOX_ISFLOAT(v0)) {
-        case 0: /* neither are floats */
-          /* addition/subtraction of 2 21-bit integers won't overflow a 32-bit integer; no worries here */
-          r = NANBOX_WRAP_INT(NANBOX_INT(v0) + NANBOX_INT(v1));
-          break;
-        case 1: /* v0 is float */
-          r = NANBOX_OFFLOAT(NANBOX_FLOAT(v0) + NANBOX_INT(v1));
-          break;
-        case 2: /* v1 is float */
-          r = NANBOX_OFFLOAT(NANBOX_INT(v0) + NANBOX_FLOAT(v1));
-          break;
-        case 3: /* both are float */
-          r = NANBOX_OFFLOAT(NANBOX_FLOAT(v0) + NANBOX_FLOAT(v1));
-          break;
-        default:
-          SIBUG();
-          sifault(sinter_fault_internal_error);
-          break;
-        }
+        r = numeric_add(v0, v1);
       } else if (NANBOX_ISPTR(v0) & NANBOX_ISPTR(v1)) {
         siheap_header_t *hv0 = SIHEAP_NANBOXTOPTR(v0);
         siheap_header_t *hv1 = SIHEAP_NANBOXTOPTR(v1);
 
         if (siheap_is_string(hv0) && siheap_is_string(hv1)) {
-          // if either are empty string, no-op
-          if (hv0->type == sitype_strconst && *(((siheap_strconst_t *) hv0)->string->data) == '\0') {
-            siheap_ref(hv1);
-            r = v1;
-          } else if (hv1->type == sitype_strconst && *(((siheap_strconst_t *) hv1)->string->data) == '\0') {
-            siheap_ref(hv0);
-            r = v0;
+          // the concatenation may run a mark-sweep, which must see the operands
+          sistack_top += 2;
+          if (hv0->refcount == 1) {
+            // nobody else can see the left operand, so it can be appended to
+            r = SIHEAP_PTRTONANBOX(sistrobj_append(hv0, hv1));
+            v0 = NANBOX_OFUNDEF();
           } else {
-            siheap_strpair_t *obj = sistrpair_new(hv0, hv1);
-            r = SIHEAP_PTRTONANBOX(obj);
+            r = SIHEAP_PTRTONANBOX(sistrobj_concat(hv0, hv1));
           }
+          sistack_top -= 2;
         } else {
           SIDEBUG("Invalid operands to add.\n");
           sifault(sinter_fault_type);
@@ -335,133 +693,31 @@ static void main_loop(void) {
     }
     break;
     case op_sub_g:
-    case op_sub_f: {
-      sinanbox_t v1 = sistack_pop();
-      sinanbox_t v0 = sistack_pop();
-      ARITHMETIC_TYPECHECK();
-      sinanbox_t r;
-      switch (NANBOX_ISFLOAT(v1) << 1 | NANBOX_ISFLOAT(v0)) {
-      case 0: /* neither are floats */
-        /* addition/subtraction of 2 21-bit integers won't overflow a 32-bit integer; no worries here */
-        r = NANBOX_WRAP_INT(NANBOX_INT(v0) - NANBOX_INT(v1));
-        break;
-      case 1: /* v0 is float */
-        r = NANBOX_OFFLOAT(NANBOX_FLOAT(v0) - NANBOX_INT(v1));
-        break;
-      case 2: /* v1 is float */
-        r = NANBOX_OFFLOAT(NANBOX_INT(v0) - NANBOX_FLOAT(v1));
-        break;
-      case 3: /* both are float */
-        r = NANBOX_OFFLOAT(NANBOX_FLOAT(v0) - NANBOX_FLOAT(v1));
-        break;
-      default:
-        SIBUG();
-        sifault(sinter_fault_internal_error);
-        return;
-      }
-      sistack_push(r);
-      /* No need to deref v0 and v1; they are either numbers (which are not on the heap) */
-      /* or they are not (in which case we would have faulted) */
-      ADVANCE_PCONE();
-    }
+    case op_sub_f:
+      ARITHMETIC_OP(sub)
 
     case op_mul_g:
-    case op_mul_f: {
-      sinanbox_t v1 = sistack_pop();
-      sinanbox_t v0 = sistack_pop();
-      ARITHMETIC_TYPECHECK();
-      sinanbox_t r;
-      switch (NANBOX_ISFLOAT(v1) << 1 | NANBOX_ISFLOAT(v0)) {
-      case 0: /* neither are floats */
-        /* this can overflow, use int64 instead */
-        r = NANBOX_WRAP_INT(((int64_t) NANBOX_INT(v0)) * ((int64_t) NANBOX_INT(v1)));
-        break;
-      case 1: /* v0 is float */
-        r = NANBOX_OFFLOAT(NANBOX_FLOAT(v0) *  NANBOX_INT(v1));
-        break;
-      case 2: /* v1 is float */
-        r = NANBOX_OFFLOAT(NANBOX_INT(v0) * NANBOX_FLOAT(v1));
-        break;
-      case 3: /* both are float */
-        r = NANBOX_OFFLOAT(NANBOX_FLOAT(v0) * NANBOX_FLOAT(v1));
-        break;
-      default:
-        SIBUG();
-        sifault(sinter_fault_internal_error);
-        return;
-      }
-      sistack_push(r);
-      /* No need to deref v0 and v1; they are either numbers (which are not on the heap) */
-      /* or they are not (in which case we would have faulted) */
-      ADVANCE_PCONE();
-    }
+    case op_mul_f:
+      ARITHMETIC_OP(mul)
 
     case op_div_g:
-    case op_div_f: {
-      sinanbox_t v1 = sistack_pop();
-      sinanbox_t v0 = sistack_pop();
-      ARITHMETIC_TYPECHECK();
-      sinanbox_t r;
-      switch (NANBOX_ISFLOAT(v1) << 1 | NANBOX_ISFLOAT(v0)) {
-      case 0: /* neither are floats */
-        r = NANBOX_OFFLOAT(((float) NANBOX_INT(v0)) / NANBOX_INT(v1));
-        break;
-      case 1: /* v0 is float */
-        r = NANBOX_OFFLOAT(NANBOX_FLOAT(v0) / NANBOX_INT(v1));
-        break;
-      case 2: /* v1 is float */
-        r = NANBOX_OFFLOAT(NANBOX_INT(v0) / NANBOX_FLOAT(v1));
-        break;
-      case 3: /* both are float */
-        r = NANBOX_OFFLOAT(NANBOX_FLOAT(v0) / NANBOX_FLOAT(v1));
-        break;
-      default:
-        SIBUG();
-        sifault(sinter_fault_internal_error);
-        return;
-      }
-      sistack_push(r);
-      /* No need to deref v0 and v1; they are either numbers (which are not on the heap) */
-      /* or they are not (in which case we would have faulted) */
-      ADVANCE_PCONE();
-    }
+    case op_div_f:
+      ARITHMETIC_OP(div)
 
     case op_mod_g:
-    case op_mod_f: {
-      sinanbox_t v1 = sistack_pop();
-      sinanbox_t v0 = sistack_pop();
-      ARITHMETIC_TYPECHECK();
-      sinanbox_t r;
-      switch (NANBOX_ISFLOAT(v1) << 1 | NANBOX_ISFLOAT(v0)) {
-      case 0: /* neither are floats */
-        r = NANBOX_OFFLOAT(fmodf(NANBOX_INT(v0),  NANBOX_INT(v1)));
-        break;
-      case 1: /* v0 is float */
-        r = NANBOX_OFFLOAT(fmodf(NANBOX_FLOAT(v0), NANBOX_INT(v1)));
-        break;
-      case 2: /* v1 is float */
-        r = NANBOX_OFFLOAT(fmodf(NANBOX_INT(v0), NANBOX_FLOAT(v1)));
-        break;
-      case 3: /* both are float */
-        r = NANBOX_OFFLOAT(fmodf(NANBOX_FLOAT(v0), NANBOX_FLOAT(v1)));
-        break;
-      default:
-        SIBUG();
-        sifault(sinter_fault_internal_error);
-        break;
-      }
-      sistack_push(r);
-      /* No need to deref v0 and v1; they are either numbers (which are not on the heap) */
-      /* or they are not (in which case we would have faulted) */
-      ADVANCE_PCONE();
-    }
+    case op_mod_f:
+      ARITHMETIC_OP(mod)
 
     case op_neg_g:
     case op_neg_f: {
       sinanbox_t v1 = sistack_pop();
 
       if (NANBOX_ISINT(v1)) {
-        sistack_push(NANBOX_WRAP_INT(-NANBOX_INT(v1)));
+        sistack_push(NANBOX_WRAP_INT(-(sinanbox_wideint_t) NANBOX_INT(v1)));
+#ifdef SINTER_FIXED_POINT
+      } else if (NANBOX_ISFIXED(v1)) {
+        sistack_push(nanbox_wrap_fixed(-(int64_t) NANBOX_FIXED(v1)));
+#endif
       } else if (NANBOX_ISFLOAT(v1)) {
         sistack_push(NANBOX_OFFLOAT(-NANBOX_FLOAT(v1)));
       } else {
@@ -483,35 +739,18 @@ static void main_loop(void) {
       ADVANCE_PCONE();
     }
 
-#define COMPARISON_OP(op) { \
+#define COMPARISON_OP(op, name) { \
       sinanbox_t v1 = sistack_pop(); \
       sinanbox_t v0 = sistack_pop(); \
       sinanbox_t r; \
  \
       if (NANBOX_ISNUMERIC(v0) && NANBOX_ISNUMERIC(v1)) { \
-        switch (NANBOX_ISFLOAT(v1) << 1 | NANBOX_ISFLOAT(v0)) { \
-        case 0: /* neither are floats */ \
-          r = NANBOX_OFBOOL(NANBOX_INT(v0) op NANBOX_INT(v1)); \
-          break; \
-        case 1: /* v0 is float */ \
-          r = NANBOX_OFBOOL(NANBOX_FLOAT(v0) op NANBOX_INT(v1)); \
-          break; \
-        case 2: /* v1 is float */ \
-          r = NANBOX_OFBOOL(NANBOX_INT(v0) op NANBOX_FLOAT(v1)); \
-          break; \
-        case 3: /* both are float */ \
-          r = NANBOX_OFBOOL(NANBOX_FLOAT(v0) op NANBOX_FLOAT(v1)); \
-          break; \
-        default: \
-          SIBUG(); \
-          sifault(sinter_fault_internal_error); \
-          break; \
-        } \
+        r = numeric_ ## name(v0, v1); \
       } else if (NANBOX_ISPTR(v0) & NANBOX_ISPTR(v1)) { \
         siheap_header_t *hv0 = SIHEAP_NANBOXTOPTR(v0); \
         siheap_header_t *hv1 = SIHEAP_NANBOXTOPTR(v1); \
         if (siheap_is_string(hv0) && siheap_is_string(hv1)) { \
-          r = NANBOX_OFBOOL(strcmp(sistrobj_tocharptr(hv0), sistrobj_tocharptr(hv1)) op 0); \
+          r = NANBOX_OFBOOL(sistrobj_compare(hv0, hv1) op 0); \
         } else { \
           SIDEBUG("Invalid operands to comparison.\n"); \
           sifault(sinter_fault_type); \
@@ -531,16 +770,16 @@ static void main_loop(void) {
 
     case op_lt_g:
     case op_lt_f:
-      COMPARISON_OP(<)
+      COMPARISON_OP(<, lt)
     case op_gt_g:
     case op_gt_f:
-      COMPARISON_OP(>)
+      COMPARISON_OP(>, gt)
     case op_le_g:
     case op_le_f:
-      COMPARISON_OP(<=)
+      COMPARISON_OP(<=, le)
     case op_ge_g:
     case op_ge_f:
-      COMPARISON_OP(>=)
+      COMPARISON_OP(>=, ge)
     case op_neq_g:
     case op_neq_f:
     case op_neq_b:
@@ -555,6 +794,14 @@ static void main_loop(void) {
         r = !r;
       }
 
+#ifdef SINTER_QUICKEN
+      if (NANBOX_ISINT(v0) && NANBOX_ISINT(v1)) {
+        QUICKEN_OBSERVE(this_opcode >= op_neq_g ? op_neq_ii : op_eq_ii);
+      } else if (NANBOX_ISFLOAT(v0) && NANBOX_ISFLOAT(v1)) {
+        QUICKEN_OBSERVE_FLOAT(this_opcode >= op_neq_g ? op_neq_ff : op_eq_ff);
+      }
+#endif
+
       sistack_push(NANBOX_OFBOOL(r));
       siheap_derefbox(v0);
       siheap_derefbox(v1);
@@ -737,6 +984,33 @@ static void main_loop(void) {
             return;
           }
 
+          siheap_env_t *const env = sistate.env;
+          if (is_tailcall && env->header.refcount == 1 && env->parent == fn_obj->env &&
+              env->entry_count == fn_code->env_size && sistack_limit - sistack_bottom == fn_code->stack_size) {
+            // a tail call to a function of the same shape as the caller (e.g. a
+            // self tail call), and no closure refers to the caller's
+            // environment: reuse the environment and stack frame in place,
+            // which turns the call into a jump
+            sistack_top -= fn_code->num_args;
+            if (sistack_top < sistack_bottom) {
+              sifault(sinter_fault_stack_underflow);
+              return;
+            }
+
+            for (unsigned int i = 0; i < env->entry_count; ++i) {
+              siheap_derefbox(env->entry[i]);
+              env->entry[i] = i < fn_code->num_args ? sistack_top[i] : NANBOX_OFEMPTY();
+            }
+
+            // pop the function, and anything else left on the caller's stack
+            while (sistack_top > sistack_bottom) {
+              siheap_derefbox(sistack_pop());
+            }
+
+            sistate.pc = &fn_code->code;
+            continue;
+          }
+
           // create the new environment
           siheap_env_t *new_env = sienv_new(fn_obj->env, fn_code->env_size);
 
@@ -846,6 +1120,22 @@ static void main_loop(void) {
       break;
     }
 
+    case op_drive:
+      if (sistate.pc < drive_code || sistate.pc >= drive_code + sizeof(drive_code)) {
+        SIDEBUG("op_drive outside a driven primitive\n");
+        sifault(sinter_fault_invalid_program);
+        return;
+      }
+
+      drive_resume(sistack_pop());
+
+      // the primitive returned from the main loop (see do_internal_function)
+      if (!sistate.pc) {
+        return;
+      }
+
+      break;
+
     case op_ret_u:
     case op_ret_n:
       // destroy this stack frame, and return to the caller
@@ -889,6 +1179,229 @@ static void main_loop(void) {
       ADVANCE_PCONE();
     }
 
+#ifdef SINTER_SPECIALISE
+    // the analysis has checked that the index is in range, and that the entry
+    // holds a number (for loads), or does not hold a heap object (for stores)
+    case op_ldl_n: {
+      DECLOPSTRUCT(op_oneindex);
+      sistack_push(sistate.env->entry[instr->index]);
+      ADVANCE_PCI();
+    }
+
+    case op_stl_n: {
+      DECLOPSTRUCT(op_oneindex);
+      sistate.env->entry[instr->index] = sistack_pop();
+      ADVANCE_PCI();
+    }
+
+    case op_ldp_n: {
+      DECLOPSTRUCT(op_twoindex);
+      siheap_env_t *env = sienv_getparent(sistate.env, instr->envindex);
+      sistack_push(env->entry[instr->index]);
+      ADVANCE_PCI();
+    }
+
+    case op_stp_n: {
+      DECLOPSTRUCT(op_twoindex);
+      siheap_env_t *env = sienv_getparent(sistate.env, instr->envindex);
+      env->entry[instr->index] = sistack_pop();
+      ADVANCE_PCI();
+    }
+
+/**
+ * An arithmetic or comparison instruction whose operands are known to be
+ * numbers.
+ */
+#define NUMERIC_OP(name) { \
+      const sinanbox_t v1 = sistack_pop(); \
+      const sinanbox_t v0 = sistack_pop(); \
+      sistack_push(numeric_ ## name(v0, v1)); \
+      ADVANCE_PCONE(); \
+    }
+
+    case op_add_nn:
+      NUMERIC_OP(add)
+    case op_sub_nn:
+      NUMERIC_OP(sub)
+    case op_mul_nn:
+      NUMERIC_OP(mul)
+    case op_div_nn:
+      NUMERIC_OP(div)
+    case op_mod_nn:
+      NUMERIC_OP(mod)
+    case op_lt_nn:
+      NUMERIC_OP(lt)
+    case op_gt_nn:
+      NUMERIC_OP(gt)
+    case op_le_nn:
+      NUMERIC_OP(le)
+    case op_ge_nn:
+      NUMERIC_OP(ge)
+#undef NUMERIC_OP
+
+    // the analysis has checked that another reference keeps the value alive
+    // until the instruction that consumes it
+    case op_ldl_bw: {
+      DECLOPSTRUCT(op_oneindex);
+      sinanbox_t v = sienv_get(sistate.env, instr->index);
+      if (NANBOX_ISEMPTY(v)) {
+        sifault(sinter_fault_uninitialised_load);
+        return;
+      }
+      siheap_borrowbox(v);
+      sistack_push(v);
+      ADVANCE_PCI();
+    }
+
+    case op_ldp_bw: {
+      DECLOPSTRUCT(op_twoindex);
+      siheap_env_t *env = sienv_getparent(sistate.env, instr->envindex);
+      if (!env) {
+        sifault(sinter_fault_invalid_load);
+        return;
+      }
+      sinanbox_t v = sienv_get(env, instr->index);
+      if (NANBOX_ISEMPTY(v)) {
+        sifault(sinter_fault_uninitialised_load);
+        return;
+      }
+      siheap_borrowbox(v);
+      sistack_push(v);
+      ADVANCE_PCI();
+    }
+
+    case op_dup_bw: {
+      sinanbox_t v = sistack_peek(0);
+      siheap_borrowbox(v);
+      sistack_push(v);
+      ADVANCE_PCONE();
+    }
+
+    case op_lda_bw: {
+      siheap_array_t *array = NULL;
+      address_t index = 0;
+      pop_array_args(&array, &index);
+
+      sinanbox_t loadv = siarray_get(array, index);
+      siheap_refbox(loadv);
+      siheap_unborrowbox(SIHEAP_PTRTONANBOX(array));
+
+      sistack_push(loadv);
+
+      ADVANCE_PCONE();
+    }
+
+    case op_sta_bw: {
+      sinanbox_t storev = sistack_pop();
+      siheap_array_t *array = NULL;
+      address_t index = 0;
+      pop_array_args(&array, &index);
+
+      siarray_put(array, index, storev);
+      siheap_unborrowbox(SIHEAP_PTRTONANBOX(array));
+
+      ADVANCE_PCONE();
+    }
+
+    // the analysis has checked that the entry is not loaded again before it is
+    // stored to, and that no closure can load it
+    case op_ldl_mv: {
+      DECLOPSTRUCT(op_oneindex);
+      sinanbox_t v = sienv_get(sistate.env, instr->index);
+      if (NANBOX_ISEMPTY(v)) {
+        sifault(sinter_fault_uninitialised_load);
+        return;
+      }
+      sistate.env->entry[instr->index] = NANBOX_OFEMPTY();
+      sistack_push(v);
+      ADVANCE_PCI();
+    }
+
+    case op_ldp_mv: {
+      DECLOPSTRUCT(op_twoindex);
+      siheap_env_t *env = sienv_getparent(sistate.env, instr->envindex);
+      if (!env) {
+        sifault(sinter_fault_invalid_load);
+        return;
+      }
+      sinanbox_t v = sienv_get(env, instr->index);
+      if (NANBOX_ISEMPTY(v)) {
+        sifault(sinter_fault_uninitialised_load);
+        return;
+      }
+      env->entry[instr->index] = NANBOX_OFEMPTY();
+      sistack_push(v);
+      ADVANCE_PCI();
+    }
+
+    case op_pop_bw: {
+      sinanbox_t v = sistack_pop();
+      siheap_unborrowbox(v);
+      (void) v;
+      ADVANCE_PCONE();
+    }
+#endif
+
+#ifdef SINTER_QUICKEN
+/**
+ * A specialised instruction: if guard holds for the operands v0 and v1, pops
+ * them and pushes result. Otherwise, reverts to the generic instruction.
+ */
+#define QUICKENED_OP(guard, result) { \
+      const sinanbox_t v1 = sistack_peek(0); \
+      const sinanbox_t v0 = sistack_peek(1); \
+      if (!(guard)) { \
+        this_opcode = quicken_deopt(); \
+        goto dispatch; \
+      } \
+      ++sinter_quicken_stats.hits; \
+      sistack_top -= 2; \
+      sistack_push(result); \
+      ADVANCE_PCONE(); \
+    }
+#define BOTH_INT (NANBOX_ISINT(v0) && NANBOX_ISINT(v1))
+#define BOTH_FLOAT (NANBOX_ISFLOAT(v0) && NANBOX_ISFLOAT(v1))
+
+    case op_add_ii:
+      QUICKENED_OP(BOTH_INT, NANBOX_WRAP_INT((sinanbox_wideint_t) NANBOX_INT(v0) + NANBOX_INT(v1)))
+    case op_sub_ii:
+      QUICKENED_OP(BOTH_INT, NANBOX_WRAP_INT((sinanbox_wideint_t) NANBOX_INT(v0) - NANBOX_INT(v1)))
+    case op_mul_ii:
+      QUICKENED_OP(BOTH_INT, NANBOX_WRAP_INT(((int64_t) NANBOX_INT(v0)) * ((int64_t) NANBOX_INT(v1))))
+    case op_lt_ii:
+      QUICKENED_OP(BOTH_INT, NANBOX_OFBOOL(NANBOX_INT(v0) < NANBOX_INT(v1)))
+    case op_gt_ii:
+      QUICKENED_OP(BOTH_INT, NANBOX_OFBOOL(NANBOX_INT(v0) > NANBOX_INT(v1)))
+    case op_le_ii:
+      QUICKENED_OP(BOTH_INT, NANBOX_OFBOOL(NANBOX_INT(v0) <= NANBOX_INT(v1)))
+    case op_ge_ii:
+      QUICKENED_OP(BOTH_INT, NANBOX_OFBOOL(NANBOX_INT(v0) >= NANBOX_INT(v1)))
+    case op_eq_ii:
+      QUICKENED_OP(BOTH_INT, NANBOX_OFBOOL(NANBOX_INT(v0) == NANBOX_INT(v1)))
+    case op_neq_ii:
+      QUICKENED_OP(BOTH_INT, NANBOX_OFBOOL(NANBOX_INT(v0) != NANBOX_INT(v1)))
+#ifndef SINTER_FIXED_POINT
+    case op_add_ff:
+      QUICKENED_OP(BOTH_FLOAT, NANBOX_OFFLOAT(NANBOX_FLOAT(v0) + NANBOX_FLOAT(v1)))
+    case op_sub_ff:
+      QUICKENED_OP(BOTH_FLOAT, NANBOX_OFFLOAT(NANBOX_FLOAT(v0) - NANBOX_FLOAT(v1)))
+    case op_mul_ff:
+      QUICKENED_OP(BOTH_FLOAT, NANBOX_OFFLOAT(NANBOX_FLOAT(v0) * NANBOX_FLOAT(v1)))
+    case op_lt_ff:
+      QUICKENED_OP(BOTH_FLOAT, NANBOX_OFBOOL(NANBOX_FLOAT(v0) < NANBOX_FLOAT(v1)))
+    case op_gt_ff:
+      QUICKENED_OP(BOTH_FLOAT, NANBOX_OFBOOL(NANBOX_FLOAT(v0) > NANBOX_FLOAT(v1)))
+    case op_le_ff:
+      QUICKENED_OP(BOTH_FLOAT, NANBOX_OFBOOL(NANBOX_FLOAT(v0) <= NANBOX_FLOAT(v1)))
+    case op_ge_ff:
+      QUICKENED_OP(BOTH_FLOAT, NANBOX_OFBOOL(NANBOX_FLOAT(v0) >= NANBOX_FLOAT(v1)))
+    case op_eq_ff:
+      QUICKENED_OP(BOTH_FLOAT, NANBOX_OFBOOL(NANBOX_FLOAT(v0) == NANBOX_FLOAT(v1)))
+    case op_neq_ff:
+      QUICKENED_OP(BOTH_FLOAT, NANBOX_OFBOOL(NANBOX_FLOAT(v0) != NANBOX_FLOAT(v1)))
+#endif
+#endif
+
     default:
       SIBUGV("Invalid instruction %02x at address 0x%tx\n", this_opcode, SISTATE_CURADDR);
       sifault(sinter_fault_invalid_program);
@@ -905,23 +1418,35 @@ static void main_loop(void) {
  * functions that need to execute functions given to it (e.g. map).
  */
 sinanbox_t siexec(const svm_function_t *fn, siheap_env_t *parent_env, uint8_t argc, sinanbox_t *argv) {
-  siheap_env_t *old_env = sistate.env;
-  const opcode_t *old_pc = sistate.pc;
-
   if (fn->env_size < argc) {
     sifault(sinter_fault_invalid_load);
     return NANBOX_OFEMPTY();
   }
 
-  sistack_limit++; // create one entry for the return value
-  sistate.env = sienv_new(parent_env, fn->env_size);
-  sistack_new(fn->stack_size, NULL, old_env);
+  siheap_env_t *env = sienv_new(parent_env, fn->env_size);
   if (argc) {
-    memcpy(sistate.env->entry, argv, argc*sizeof(sinanbox_t));
+    memcpy(env->entry, argv, argc*sizeof(sinanbox_t));
   }
+
+  return siexec_env(fn, env);
+}
+
+sinanbox_t siexec_env(const svm_function_t *fn, siheap_env_t *env) {
+  siheap_env_t *old_env = sistate.env;
+  const opcode_t *old_pc = sistate.pc;
+
+  sistack_limit++; // create one entry for the return value
+  sistate.env = env;
+  sistack_new(fn->stack_size, NULL, old_env);
   sistate.pc = &fn->code;
 
+#ifdef SINTER_TASKS
+  ++sistate.exec_depth;
   main_loop();
+  --sistate.exec_depth;
+#else
+  main_loop();
+#endif
 
   sinanbox_t ret = sistack_top == sistack_bottom ? NANBOX_OFEMPTY() : *(--sistack_top);
   sistate.env = old_env;
@@ -931,6 +1456,47 @@ sinanbox_t siexec(const svm_function_t *fn, siheap_env_t *parent_env, uint8_t ar
   return ret;
 }
 
+sinanbox_t sivm_drive(const sivmfn_drive_t *drive, uint8_t argc, sinanbox_t *argv) {
+  if (argc < drive->argc) {
+    sifault(sinter_fault_function_arity);
+    return NANBOX_OFEMPTY();
+  }
+
+  siheap_frame_t *frame = siframe_new();
+  for (unsigned int i = 0; i < drive->argc; ++i) {
+    siheap_refbox(argv[i]);
+  }
+
+  const opcode_t *old_pc = sistate.pc;
+  sistack_limit++; // create one entry for the return value
+  drive_start(drive, frame, argv, NULL);
+  if (sistate.pc) {
+#ifdef SINTER_TASKS
+    ++sistate.exec_depth;
+    main_loop();
+    --sistate.exec_depth;
+#else
+    main_loop();
+#endif
+  }
+
+  sinanbox_t ret = sistack_pop();
+  sistate.pc = old_pc;
+  sistack_limit--;
+
+  return ret;
+}
+
+#ifdef SINTER_TASKS
+bool sivm_resume(uint32_t budget) {
+  sistate.budget = budget;
+  sistate.exec_depth = 0;
+  main_loop();
+  sistate.budget = 0;
+  return !sistate.pc;
+}
+#endif
+
 void sistop(void) {
   sistate.running = false;
   sistate.fault_reason = sinter_fault_stopped;
@@ -0,0 +1,10 @@
+#!/bin/bash
+
+set -o pipefail
+
+batch_runner="$1"
+manifest="$2.manifest"
+out_file="$2.out"
+
+# lines are printed in the order programs finish, and the times vary
+"$batch_runner" -j 4 "$manifest" | sed -e 's/,"time_us":[0-9]*}$/}/' | LC_ALL=C sort | diff -u "$out_file" -
@@ -0,0 +1,22 @@
+#!/bin/bash
+
+set -o pipefail
+
+# Loads the program and saves a snapshot after the calls in $2.args, then loads
+# the snapshot and makes the calls in $2.args2, and compares the output of both
+# runs against $2.out.
+
+runner="$1"
+in_file="$2.svm"
+out_file="$2.out"
+
+snapshot="$(mktemp)"
+trap 'rm -f "$snapshot"' EXIT
+
+read -ra save_args < "$2.args"
+read -ra load_args < "$2.args2"
+
+{
+  "$runner" "${save_args[@]}" --save-snapshot "$snapshot" "$in_file" &&
+  "$runner" --load-snapshot "$snapshot" "${load_args[@]}" "$in_file"
+} | diff -u "$out_file" -
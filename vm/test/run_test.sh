@@ -4,6 +4,14 @@ set -o pipefail
 
 runner="$1"
 in_file="$2.svm"
-out_file="$2.out"
+out_file="$2${3:-.out}"
 
-"$runner" "$in_file" | diff -u "$out_file" -
+# extra runner options, e.g. --call, are read from $2.args if it exists; files
+# they name are relative to the directory of the program
+args=()
+if [ -f "$2.args" ]; then
+  read -ra args < "$2.args"
+  cd "$(dirname "$2")" || exit 1
+fi
+
+"$runner" "${args[@]}" "$in_file" | diff -u "$out_file" -